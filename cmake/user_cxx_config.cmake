@@ -42,6 +42,8 @@ set(CARBIN_CXX_OPTIONS ${CARBIN_DEFAULT_COPTS} ${CARBIN_ARCH_OPTION} ${CARBIN_RA
 #
 # define you options here
 # eg.
-list(APPEND CARBIN_CXX_OPTIONS "-fopenmp" "-mf16c")
+# no isa flags here, they leak into every unit, the simd tiers add
+# their own in tann/CMakeLists.txt
+list(APPEND CARBIN_CXX_OPTIONS "-fopenmp")
 list(REMOVE_DUPLICATES CARBIN_CXX_OPTIONS)
 carbin_print_list_label("CXX_OPTIONS:" CARBIN_CXX_OPTIONS)
\ No newline at end of file
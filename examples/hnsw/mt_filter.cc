@@ -19,64 +19,6 @@
 #include <random>
 
 
-// Multithreaded executor
-// The helper function copied from python_bindings/bindings.cpp (and that itself is copied from nmslib)
-// An alternative is using #pragme omp parallel for or any other C++ threading
-template<class Function>
-inline void ParallelFor(size_t start, size_t end, size_t numThreads, Function fn) {
-    if (numThreads <= 0) {
-        numThreads = std::thread::hardware_concurrency();
-    }
-
-    if (numThreads == 1) {
-        for (size_t id = start; id < end; id++) {
-            fn(id, 0);
-        }
-    } else {
-        std::vector<std::thread> threads;
-        std::atomic<size_t> current(start);
-
-        // keep track of exceptions in threads
-        // https://stackoverflow.com/a/32428427/1713196
-        std::exception_ptr lastException = nullptr;
-        std::mutex lastExceptMutex;
-
-        for (size_t threadId = 0; threadId < numThreads; ++threadId) {
-            threads.push_back(std::thread([&, threadId] {
-                while (true) {
-                    size_t id = current.fetch_add(1);
-
-                    if (id >= end) {
-                        break;
-                    }
-
-                    try {
-                        fn(id, threadId);
-                    } catch (...) {
-                        std::unique_lock<std::mutex> lastExcepLock(lastExceptMutex);
-                        lastException = std::current_exception();
-                        /*
-                         * This will work even when current is the largest value that
-                         * size_t can fit, because fetch_add returns the previous value
-                         * before the increment (what will result in overflow
-                         * and produce 0 instead of current + 1).
-                         */
-                        current = end;
-                        break;
-                    }
-                }
-            }));
-        }
-        for (auto &thread: threads) {
-            thread.join();
-        }
-        if (lastException) {
-            std::rethrow_exception(lastException);
-        }
-    }
-}
-
-
 // Filter that allows labels divisible by divisor
 class PickDivisibleIds : public tann::BaseFilterFunctor {
     unsigned int divisor = 1;
@@ -104,6 +46,7 @@ int main(int argc, char **argv) {
     option.metric = tann::METRIC_L2;
     option.engine_type = tann::EngineType::ENGINE_HNSW;
     option.max_elements = 10000;
+    option.executor_threads = num_threads;
     hnsw_option.ef_construction = 200;
     hnsw_option.m = 16;
 
@@ -122,7 +65,7 @@ int main(int argc, char **argv) {
     }
 
     // Add data to index
-    ParallelFor(0, option.max_elements, num_threads, [&](size_t row, size_t threadId) {
+    index->executor()->parallel_for(0, option.max_elements, [&](size_t row, size_t threadId) {
         tann::WriteOption wop;
         auto ra = index->add_vector(wop, turbo::Span<uint8_t>((uint8_t *) (data + option.dimension * row),
                                                               option.dimension * sizeof(float)), row);
@@ -153,7 +96,7 @@ int main(int argc, char **argv) {
         }
     }*/
 
-    ParallelFor(0, option.max_elements, num_threads, [&](size_t row, size_t threadId) {
+    index->executor()->parallel_for(0, option.max_elements, [&](size_t row, size_t threadId) {
         tann::SearchContext query(turbo::Span<uint8_t>(reinterpret_cast<uint8_t*>(data + option.dimension * row), option.dimension * sizeof(float )));
         query.k = k;
         query.is_allowed = &pickIdsDivisibleByTwo;
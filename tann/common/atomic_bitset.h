@@ -0,0 +1,56 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_COMMON_ATOMIC_BITSET_H_
+#define TANN_COMMON_ATOMIC_BITSET_H_
+
+#include <atomic>
+#include <cstdint>
+#include "tann/common/chunked_array.h"
+
+namespace tann {
+
+    ///////////////////////////////////////////////////////////
+    // AtomicBitset is read without locks, set and reset are
+    // atomic per bit. Words never move once allocated, growing
+    // must be serialized against readers like ChunkedArray.
+    class AtomicBitset {
+    public:
+        // only grows, new bits are 0
+        void resize(std::size_t n) {
+            _words.resize((n + 63) / 64);
+        }
+
+        void clear() {
+            _words.clear();
+        }
+
+        [[nodiscard]] bool test(std::size_t i) const {
+            return (_words[i >> 6].load(std::memory_order_acquire) >> (i & 63)) & 1;
+        }
+
+        void set(std::size_t i) {
+            _words[i >> 6].fetch_or(uint64_t(1) << (i & 63), std::memory_order_release);
+        }
+
+        void reset(std::size_t i) {
+            _words[i >> 6].fetch_and(~(uint64_t(1) << (i & 63)), std::memory_order_release);
+        }
+
+    private:
+        ChunkedArray<std::atomic<uint64_t>, 10> _words;
+    };
+}  // namespace tann
+
+#endif  // TANN_COMMON_ATOMIC_BITSET_H_
@@ -0,0 +1,70 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_COMMON_BFLOAT16_H_
+#define TANN_COMMON_BFLOAT16_H_
+
+#include <cstdint>
+#include <cstring>
+
+namespace tann {
+
+    ///////////////////////////////////////////////////////////
+    // bfloat16 is the upper half of an ieee float, it keeps
+    // the float range with 8 bits of mantissa. Converting from
+    // float rounds to nearest even, nan stays nan. The members
+    // are always inlined, the simd tiers of the distance kernels
+    // must not emit copies of them, see simd_namespace.h.
+    class bfloat16 {
+    public:
+        bfloat16() = default;
+
+        [[gnu::always_inline]] explicit bfloat16(float f) : _bits(from_float(f)) {}
+
+        [[gnu::always_inline]] operator float() const {
+            uint32_t u = static_cast<uint32_t>(_bits) << 16;
+            float f;
+            std::memcpy(&f, &u, sizeof(f));
+            return f;
+        }
+
+        [[nodiscard, gnu::always_inline]] uint16_t bits() const {
+            return _bits;
+        }
+
+        [[gnu::always_inline]] static bfloat16 from_bits(uint16_t bits) {
+            bfloat16 r;
+            r._bits = bits;
+            return r;
+        }
+
+    private:
+        [[gnu::always_inline]] static uint16_t from_float(float f) {
+            uint32_t u;
+            std::memcpy(&u, &f, sizeof(u));
+            if ((u & 0x7FFFFFFFu) > 0x7F800000u) {
+                // quiet the nan so it does not round to inf
+                return static_cast<uint16_t>((u >> 16) | 0x40);
+            }
+            u += 0x7FFFu + ((u >> 16) & 1u);
+            return static_cast<uint16_t>(u >> 16);
+        }
+
+        uint16_t _bits{0};
+    };
+
+    static_assert(sizeof(bfloat16) == 2, "bfloat16 must be 2 bytes");
+}  // namespace tann
+
+#endif  // TANN_COMMON_BFLOAT16_H_
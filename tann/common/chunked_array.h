@@ -0,0 +1,82 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_COMMON_CHUNKED_ARRAY_H_
+#define TANN_COMMON_CHUNKED_ARRAY_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace tann {
+
+    ///////////////////////////////////////////////////////////
+    // ChunkedArray grows by whole chunks and never relocates
+    // an element once it is allocated, so references taken
+    // before a resize stay valid after it. T only needs to be
+    // default constructible (std::mutex is fine).
+    // Growing is not thread safe, the caller must serialize it
+    // against readers.
+    template<typename T, std::size_t ChunkBits = 12>
+    class ChunkedArray {
+    public:
+        static constexpr std::size_t kChunkSize = std::size_t(1) << ChunkBits;
+        static constexpr std::size_t kChunkMask = kChunkSize - 1;
+
+        ChunkedArray() = default;
+
+        ChunkedArray(const ChunkedArray &) = delete;
+
+        ChunkedArray &operator=(const ChunkedArray &) = delete;
+
+        ChunkedArray(ChunkedArray &&) noexcept = default;
+
+        ChunkedArray &operator=(ChunkedArray &&) noexcept = default;
+
+        // only grows the storage, elements in new chunks are value initialized.
+        void resize(std::size_t n) {
+            while (capacity() < n) {
+                _chunks.emplace_back(new T[kChunkSize]());
+            }
+            _size = n;
+        }
+
+        void clear() {
+            _chunks.clear();
+            _size = 0;
+        }
+
+        [[nodiscard]] std::size_t size() const {
+            return _size;
+        }
+
+        [[nodiscard]] std::size_t capacity() const {
+            return _chunks.size() * kChunkSize;
+        }
+
+        T &operator[](std::size_t i) {
+            return _chunks[i >> ChunkBits][i & kChunkMask];
+        }
+
+        const T &operator[](std::size_t i) const {
+            return _chunks[i >> ChunkBits][i & kChunkMask];
+        }
+
+    private:
+        std::vector<std::unique_ptr<T[]>> _chunks;
+        std::size_t _size{0};
+    };
+}  // namespace tann
+
+#endif  // TANN_COMMON_CHUNKED_ARRAY_H_
@@ -17,6 +17,7 @@
 
 #include "turbo/platform/port.h"
 #include "tann/common/half.hpp"
+#include "tann/common/bfloat16.h"
 #include "turbo/format/format.h"
 namespace tann {
     typedef half_float::half float16;
@@ -30,5 +31,11 @@ namespace fmt {
             return formatter<float>::format(static_cast<float>(c), ctx);
         }
     };
+
+    template <> struct formatter<tann::bfloat16>: formatter<float> {
+        auto format(tann::bfloat16 c, format_context& ctx) const {
+            return formatter<float>::format(static_cast<float>(c), ctx);
+        }
+    };
 }
 #endif  // TANN_COMMON_CONFIG_H_
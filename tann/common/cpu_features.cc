@@ -0,0 +1,135 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tann/common/cpu_features.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "turbo/log/logging.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define TANN_X86 1
+#else
+#define TANN_X86 0
+#endif
+
+namespace tann {
+
+    namespace {
+#if TANN_X86
+        // the register state the os saves on context switch
+        uint64_t xgetbv0() {
+            uint32_t eax, edx;
+            __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return (static_cast<uint64_t>(edx) << 32) | eax;
+        }
+#endif
+
+        CpuFeatures read_cpu_features() {
+            CpuFeatures f;
+#if TANN_X86
+            unsigned int eax, ebx, ecx, edx;
+            if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+                return f;
+            }
+            f.sse4_2 = ecx & (1u << 20);
+            f.popcnt = ecx & (1u << 23);
+            bool osxsave = ecx & (1u << 27);
+            uint64_t xcr0 = osxsave ? xgetbv0() : 0;
+            // xmm and ymm state
+            bool os_avx = (xcr0 & 0x6) == 0x6;
+            // plus opmask and zmm state
+            bool os_avx512 = (xcr0 & 0xE6) == 0xE6;
+            f.avx = os_avx && (ecx & (1u << 28));
+            f.fma = f.avx && (ecx & (1u << 12));
+            f.f16c = f.avx && (ecx & (1u << 29));
+            if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+                f.avx2 = f.avx && (ebx & (1u << 5));
+                f.avx512f = os_avx512 && (ebx & (1u << 16));
+                f.avx512dq = f.avx512f && (ebx & (1u << 17));
+                f.avx512bw = f.avx512f && (ebx & (1u << 30));
+                f.avx512vl = f.avx512f && (ebx & (1u << 31));
+                f.avx512vnni = f.avx512f && (ecx & (1u << 11));
+                f.avx512vpopcntdq = f.avx512f && (ecx & (1u << 14));
+            }
+#endif
+            return f;
+        }
+
+        SimdLevel env_simd_level(SimdLevel detected) {
+            const char *env = std::getenv("TANN_SIMD_LEVEL");
+            if (env == nullptr || *env == '\0') {
+                return detected;
+            }
+            SimdLevel want;
+            if (std::strcmp(env, "native") == 0) {
+                want = SimdLevel::SIMD_NATIVE;
+            } else if (std::strcmp(env, "sse4") == 0) {
+                want = SimdLevel::SIMD_SSE4;
+            } else if (std::strcmp(env, "avx2") == 0) {
+                want = SimdLevel::SIMD_AVX2;
+            } else if (std::strcmp(env, "avx512") == 0) {
+                want = SimdLevel::SIMD_AVX512;
+            } else {
+                TLOG_WARN("unknown TANN_SIMD_LEVEL {}, use {}", env, simd_level_name(detected));
+                return detected;
+            }
+            if (want > detected) {
+                TLOG_WARN("TANN_SIMD_LEVEL {} is not supported by the cpu, use {}", env, simd_level_name(detected));
+                return detected;
+            }
+            return want;
+        }
+    }  // namespace
+
+    const CpuFeatures &cpu_features() {
+        static const CpuFeatures features = read_cpu_features();
+        return features;
+    }
+
+    SimdLevel detect_simd_level() {
+#if defined(TANN_WITH_SIMD_DISPATCH)
+        auto &f = cpu_features();
+        if (f.avx512f && f.avx512bw && f.avx512dq && f.avx512vl && f.avx2 && f.fma && f.f16c) {
+            return SimdLevel::SIMD_AVX512;
+        }
+        if (f.avx2 && f.fma && f.f16c) {
+            return SimdLevel::SIMD_AVX2;
+        }
+        if (f.sse4_2 && f.popcnt) {
+            return SimdLevel::SIMD_SSE4;
+        }
+#endif
+        return SimdLevel::SIMD_NATIVE;
+    }
+
+    SimdLevel simd_level() {
+        static const SimdLevel level = env_simd_level(detect_simd_level());
+        return level;
+    }
+
+    const char *simd_level_name(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::SIMD_SSE4:
+                return "sse4";
+            case SimdLevel::SIMD_AVX2:
+                return "avx2";
+            case SimdLevel::SIMD_AVX512:
+                return "avx512";
+            default:
+                return "native";
+        }
+    }
+}  // namespace tann
@@ -0,0 +1,61 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_COMMON_CPU_FEATURES_H_
+#define TANN_COMMON_CPU_FEATURES_H_
+
+namespace tann {
+
+    // features of the running cpu, read by cpuid once.
+    struct CpuFeatures {
+        bool sse4_2{false};
+        bool popcnt{false};
+        bool avx{false};
+        bool avx2{false};
+        bool fma{false};
+        bool f16c{false};
+        bool avx512f{false};
+        bool avx512bw{false};
+        bool avx512dq{false};
+        bool avx512vl{false};
+        bool avx512vnni{false};
+        bool avx512vpopcntdq{false};
+    };
+
+    const CpuFeatures &cpu_features();
+
+    ///////////////////////////////////////////////////
+    // the kernel tiers the distance factory can use,
+    // SIMD_NATIVE is the one built with the library
+    // flags, it is the only one on non x86 builds.
+    enum class SimdLevel {
+        SIMD_NATIVE,
+        SIMD_SSE4,
+        SIMD_AVX2,
+        SIMD_AVX512
+    };
+
+    // the highest tier the cpu runs.
+    SimdLevel detect_simd_level();
+
+    // detect_simd_level, lowered by the env TANN_SIMD_LEVEL
+    // (native, sse4, avx2 or avx512) for testing. A level the
+    // cpu can not run is ignored.
+    SimdLevel simd_level();
+
+    const char *simd_level_name(SimdLevel level);
+
+}  // namespace tann
+
+#endif  // TANN_COMMON_CPU_FEATURES_H_
@@ -0,0 +1,97 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tann/common/epoch.h"
+#include <thread>
+
+namespace tann {
+
+    EpochManager::EpochManager() : _shards(new Shard[kShards]) {
+        for (std::size_t i = 0; i < kShards; ++i) {
+            _shards[i].active[0].store(0, std::memory_order_relaxed);
+            _shards[i].active[1].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    EpochManager::~EpochManager() {
+        for (auto &r: _retired) {
+            r.deleter(r.ptr);
+        }
+    }
+
+    EpochManager::Ticket EpochManager::enter() {
+        static thread_local std::size_t shard = std::hash<std::thread::id>()(std::this_thread::get_id()) % kShards;
+        auto &s = _shards[shard];
+        while (true) {
+            auto e = _epoch.load();
+            s.active[e & 1].fetch_add(1);
+            // the epoch may have moved between the load and the add
+            if (_epoch.load() == e) {
+                return {e, shard};
+            }
+            s.active[e & 1].fetch_sub(1);
+        }
+    }
+
+    void EpochManager::exit(const Ticket &ticket) {
+        _shards[ticket.shard].active[ticket.epoch & 1].fetch_sub(1, std::memory_order_release);
+    }
+
+    void EpochManager::retire(void *ptr, Deleter deleter) {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _retired.push_back({ptr, deleter, _epoch.load()});
+        reclaim_locked();
+    }
+
+    std::size_t EpochManager::reclaim() {
+        std::lock_guard<std::mutex> lk(_mutex);
+        return reclaim_locked();
+    }
+
+    std::size_t EpochManager::pending() const {
+        std::lock_guard<std::mutex> lk(_mutex);
+        return _retired.size();
+    }
+
+    bool EpochManager::drained(uint64_t parity) const {
+        for (std::size_t i = 0; i < kShards; ++i) {
+            if (_shards[i].active[parity].load() != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t EpochManager::reclaim_locked() {
+        // readers are only in epoch e or e - 1, the advance to e + 1 waits
+        // until the e - 1 ones are gone, what was retired before e is free then.
+        auto e = _epoch.load();
+        if (!drained((e - 1) & 1)) {
+            return 0;
+        }
+        std::size_t freed = 0;
+        std::size_t kept = 0;
+        for (auto &r: _retired) {
+            if (r.epoch < e) {
+                r.deleter(r.ptr);
+                ++freed;
+            } else {
+                _retired[kept++] = r;
+            }
+        }
+        _retired.resize(kept);
+        _epoch.store(e + 1);
+        return freed;
+    }
+}  // namespace tann
@@ -0,0 +1,110 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_COMMON_EPOCH_H_
+#define TANN_COMMON_EPOCH_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tann {
+
+    ///////////////////////////////////////////////////////////
+    // epoch based reclamation. Readers announce the epoch they
+    // enter in sharded counters, writers retire memory they
+    // unlinked and it is freed once every reader that entered
+    // at or before the retire epoch has left. Readers never
+    // wait, a reader only costs two atomic adds on its shard.
+    class EpochManager {
+    public:
+        using Deleter = void (*)(void *);
+
+        struct Ticket {
+            uint64_t epoch;
+            std::size_t shard;
+        };
+
+        EpochManager();
+
+        // frees everything retired, no reader may be left
+        ~EpochManager();
+
+        EpochManager(const EpochManager &) = delete;
+
+        EpochManager &operator=(const EpochManager &) = delete;
+
+        [[nodiscard]] Ticket enter();
+
+        void exit(const Ticket &ticket);
+
+        // ptr is unlinked already, readers entering from now on can not
+        // reach it. it is freed by a later retire or reclaim.
+        void retire(void *ptr, Deleter deleter);
+
+        // free what no reader can see and advance the epoch when the
+        // readers of the previous one are gone, returns the number freed.
+        std::size_t reclaim();
+
+        // retired and not yet freed
+        [[nodiscard]] std::size_t pending() const;
+
+    private:
+        static constexpr std::size_t kShards = 64;
+
+        struct alignas(64) Shard {
+            std::atomic<int64_t> active[2];
+        };
+
+        struct Retired {
+            void *ptr;
+            Deleter deleter;
+            uint64_t epoch;
+        };
+
+        std::size_t reclaim_locked();
+
+        bool drained(uint64_t parity) const;
+
+    private:
+        // starts at 2 so epoch - 1 never wraps
+        std::atomic<uint64_t> _epoch{2};
+        std::unique_ptr<Shard[]> _shards;
+        mutable std::mutex _mutex;
+        // guard by _mutex
+        std::vector<Retired> _retired;
+    };
+
+    class EpochGuard {
+    public:
+        explicit EpochGuard(EpochManager *manager) : _manager(manager), _ticket(manager->enter()) {
+        }
+
+        ~EpochGuard() {
+            _manager->exit(_ticket);
+        }
+
+    private:
+        EpochManager *_manager;
+        EpochManager::Ticket _ticket;
+
+        EpochGuard(const EpochGuard &) = delete;
+
+        EpochGuard &operator=(const EpochGuard &) = delete;
+    };
+}  // namespace tann
+
+#endif  // TANN_COMMON_EPOCH_H_
@@ -0,0 +1,208 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tann/common/executor.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace tann {
+
+    namespace {
+        thread_local const Executor *t_executor = nullptr;
+        thread_local std::size_t t_worker = 0;
+
+        struct CpuSlot {
+            int cpu;
+            int node;
+        };
+
+        // "0-3,8-11" as in /sys/devices/system/node/node*/cpulist
+        std::vector<int> parse_cpu_list(const std::string &list) {
+            std::vector<int> cpus;
+            std::stringstream ss(list);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                auto dash = item.find('-');
+                try {
+                    int lo = std::stoi(item.substr(0, dash));
+                    int hi = dash == std::string::npos ? lo : std::stoi(item.substr(dash + 1));
+                    for (int c = lo; c <= hi; ++c) {
+                        cpus.push_back(c);
+                    }
+                } catch (...) {
+                    break;
+                }
+            }
+            return cpus;
+        }
+
+        // the cores the process may run on, numa node by node
+        std::vector<CpuSlot> cpu_layout() {
+            std::vector<CpuSlot> layout;
+#if defined(__linux__)
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+            bool has_mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+            for (int node = 0;; ++node) {
+                std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                if (!in) {
+                    break;
+                }
+                std::string list;
+                std::getline(in, list);
+                for (auto cpu: parse_cpu_list(list)) {
+                    if (!has_mask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+                        layout.push_back({cpu, node});
+                    }
+                }
+            }
+            if (layout.empty() && has_mask) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &allowed)) {
+                        layout.push_back({cpu, 0});
+                    }
+                }
+            }
+#endif
+            if (layout.empty()) {
+                auto n = std::max<unsigned>(1, std::thread::hardware_concurrency());
+                for (unsigned cpu = 0; cpu < n; ++cpu) {
+                    layout.push_back({static_cast<int>(cpu), 0});
+                }
+            }
+            return layout;
+        }
+
+        void pin_to(std::thread &thread, int cpu) {
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+            (void) thread;
+            (void) cpu;
+#endif
+        }
+    }  // namespace
+
+    Executor::Executor(const ExecutorOption &option) {
+        auto layout = cpu_layout();
+        auto n = option.threads == 0 ? layout.size() : option.threads;
+        _workers.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            auto w = std::make_unique<Worker>();
+            w->cpu = layout[i % layout.size()].cpu;
+            w->node = layout[i % layout.size()].node;
+            _workers.push_back(std::move(w));
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            auto &victims = _workers[i]->victims;
+            for (std::size_t j = 1; j < n; ++j) {
+                victims.push_back((i + j) % n);
+            }
+            std::stable_partition(victims.begin(), victims.end(), [&](std::size_t v) {
+                return _workers[v]->node == _workers[i]->node;
+            });
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            _workers[i]->thread = std::thread([this, i]() { run(i); });
+            if (option.pin_threads) {
+                pin_to(_workers[i]->thread, _workers[i]->cpu);
+            }
+        }
+    }
+
+    Executor::~Executor() {
+        {
+            std::lock_guard<std::mutex> lk(_sleep_mutex);
+            _stop = true;
+        }
+        _sleep_cv.notify_all();
+        for (auto &w: _workers) {
+            w->thread.join();
+        }
+    }
+
+    Executor *Executor::default_executor() {
+        static Executor executor;
+        return &executor;
+    }
+
+    std::size_t Executor::current_worker() const {
+        return t_executor == this ? t_worker : _workers.size();
+    }
+
+    void Executor::submit(Task task) {
+        auto index = current_worker();
+        if (index == _workers.size()) {
+            index = _next_queue.fetch_add(1, std::memory_order_relaxed) % _workers.size();
+        }
+        {
+            std::lock_guard<std::mutex> lk(_workers[index]->mutex);
+            _workers[index]->tasks.push_back(std::move(task));
+        }
+        _pending.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lk(_sleep_mutex);
+        }
+        _sleep_cv.notify_one();
+    }
+
+    bool Executor::pop_task(std::size_t index, Task &task) {
+        auto &self = *_workers[index];
+        {
+            std::lock_guard<std::mutex> lk(self.mutex);
+            if (!self.tasks.empty()) {
+                task = std::move(self.tasks.back());
+                self.tasks.pop_back();
+                return true;
+            }
+        }
+        for (auto v: self.victims) {
+            auto &victim = *_workers[v];
+            std::lock_guard<std::mutex> lk(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Executor::run(std::size_t index) {
+        t_executor = this;
+        t_worker = index;
+        Task task;
+        while (true) {
+            if (pop_task(index, task)) {
+                _pending.fetch_sub(1);
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> lk(_sleep_mutex);
+            _sleep_cv.wait(lk, [this] { return _stop || _pending.load() > 0; });
+            if (_stop && _pending.load() == 0) {
+                return;
+            }
+        }
+    }
+}  // namespace tann
@@ -0,0 +1,206 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_COMMON_EXECUTOR_H_
+#define TANN_COMMON_EXECUTOR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tann {
+
+    struct ExecutorOption {
+        // worker threads, 0 is the hardware concurrency
+        std::size_t threads{0};
+        // pin worker i to the i-th allowed core, cores are taken numa
+        // node by node so neighbour workers share a node.
+        bool pin_threads{false};
+    };
+
+    //////////////////////////////////////////
+    // work stealing thread pool shared by the indexes. Every worker pops
+    // its own deque from the back and steals from the front of the others,
+    // workers on its own numa node first. By default all indexes of the
+    // process share default_executor(), so several of them do not start
+    // more threads than cores.
+    class Executor {
+    public:
+        using Task = std::function<void()>;
+
+        explicit Executor(const ExecutorOption &option = ExecutorOption());
+
+        // runs the tasks already submitted, then joins the workers
+        ~Executor();
+
+        // process wide executor with one worker per core
+        static Executor *default_executor();
+
+        [[nodiscard]] std::size_t size() const {
+            return _workers.size();
+        }
+
+        // the workers and the calling thread
+        [[nodiscard]] std::size_t concurrency() const {
+            return _workers.size() + 1;
+        }
+
+        // threads a parallel_for over n ids runs on, the thread ids it
+        // hands out are below it. Size per thread state with it.
+        [[nodiscard]] std::size_t loop_concurrency(std::size_t n, std::size_t max_threads = 0) const {
+            auto threads = std::min(concurrency(), n);
+            if (max_threads != 0) {
+                threads = std::min(threads, max_threads);
+            }
+            return std::max<std::size_t>(threads, 1);
+        }
+
+        // index of the calling worker, size() for other threads
+        [[nodiscard]] std::size_t current_worker() const;
+
+        // task must not throw
+        void submit(Task task);
+
+        // run fn(id, thread_id) for id in [start, end) on at most max_threads
+        // threads, 0 is no limit. The calling thread runs a share too, so it
+        // may be called from a task. thread_id is below
+        // loop_concurrency(end - start, max_threads) and unique among the
+        // threads running this loop. The first exception thrown by fn stops
+        // the loop and is rethrown to the caller.
+        template<class Function>
+        void parallel_for(std::size_t start, std::size_t end, Function fn, std::size_t max_threads = 0);
+
+    private:
+        struct ParallelLoop {
+            std::atomic<std::size_t> next;
+            std::size_t end;
+            std::size_t chunk;
+            std::atomic<std::size_t> running{0};
+            // the next thread id, one per thread entering the loop
+            std::atomic<std::size_t> slots{0};
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::exception_ptr error;
+
+            ParallelLoop(std::size_t s, std::size_t e, std::size_t c) : next(s), end(e), chunk(c) {}
+
+            bool claim(std::size_t &begin, std::size_t &stop) {
+                begin = next.fetch_add(chunk);
+                if (begin >= end) {
+                    return false;
+                }
+                stop = std::min(end, begin + chunk);
+                return true;
+            }
+
+            void fail(std::exception_ptr e) {
+                std::lock_guard<std::mutex> lk(mutex);
+                if (!error) {
+                    error = e;
+                }
+                next.store(end);
+            }
+
+            void leave() {
+                if (running.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lk(mutex);
+                    cv.notify_all();
+                }
+            }
+
+            // a thread that claims a chunk entered before the caller's
+            // last failed claim, so running is 0 only when all are done.
+            void wait() {
+                std::unique_lock<std::mutex> lk(mutex);
+                cv.wait(lk, [this] { return running.load() == 0; });
+            }
+        };
+
+        template<class Function>
+        static void run_loop(ParallelLoop &loop, Function &fn) {
+            loop.running.fetch_add(1);
+            auto tid = loop.slots.fetch_add(1);
+            std::size_t begin;
+            std::size_t stop;
+            while (loop.claim(begin, stop)) {
+                try {
+                    for (std::size_t id = begin; id < stop; ++id) {
+                        fn(id, tid);
+                    }
+                } catch (...) {
+                    loop.fail(std::current_exception());
+                }
+            }
+            loop.leave();
+        }
+
+        struct alignas(64) Worker {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+            // other workers to steal from, same node first
+            std::vector<std::size_t> victims;
+            int cpu{-1};
+            int node{0};
+            std::thread thread;
+        };
+
+        void run(std::size_t index);
+
+        bool pop_task(std::size_t index, Task &task);
+
+    private:
+        std::vector<std::unique_ptr<Worker>> _workers;
+        std::atomic<std::size_t> _pending{0};
+        std::atomic<std::size_t> _next_queue{0};
+        std::mutex _sleep_mutex;
+        std::condition_variable _sleep_cv;
+        bool _stop{false};
+    };
+
+    template<class Function>
+    void Executor::parallel_for(std::size_t start, std::size_t end, Function fn, std::size_t max_threads) {
+        if (start >= end) {
+            return;
+        }
+        auto helpers = loop_concurrency(end - start, max_threads) - 1;
+        if (helpers == 0) {
+            for (std::size_t id = start; id < end; ++id) {
+                fn(id, 0);
+            }
+            return;
+        }
+        // small chunks balance the load, the claim is one fetch_add
+        auto chunk = std::max<std::size_t>(1, (end - start) / ((helpers + 1) * 8));
+        auto loop = std::make_shared<ParallelLoop>(start, end, chunk);
+        for (std::size_t i = 0; i < helpers; ++i) {
+            // a helper starting after the loop is done only sees the
+            // claim fail, fn is not touched then.
+            submit([loop, &fn]() { run_loop(*loop, fn); });
+        }
+        run_loop(*loop, fn);
+        loop->wait();
+        if (loop->error) {
+            std::rethrow_exception(loop->error);
+        }
+    }
+}  // namespace tann
+
+#endif  // TANN_COMMON_EXECUTOR_H_
@@ -0,0 +1,108 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tann/common/latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace tann {
+
+    namespace {
+        // threads take the shards round robin
+        std::atomic<std::size_t> g_next_shard{0};
+        thread_local std::size_t t_shard = g_next_shard.fetch_add(1, std::memory_order_relaxed);
+    }  // namespace
+
+    uint64_t HistogramSnapshot::percentile(double q) const {
+        if (count == 0) {
+            return 0;
+        }
+        q = std::min(1.0, std::max(0.0, q));
+        auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+        uint64_t seen = 0;
+        for (std::size_t b = 0; b < buckets.size(); ++b) {
+            seen += buckets[b];
+            if (seen >= rank) {
+                return std::min(LatencyHistogram::bucket_upper(b), max);
+            }
+        }
+        return max;
+    }
+
+    LatencyHistogram::Shard::Shard() {
+        for (auto &b: buckets) {
+            b.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t LatencyHistogram::bucket_of(uint64_t value) {
+        if (value < kSubBuckets) {
+            return static_cast<std::size_t>(value);
+        }
+        std::size_t exponent = 63 - __builtin_clzll(value);
+        if (exponent > kMaxExponent) {
+            return kBuckets - 1;
+        }
+        auto sub = (value >> (exponent - kSubBits)) & (kSubBuckets - 1);
+        return (exponent - kSubBits + 1) * kSubBuckets + static_cast<std::size_t>(sub);
+    }
+
+    uint64_t LatencyHistogram::bucket_upper(std::size_t bucket) {
+        if (bucket < kSubBuckets) {
+            return bucket;
+        }
+        if (bucket >= kBuckets - 1) {
+            return UINT64_MAX;
+        }
+        auto exponent = bucket / kSubBuckets + kSubBits - 1;
+        auto sub = bucket % kSubBuckets;
+        auto width = uint64_t(1) << (exponent - kSubBits);
+        return ((kSubBuckets + sub) << (exponent - kSubBits)) + width - 1;
+    }
+
+    void LatencyHistogram::record(int64_t ns) {
+        auto value = static_cast<uint64_t>(std::max<int64_t>(0, ns));
+        auto &s = _shards[t_shard % kShards];
+        s.buckets[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+        s.sum.fetch_add(value, std::memory_order_relaxed);
+        auto m = s.max.load(std::memory_order_relaxed);
+        while (value > m && !s.max.compare_exchange_weak(m, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    HistogramSnapshot LatencyHistogram::snapshot() const {
+        HistogramSnapshot snap;
+        snap.buckets.assign(kBuckets, 0);
+        for (auto &s: _shards) {
+            for (std::size_t b = 0; b < kBuckets; ++b) {
+                auto n = s.buckets[b].load(std::memory_order_relaxed);
+                snap.buckets[b] += n;
+                snap.count += n;
+            }
+            snap.sum += s.sum.load(std::memory_order_relaxed);
+            snap.max = std::max(snap.max, s.max.load(std::memory_order_relaxed));
+        }
+        return snap;
+    }
+
+    void LatencyHistogram::reset() {
+        for (auto &s: _shards) {
+            for (auto &b: s.buckets) {
+                b.store(0, std::memory_order_relaxed);
+            }
+            s.sum.store(0, std::memory_order_relaxed);
+            s.max.store(0, std::memory_order_relaxed);
+        }
+    }
+}  // namespace tann
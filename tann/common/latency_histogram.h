@@ -0,0 +1,80 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_COMMON_LATENCY_HISTOGRAM_H_
+#define TANN_COMMON_LATENCY_HISTOGRAM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tann {
+
+    struct HistogramSnapshot {
+        uint64_t count{0};
+        uint64_t sum{0};
+        uint64_t max{0};
+        // samples per bucket, see LatencyHistogram::bucket_of
+        std::vector<uint64_t> buckets;
+
+        [[nodiscard]] double mean() const {
+            return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+        }
+
+        // upper bound of the bucket holding quantile q in [0, 1], 0 when empty
+        [[nodiscard]] uint64_t percentile(double q) const;
+    };
+
+    //////////////////////////////////////////
+    // hdr style histogram of nanoseconds. Values below 16 have a bucket
+    // each, above it every power of two is split into 16 linear buckets,
+    // so a bucket is within 1/16 of its values, up to 2^41 ns where the
+    // last bucket takes the rest. record is a few relaxed adds on the
+    // shard of the calling thread, no lock is taken. reset racing with
+    // record may lose those samples.
+    class LatencyHistogram {
+    public:
+        static constexpr std::size_t kSubBits = 4;
+        static constexpr std::size_t kSubBuckets = std::size_t(1) << kSubBits;
+        static constexpr std::size_t kMaxExponent = 40;
+        static constexpr std::size_t kBuckets = (kMaxExponent - kSubBits + 2) * kSubBuckets;
+        static constexpr std::size_t kShards = 4;
+
+        void record(int64_t ns);
+
+        [[nodiscard]] HistogramSnapshot snapshot() const;
+
+        void reset();
+
+        [[nodiscard]] static std::size_t bucket_of(uint64_t value);
+
+        // largest value of the bucket
+        [[nodiscard]] static uint64_t bucket_upper(std::size_t bucket);
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> buckets[kBuckets];
+            std::atomic<uint64_t> sum{0};
+            std::atomic<uint64_t> max{0};
+
+            Shard();
+        };
+
+    private:
+        Shard _shards[kShards];
+    };
+}  // namespace tann
+
+#endif  // TANN_COMMON_LATENCY_HISTOGRAM_H_
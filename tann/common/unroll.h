@@ -0,0 +1,37 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_COMMON_UNROLL_H_
+#define TANN_COMMON_UNROLL_H_
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace tann {
+
+    template<std::size_t... I, typename F>
+    inline void unroll_impl(std::index_sequence<I...>, F &&f) {
+        (f(std::integral_constant<std::size_t, I>{}), ...);
+    }
+
+    // call f(std::integral_constant<std::size_t, k>{}) for k in [0, N),
+    // expanded at compile time.
+    template<std::size_t N, typename F>
+    inline void unroll(F &&f) {
+        unroll_impl(std::make_index_sequence<N>{}, std::forward<F>(f));
+    }
+}  // namespace tann
+
+#endif  // TANN_COMMON_UNROLL_H_
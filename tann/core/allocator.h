@@ -16,12 +16,13 @@
 namespace tann {
     class Allocator {
     public:
-        static constexpr std::size_t requires_alignment = turbo::simd::default_arch::requires_alignment();
+        static constexpr bool requires_alignment = true;
         // If an algorithm has a requirement that some data be aligned to a certain
         // boundary it can use this function to indicate that requirement. Currently,
-        // we are setting it to  Arch::alignment() for bytes alignment, and the dim alignment is set
-        // to alignment_bytes/sizeof(T)
-        static constexpr std::size_t alignment_bytes = turbo::simd::default_arch::alignment();
+        // we are setting it to the alignment of the widest simd tier the distance
+        // kernels may dispatch to (avx512), not the compile time Arch::alignment(),
+        // and the dim alignment is set to alignment_bytes/sizeof(T)
+        static constexpr std::size_t alignment_bytes = 64;
 
         typedef turbo::simd::aligned_allocator<uint8_t, alignment_bytes> allocator_type;
         static allocator_type alloc;
@@ -35,8 +35,20 @@ namespace tann {
 
         virtual turbo::Status add_vector(WorkSpace*ws, location_t lid) = 0;
 
+        // add the vectors already set in the store at lids, the result
+        // must only depend on the order of lids.
+        virtual turbo::Status add_vectors(turbo::Span<location_t> lids) = 0;
+
         virtual turbo::Status remove_vector(location_t lid) = 0;
 
+        // grow the engine's internal structures to hold max_elements
+        // locations, called under the exclusive update lock.
+        virtual turbo::Status reset_max_elements(std::size_t max_elements) = 0;
+
+        // make the engine read only so it may compact its memory,
+        // support_dynamic may turn false after it.
+        virtual turbo::Status freeze() = 0;
+
         virtual WorkSpace* make_workspace() = 0;
 
         virtual void setup_workspace(WorkSpace*ws) = 0;
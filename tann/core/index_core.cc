@@ -13,20 +13,45 @@
 //
 #include "tann/core/index_core.h"
 #include "tann/core/vector_store_option.h"
+#include "tann/common/utility.h"
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <thread>
+#include <unordered_set>
 
 namespace tann {
 
     [[nodiscard]] turbo::Status IndexCore::initialize(const IndexOption &option, const std::any &core_option) {
         TLOG_INFO("initialize index core");
         _base_option = option;
+        if(_base_option.binary_quantization) {
+            auto dt = _base_option.data_type;
+            if(dt != DataType::DT_FLOAT && dt != DataType::DT_FLOAT16 && dt != DataType::DT_BFLOAT16 &&
+               dt != DataType::DT_INT8) {
+                return turbo::InvalidArgumentError("binary quantization needs float, float16, bfloat16 or int8 data");
+            }
+            _base_option.rerank_factor = std::max<size_t>(1, _base_option.rerank_factor);
+        }
         auto r = _vector_space.init(_base_option.dimension, _base_option.metric, _base_option.data_type);
         if (!r.ok()) {
             return r;
         }
+        if(_base_option.executor_threads != 0) {
+            ExecutorOption executor_option;
+            executor_option.threads = _base_option.executor_threads;
+            executor_option.pin_threads = _base_option.pin_threads;
+            _own_executor = std::make_unique<Executor>(executor_option);
+            _executor = _own_executor.get();
+        } else {
+            _executor = Executor::default_executor();
+        }
         VectorStoreOption store_option;
         store_option.batch_size = _base_option.batch_size;
         store_option.max_elements = _base_option.max_elements;
         store_option.enable_replace_vacant = _base_option.enable_replace_vacant;
+        store_option.binary_quantization = _base_option.binary_quantization;
+        store_option.executor = _executor;
         r = _data_store.initialize(&_vector_space, store_option);
         if (!r.ok()) {
             return r;
@@ -45,14 +70,16 @@ namespace tann {
             return r;
         }
         TLOG_INFO(" engine initialize done");
-        for(size_t i = 0; i < option.number_thread; i++) {
-            auto ws = _engine->make_workspace();
-            if(!ws) {
-                return turbo::ResourceExhaustedError("no memory");
-            }
-            _ws_pool.push(ws);
+        auto max_workspaces = option.max_workspaces;
+        if(max_workspaces == 0) {
+            max_workspaces = 2 * std::max<size_t>(1, std::thread::hardware_concurrency());
         }
-        TLOG_INFO("work space pool size:{}", _ws_pool.size());
+        auto engine = _engine.get();
+        r = _ws_pool.initialize([engine]() { return engine->make_workspace(); }, option.number_thread, max_workspaces);
+        if (!r.ok()) {
+            return r;
+        }
+        TLOG_INFO("work space pool size:{} max:{}", _ws_pool.size(), _ws_pool.max_size());
         is_initial = true;
         return turbo::OkStatus();
     }
@@ -62,39 +89,146 @@ namespace tann {
         assert(is_initial);
         WorkSpaceGuard guard(_ws_pool);
         auto ws = guard.work_space();
-        ws->set_up(option, data_point);
+        ws->set_up(option, data_point, _vector_space.distance_factor.get());
 
         if(!option.is_normalized && _vector_space.distance_factor->preprocessing_required()) {
             _vector_space.distance_factor->preprocess_base_points(ws->query_view, _vector_space.dimension);
         }
         // lock label for below operation
         LabelLockGuard label_guard(&_data_store, label);
+        // a vacant slot is replaced under the shared update lock, searches
+        // go on reading the old vector until the new one is published and
+        // the engine rewires the links under its node locks, like the
+        // update of HnswEngine::update_vector_internal.
+        if(option.replace_deleted) {
+            // only the lock wait is split out of kInsert
+            ws->mark(LatencyPhase::kInsert);
+            UpdateSharedLockGuard read_guard(&_data_store);
+            ws->mark(LatencyPhase::kInsertLockWait);
+            if(!_engine->support_dynamic()) {
+                return turbo::FailedPreconditionError("index is read only");
+            }
+            auto vacant = _data_store.get_vacant(label);
+            if(vacant.ok()) {
+                turbo::Status r;
+                {
+                    EpochGuard epoch_guard(_data_store.epoch());
+                    _data_store.replace_vector(vacant.value(), ws->query_view);
+                    ws->is_update = true;
+                    r = _engine->add_vector(ws, vacant.value());
+                }
+                if(!r.ok()) {
+                    // the slot goes back to the vacant ones, label is not added
+                    _data_store.return_vacant(vacant.value(), label);
+                    return r;
+                }
+                // free the buffer replaced here now, not at the next retire
+                _data_store.epoch()->reclaim();
+                _statistics.add_inserts(1);
+                return finish_insert(ws);
+            }
+        }
         // guard for vector data write
+        ws->mark(LatencyPhase::kInsert);
         UpdateLockGuard write_guard(&_data_store);
-        location_t  lid = constants::kUnknownLocation;
-        // try get vacant
-        bool is_vacant = false;
-        if(option.replace_deleted) {
-            lid = _data_store.get_vacant(label).value_or(constants::kUnknownLocation);
-            is_vacant = true;
+        ws->mark(LatencyPhase::kInsertLockWait);
+        if(!_engine->support_dynamic()) {
+            return turbo::FailedPreconditionError("index is read only");
         }
-        if(lid == constants::kUnknownLocation) {
-            is_vacant = false;
-            auto rv = _data_store.prefer_add_vector(label);
-            if(!rv.ok()) {
-                return rv.status();
+        // no reader is left, put the replaced vectors back in place
+        _data_store.fold_replaced();
+        if(_base_option.enable_auto_grow && _data_store.current_index() >= _data_store.max_elements()) {
+            auto gr = reserve_impl(_data_store.max_elements() + _base_option.grow_step);
+            if(!gr.ok()) {
+                return gr;
             }
-            lid = rv.value();
         }
+        auto rv = _data_store.prefer_add_vector(label);
+        if(!rv.ok()) {
+            return rv.status();
+        }
+        auto lid = rv.value();
         // set data to data store
         _data_store.set_vector(lid, ws->query_view);
-        ws->is_update = is_vacant;
+        ws->is_update = false;
         auto r= _engine->add_vector(ws, lid);
         if(!r.ok()) {
             return r;
         }
+        _statistics.add_inserts(1);
+        return finish_insert(ws);
+    }
 
-        return InsertResult{ws->timer.elapsed_nano()};
+    turbo::ResultStatus<InsertResult>
+    IndexCore::add_vectors(const WriteOption &option, turbo::Span<uint8_t> data, turbo::Span<label_type> labels) {
+        assert(is_initial);
+        turbo::StopWatcher timer;
+        auto vsize = _vector_space.vector_byte_size;
+        if(data.size() != labels.size() * vsize) {
+            return turbo::InvalidArgumentError("data size {} mismatch {} vectors of {} bytes", data.size(),
+                                               labels.size(), vsize);
+        }
+        if(labels.empty()) {
+            return InsertResult{timer.elapsed_nano()};
+        }
+        WorkSpaceGuard guard(_ws_pool);
+        auto ws = guard.work_space();
+        // guard for vector data write
+        auto wait_start = timer.elapsed_nano();
+        UpdateLockGuard write_guard(&_data_store);
+        auto lock_wait = timer.elapsed_nano() - wait_start;
+        if(!_engine->support_dynamic()) {
+            return turbo::FailedPreconditionError("index is read only");
+        }
+        // check all labels before touching the store
+        std::unordered_set<label_type> seen;
+        seen.reserve(labels.size());
+        for(auto label : labels) {
+            if(_data_store.exists_label(label) || !seen.insert(label).second) {
+                return turbo::AlreadyExistsError("label {} already exists", label);
+            }
+        }
+        auto need = _data_store.current_index() + labels.size();
+        if(need > _data_store.max_elements()) {
+            if(!_base_option.enable_auto_grow) {
+                return turbo::ResourceExhaustedError("need {} elements, max elements {}", need, _data_store.max_elements());
+            }
+            auto step = std::max<std::size_t>(1, _base_option.grow_step);
+            auto gr = reserve_impl((need + step - 1) / step * step);
+            if(!gr.ok()) {
+                return gr;
+            }
+        }
+        // the batch is appended from first on
+        auto first = static_cast<location_t>(_data_store.current_index());
+        std::vector<location_t> lids;
+        lids.reserve(labels.size());
+        for(size_t i = 0; i < labels.size(); ++i) {
+            ws->set_up(option, data.subspan(i * vsize, vsize), _vector_space.distance_factor.get());
+            if(!option.is_normalized && _vector_space.distance_factor->preprocessing_required()) {
+                _vector_space.distance_factor->preprocess_base_points(ws->query_view, _vector_space.dimension);
+            }
+            auto rv = _data_store.prefer_add_vector(labels[i]);
+            if(!rv.ok()) {
+                // nothing is linked yet, the batch leaves no trace
+                _data_store.drop_appended(first, false);
+                return rv.status();
+            }
+            _data_store.set_vector(rv.value(), ws->query_view);
+            lids.push_back(rv.value());
+        }
+        auto r = _engine->add_vectors(turbo::Span<location_t>(lids.data(), lids.size()));
+        if(!r.ok()) {
+            // part of the batch may be linked, the slots stay deleted and
+            // the labels can be added again
+            _data_store.drop_appended(first, true);
+            return r;
+        }
+        _statistics.add_inserts(lids.size());
+        auto cost = timer.elapsed_nano();
+        record_latency(LatencyPhase::kInsert, cost);
+        record_latency(LatencyPhase::kInsertLockWait, lock_wait);
+        return InsertResult{cost};
     }
 
     turbo::Status IndexCore::remove_vector(const label_type &label) {
@@ -105,27 +239,90 @@ namespace tann {
         }
         auto lid = rs.value();
         auto s = _engine->remove_vector(lid);
+        if(s.ok()) {
+            _statistics.add_delete();
+        }
         return s;
     }
 
+    turbo::Status IndexCore::reserve(std::size_t max_elements) {
+        assert(is_initial);
+        UpdateLockGuard write_guard(&_data_store);
+        return reserve_impl(max_elements);
+    }
+
+    turbo::Status IndexCore::freeze() {
+        assert(is_initial);
+        UpdateLockGuard write_guard(&_data_store);
+        return _engine->freeze();
+    }
+
+    turbo::Status IndexCore::reserve_impl(std::size_t max_elements) {
+        if(max_elements <= _data_store.max_elements()) {
+            return turbo::OkStatus();
+        }
+        if(max_elements >= constants::kUnknownLocation) {
+            return turbo::ResourceExhaustedError("max elements {} overflow location type", max_elements);
+        }
+        // engine first, store capacity is the one add_vector checks
+        auto r = _engine->reset_max_elements(max_elements);
+        if(!r.ok()) {
+            return r;
+        }
+        _data_store.reset_max_elements(static_cast<uint32_t>(max_elements));
+        _base_option.max_elements = max_elements;
+        return turbo::OkStatus();
+    }
+
     turbo::Status IndexCore::search_vector(SearchContext *sc, SearchResult &results) {
+        return search_vector(sc, results, 0);
+    }
+
+    turbo::Status IndexCore::search_vector(SearchContext *sc, SearchResult &results, int64_t queued_ns) {
+        return search_impl(sc, results, queued_ns, true);
+    }
+
+    turbo::Status IndexCore::search_impl(SearchContext *sc, SearchResult &results, int64_t queued_ns, bool record) {
         // guard for vector data update
         WorkSpaceGuard guard(_ws_pool);
         auto ws = guard.work_space();
-        ws->set_up(sc);
+        ws->set_up(sc, _vector_space.distance_factor.get(), queued_ns);
+        if(sc->trace) {
+            sc->trace->clear();
+        }
         if(!sc->is_normalized && _vector_space.distance_factor->preprocessing_required()) {
             _vector_space.distance_factor->preprocess_base_points(ws->query_view, _vector_space.dimension);
         }
+        if(ws->search_list == 0) {
+            ws->search_list = _search_list.load(std::memory_order_relaxed);
+        }
+        // search on the codes for more candidates, re-ranked below
+        if(_data_store.has_codes()) {
+            ws->query_code.resize(_data_store.code_size());
+            _data_store.encode(ws->query_view, ws->query_code.data());
+            ws->k = sc->k * _base_option.rerank_factor;
+            ws->best_l_nodes.reserve(ws->k);
+        }
         _engine->setup_workspace(ws);
+        ws->mark(LatencyPhase::kSearchPreprocess);
         UpdateSharedLockGuard write_guard(&_data_store);
-       auto r = _engine->search_vector(ws);
-       if(!r.ok()) {
-           return r;
-       }
+        ws->mark(LatencyPhase::kSearchLockWait);
+        // vacant slots may be replaced while we read them
+        EpochGuard epoch_guard(_data_store.epoch());
+        // the engine marks the descent and base search
+        auto r = _engine->search_vector(ws);
+        if(!r.ok()) {
+            return r;
+        }
+        if(_data_store.has_codes()) {
+            rerank(ws, sc->k);
+        }
 
         auto rsize = ws->best_l_nodes.size();
         for (int i = 0; i < rsize; ++i) {
-            results.results.emplace_back(ws->best_l_nodes[i].distance, ws->best_l_nodes[i].label);
+            results.results.emplace_back(
+                    _vector_space.distance_factor->rank_to_distance(ws->best_l_nodes[i].distance),
+                    ws->best_l_nodes[i].label);
         }
         if(sc->get_raw_vector) {
             results.vectors.resize(rsize);
@@ -137,10 +334,220 @@ namespace tann {
                 results.vectors[i] = std::move(tmp);
             }
         }
-        results.cost_ns = ws->timer.elapsed_nano();
+        results.truncated = ws->truncated;
+        ws->mark(LatencyPhase::kSearchMaterialize);
+        results.cost_ns = ws->phase_mark_ns;
+        if(record) {
+            _statistics.add_search(ws->hops, ws->distance_computations, ws->truncated);
+            record_latency(LatencyPhase::kSearch, results.cost_ns);
+            for(auto phase : {LatencyPhase::kSearchPreprocess, LatencyPhase::kSearchLockWait,
+                              LatencyPhase::kSearchDescent, LatencyPhase::kSearchBase,
+                              LatencyPhase::kSearchMaterialize}) {
+                record_latency(phase, ws->phase_ns[static_cast<std::size_t>(phase)]);
+            }
+        }
+        if(sc->trace) {
+            finish_trace(ws, sc->trace);
+        }
         return turbo::OkStatus();
     }
 
+    void IndexCore::finish_trace(WorkSpace *ws, SearchTrace *trace) const {
+        std::copy(std::begin(ws->phase_ns), std::end(ws->phase_ns), std::begin(trace->phase_ns));
+        trace->phase_ns[static_cast<std::size_t>(LatencyPhase::kSearch)] = ws->phase_mark_ns;
+        trace->truncated = ws->truncated;
+        // the engines searched on code distances, leave them as they are
+        if(!_data_store.has_codes()) {
+            for(auto &v : trace->visits) {
+                v.distance = _vector_space.distance_factor->rank_to_distance(v.distance);
+            }
+        }
+    }
+
+    InsertResult IndexCore::finish_insert(WorkSpace *ws) {
+        auto cost = ws->timer.elapsed_nano();
+        record_latency(LatencyPhase::kInsert, cost);
+        record_latency(LatencyPhase::kInsertLockWait, ws->phase_ns[static_cast<std::size_t>(LatencyPhase::kInsertLockWait)]);
+        return InsertResult{cost};
+    }
+
+    HistogramSnapshot IndexCore::latency(LatencyPhase phase) const {
+        return _latency[static_cast<std::size_t>(phase)].snapshot();
+    }
+
+    void IndexCore::reset_latency() {
+        for(auto &h : _latency) {
+            h.reset();
+        }
+    }
+
+    Statistics IndexCore::statistics() const {
+        auto st = _statistics.snapshot();
+        st.workspace_waits = _ws_pool.waits();
+        return st;
+    }
+
+    turbo::Status IndexCore::search_vectors(turbo::Span<SearchContext *> contexts, turbo::Span<SearchResult> results) {
+        assert(is_initial);
+        if(contexts.size() != results.size()) {
+            return turbo::InvalidArgumentError("{} queries but {} results", contexts.size(), results.size());
+        }
+        std::vector<turbo::Status> status(contexts.size());
+        _executor->parallel_for(0, contexts.size(), [&](size_t i, size_t) {
+            status[i] = search_vector(contexts[i], results[i]);
+        });
+        for(auto &s : status) {
+            if(!s.ok()) {
+                return s;
+            }
+        }
+        return turbo::OkStatus();
+    }
+
+    void IndexCore::rerank(WorkSpace *ws, std::size_t k) const {
+        auto &exact = ws->rerank_nodes;
+        exact.clear();
+        exact.reserve(k);
+        for(size_t i = 0; i < ws->best_l_nodes.size(); ++i) {
+            auto &n = ws->best_l_nodes[i];
+            exact.insert({_data_store.get_distance(ws->query_view, ws->query_norm, n.lid), n.label, n.lid});
+        }
+        ws->best_l_nodes.swap(exact);
+    }
+
+    turbo::ResultStatus<TuneResult> IndexCore::tune_search_list(const TuneOption &option, turbo::Span<uint8_t> queries) {
+        assert(is_initial);
+        auto vsize = _vector_space.vector_byte_size;
+        if(option.k == 0 || option.max_search_list < option.k) {
+            return turbo::InvalidArgumentError("bad k {} max search list {}", option.k, option.max_search_list);
+        }
+        if(queries.size() % vsize != 0) {
+            return turbo::InvalidArgumentError("query size {} is not times of {}", queries.size(), vsize);
+        }
+        if(_data_store.size() == 0) {
+            return turbo::FailedPreconditionError("can not tune empty index");
+        }
+        // queries, drawn from the index are preprocessed already
+        bool is_normalized = queries.empty();
+        std::vector<std::vector<uint8_t>> qs;
+        if(!queries.empty()) {
+            for(size_t i = 0; i < queries.size(); i += vsize) {
+                qs.emplace_back(queries.data() + i, queries.data() + i + vsize);
+            }
+        } else {
+            UpdateSharedLockGuard read_guard(&_data_store);
+            EpochGuard epoch_guard(_data_store.epoch());
+            std::mt19937 rng(option.random_seed);
+            std::uniform_int_distribution<location_t> dist(0, _data_store.current_index() - 1);
+            size_t tries = 0;
+            while(qs.size() < option.sample_size && tries++ < option.sample_size * 10) {
+                auto lid = dist(rng);
+                if(_data_store.is_deleted(lid)) {
+                    continue;
+                }
+                std::vector<uint8_t> q(vsize);
+                auto sp = to_span<uint8_t>(q);
+                _data_store.copy_vector(lid, sp);
+                qs.push_back(std::move(q));
+            }
+        }
+        // ground truth by the flat engine on the same store
+        std::unique_ptr<Engine> flat(create_index_core(EngineType::ENGINE_FLAT, {}));
+        if(!flat) {
+            return turbo::UnavailableError("no flat engine");
+        }
+        auto r = flat->initialize(_base_option, {}, &_data_store);
+        if(!r.ok()) {
+            return r;
+        }
+        std::unique_ptr<WorkSpace> fws(flat->make_workspace());
+        std::vector<std::vector<label_type>> truth(qs.size());
+        for(size_t i = 0; i < qs.size(); ++i) {
+            SearchContext sc(qs[i]);
+            sc.k = option.k;
+            sc.is_normalized = is_normalized;
+            fws->set_up(&sc, _vector_space.distance_factor.get());
+            if(!sc.is_normalized && _vector_space.distance_factor->preprocessing_required()) {
+                _vector_space.distance_factor->preprocess_base_points(fws->query_view, _vector_space.dimension);
+            }
+            flat->setup_workspace(fws.get());
+            {
+                UpdateSharedLockGuard read_guard(&_data_store);
+                EpochGuard epoch_guard(_data_store.epoch());
+                r = flat->search_vector(fws.get());
+            }
+            if(!r.ok()) {
+                return r;
+            }
+            for(size_t j = 0; j < fws->best_l_nodes.size(); ++j) {
+                truth[i].push_back(fws->best_l_nodes[j].label);
+            }
+            fws->clear();
+        }
+        // recall grows with the search list, binary search the smallest one
+        TuneResult result;
+        auto rs = recall_at(option, qs, is_normalized, truth, option.max_search_list);
+        if(!rs.ok()) {
+            return rs.status();
+        }
+        result.search_list = option.max_search_list;
+        result.recall = rs.value();
+        result.reached = result.recall >= option.target_recall;
+        if(!result.reached) {
+            TLOG_WARN("max search list {} only reaches recall {}", option.max_search_list, result.recall);
+            return result;
+        }
+        size_t lo = option.k;
+        size_t hi = option.max_search_list;
+        while(lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            rs = recall_at(option, qs, is_normalized, truth, mid);
+            if(!rs.ok()) {
+                return rs.status();
+            }
+            if(rs.value() >= option.target_recall) {
+                hi = mid;
+                result.search_list = mid;
+                result.recall = rs.value();
+            } else {
+                lo = mid + 1;
+            }
+        }
+        TLOG_INFO("tune search list to {} recall {}", result.search_list, result.recall);
+        _search_list.store(result.search_list, std::memory_order_relaxed);
+        return result;
+    }
+
+    turbo::ResultStatus<double>
+    IndexCore::recall_at(const TuneOption &option, const std::vector<std::vector<uint8_t>> &queries,
+                         bool is_normalized, const std::vector<std::vector<label_type>> &truth,
+                         std::size_t search_list) {
+        size_t hit = 0;
+        size_t total = 0;
+        for(size_t i = 0; i < queries.size(); ++i) {
+            SearchContext sc(queries[i]);
+            sc.k = option.k;
+            sc.search_list = search_list;
+            sc.is_normalized = is_normalized;
+            SearchResult result;
+            // tuning searches stay out of the statistics and latency
+            auto r = search_impl(&sc, result, 0, false);
+            if(!r.ok()) {
+                return r;
+            }
+            for(auto &label : truth[i]) {
+                for(auto &res : result.results) {
+                    if(res.second == label) {
+                        ++hit;
+                        break;
+                    }
+                }
+            }
+            total += truth[i].size();
+        }
+        return total == 0 ? 1.0 : static_cast<double>(hit) / static_cast<double>(total);
+    }
+
     turbo::Status IndexCore::save_index(const std::string &path, const SerializeOption &option) {
         turbo::SequentialWriteFile file;
         auto r = file.open(path);
@@ -157,6 +564,11 @@ namespace tann {
         if(!r.ok()) {
             return r;
         }
+        // index metadata
+        r = write_binary_pod(file, search_list());
+        if(!r.ok()) {
+            return r;
+        }
         return turbo::OkStatus();
     }
 
@@ -176,6 +588,25 @@ namespace tann {
         if(!r.ok()) {
             return r;
         }
+        // index metadata, files saved before tuning was added end here
+        std::size_t search_list = 0;
+        auto rs = file.read((char *) &search_list, sizeof(search_list));
+        if(!rs.ok()) {
+            return rs.status();
+        }
+        if(rs.value() != 0 && rs.value() != sizeof(search_list)) {
+            return turbo::DataLossError("not enough data");
+        }
+        _search_list.store(search_list, std::memory_order_relaxed);
+        // the engine took the capacity of the loaded graph, bring it up to
+        // the store, a frozen graph takes no inserts.
+        if(_engine->support_dynamic()) {
+            r = _engine->reset_max_elements(_data_store.max_elements());
+            if(!r.ok()) {
+                return r;
+            }
+        }
+        _base_option.max_elements = _data_store.max_elements();
         return turbo::OkStatus();
     }
 
@@ -201,4 +632,8 @@ namespace tann {
     size_t IndexCore::remove_size() const {
         return _data_store.deleted_size();
     }
+
+    size_t IndexCore::max_elements() const {
+        return _data_store.max_elements();
+    }
 }  // namespace tann
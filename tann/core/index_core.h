@@ -15,12 +15,17 @@
 #define TANN_CORE_INDEX_CORE_H_
 
 #include <any>
+#include <atomic>
 #include "tann/core/search_context.h"
+#include "tann/core/search_trace.h"
 #include "tann/core/vector_space.h"
 #include "tann/core/types.h"
 #include "tann/core/engine.h"
 #include "tann/core/index_option.h"
 #include "tann/core/serialize_option.h"
+#include "tann/core/statistics.h"
+#include "tann/common/latency_histogram.h"
+#include "tann/core/work_space_pool.h"
 #include "tann/store/mem_vector_store.h"
 
 namespace tann {
@@ -40,10 +45,70 @@ namespace tann {
         [[nodiscard]] turbo::ResultStatus<InsertResult>
         add_vector(const WriteOption &option, turbo::Span<uint8_t> data_point, const label_type &label);
 
+        //////////////////////////////////////////
+        // add a batch of vectors, data holds labels.size() vectors back to back.
+        // the hnsw graph is built by HnswIndexOption::build_threads threads and
+        // is the same for any thread count. labels must be new, vacant slots
+        // are not reused in batch mode. on failure none of the labels is
+        // added, a batch the engine failed on leaves its slots deleted.
+        [[nodiscard]] turbo::ResultStatus<InsertResult>
+        add_vectors(const WriteOption &option, turbo::Span<uint8_t> data, turbo::Span<label_type> labels);
+
         [[nodiscard]] turbo::Status remove_vector(const label_type &label);
 
+        //////////////////////////////////////////
+        // grow the index to hold max_elements vectors online, vectors
+        // and graph links already in the index are not moved.
+        [[nodiscard]] turbo::Status reserve(std::size_t max_elements);
+
+        //////////////////////////////////////////
+        // make the index read only and let the engine compact its
+        // memory, e.g. compressed hnsw links.
+        [[nodiscard]] turbo::Status freeze();
+
         [[nodiscard]] virtual turbo::Status search_vector(SearchContext *qctx, SearchResult &result);
 
+        // same as above, the search already waited queued_ns of its
+        // timeout in front of the index, see IndexScheduler.
+        [[nodiscard]] turbo::Status search_vector(SearchContext *qctx, SearchResult &result, int64_t queued_ns);
+
+        //////////////////////////////////////////
+        // search the queries on the index executor, results[i] is the result
+        // of contexts[i]. the first failed query status is returned.
+        [[nodiscard]] turbo::Status
+        search_vectors(turbo::Span<SearchContext *> contexts, turbo::Span<SearchResult> results);
+
+        // the executor running batch search, bulk build and load
+        [[nodiscard]] Executor *executor() const {
+            return _executor;
+        }
+
+        //////////////////////////////////////////
+        // find the smallest search list reaching option.target_recall, queries
+        // holds the sample queries back to back, when it is empty the queries
+        // are drawn from the index. The result is used by the searches not
+        // setting SearchContext::search_list and is saved with the index,
+        // a result that is not TuneResult::reached leaves it unchanged.
+        [[nodiscard]] turbo::ResultStatus<TuneResult>
+        tune_search_list(const TuneOption &option, turbo::Span<uint8_t> queries = {});
+
+        [[nodiscard]] std::size_t search_list() const {
+            return _search_list.load(std::memory_order_relaxed);
+        }
+
+        // runtime counters summed over the threads, cheap enough to poll
+        [[nodiscard]] Statistics statistics() const;
+
+        // latency in ns of the requests that returned ok since initialize
+        // or reset_latency, the search phases add up to LatencyPhase::kSearch.
+        // a truncated search is recorded like any other. failed requests,
+        // empty add_vectors, remove_vector and the searches of
+        // tune_search_list are not recorded, a batch of add_vectors is one
+        // sample.
+        [[nodiscard]] HistogramSnapshot latency(LatencyPhase phase) const;
+
+        void reset_latency();
+
         [[nodiscard]] virtual turbo::Status save_index(const std::string &path, const SerializeOption &option);
 
         [[nodiscard]] virtual turbo::Status load_index(const std::string &path, const SerializeOption &option);
@@ -60,13 +125,51 @@ namespace tann {
 
         [[nodiscard]] virtual size_t remove_size() const;
 
+        [[nodiscard]] virtual size_t max_elements() const;
+
+    private:
+        // should be called under UpdateLockGuard
+        [[nodiscard]] turbo::Status reserve_impl(std::size_t max_elements);
+
+        // the search behind search_vector, record is false for the searches
+        // the index makes itself, e.g. tuning, which are not counted in
+        // statistics and latency.
+        [[nodiscard]] turbo::Status
+        search_impl(SearchContext *sc, SearchResult &results, int64_t queued_ns, bool record);
+
+        // re-score the candidates found on the codes with the exact
+        // distance and keep the k best, under the shared update lock.
+        void rerank(WorkSpace *ws, std::size_t k) const;
+
+        // phases and true distances of a finished search
+        void finish_trace(WorkSpace *ws, SearchTrace *trace) const;
+
+        // record the latency of a finished add_vector
+        InsertResult finish_insert(WorkSpace *ws);
+
+        void record_latency(LatencyPhase phase, int64_t ns) {
+            _latency[static_cast<std::size_t>(phase)].record(ns);
+        }
+
+        // recall at option.k of the queries searched with search_list
+        [[nodiscard]] turbo::ResultStatus<double>
+        recall_at(const TuneOption &option, const std::vector<std::vector<uint8_t>> &queries, bool is_normalized,
+                  const std::vector<std::vector<label_type>> &truth, std::size_t search_list);
+
     private:
         VectorSpace _vector_space;
         IndexOption _base_option;
         MemVectorStore _data_store;
         std::unique_ptr<Engine> _engine;
-        ConcurrentQueue<WorkSpace *> _ws_pool;
+        // set when IndexOption::executor_threads is not 0
+        std::unique_ptr<Executor> _own_executor;
+        Executor *_executor{nullptr};
+        WorkSpacePool _ws_pool;
         bool is_initial{false};
+        // tuned search list, 0 is not tuned
+        std::atomic<std::size_t> _search_list{0};
+        StatisticsRecorder _statistics;
+        LatencyHistogram _latency[kLatencyPhases];
 
     };
 }  // namespace tann
@@ -27,7 +27,27 @@ namespace tann {
         size_t batch_size{constants::kBatchSize};
         size_t max_elements{constants::kMaxElements};
         size_t number_thread{4};
+        // work spaces are created number_thread up front and on demand up to
+        // max_workspaces, more concurrent callers wait in arrival order.
+        // 0 is twice the hardware concurrency.
+        size_t max_workspaces{0};
+        // threads of the executor running batch search, bulk build and load,
+        // 0 shares Executor::default_executor() with the other indexes of
+        // the process, otherwise the index owns an executor of its own.
+        size_t executor_threads{0};
+        // pin the threads of an owned executor to cores
+        bool pin_threads{false};
         bool enable_replace_vacant{true};
+        // when the index is full, grow the capacity by grow_step
+        // elements instead of failing the insert.
+        bool enable_auto_grow{false};
+        size_t grow_step{constants::kGrowStep};
+        // keep a 1 bit sign code per dimension next to every vector, the
+        // engines search on the hamming distance of the codes and the
+        // k * rerank_factor best candidates are re-scored with the exact
+        // distance. float, float16, bfloat16 and int8 data only.
+        bool binary_quantization{false};
+        size_t rerank_factor{constants::kRerankFactor};
     };
 
     struct FlatIndexOption {};
@@ -37,6 +57,19 @@ namespace tann {
         size_t ef_construction{constants::kHnswEfConstruction};
         size_t ef{constants::kHnswEf};
         size_t random_seed{constants::kHnswRandomSeed};
+        // for add_vectors, threads of the index executor used to search the
+        // candidates of a batch, 0 means all. the graph built does not depend on it.
+        size_t build_threads{0};
+        // for add_vectors, nodes searched against the same frozen graph and
+        // then committed in input order. the graph built depends on it.
+        size_t build_batch_size{constants::kHnswBuildBatchSize};
+        // stop the base layer search once the k best results have not
+        // improved for early_stop_hops expanded nodes, 0 disables it and
+        // the search runs until the ef bound is satisfied.
+        size_t early_stop_hops{0};
+        // load the graph with compressed level 0 links, the index is
+        // read only then, the same as after IndexCore::freeze.
+        bool compress_graph{false};
     };
 
 }  // namespace tann
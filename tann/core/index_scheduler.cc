@@ -0,0 +1,260 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "tann/core/index_scheduler.h"
+#include <algorithm>
+#include <thread>
+
+namespace tann {
+
+    turbo::Status IndexScheduler::initialize(IndexCore *index, const SchedulerOption &option) {
+        if (index == nullptr) {
+            return turbo::InvalidArgumentError("no index to schedule");
+        }
+        if (option.max_writes == 0 || option.write_rate < 0 || option.max_write_delay_ns < 0) {
+            return turbo::InvalidArgumentError("bad max writes {} write rate {} write delay {}", option.max_writes,
+                                               option.write_rate, option.max_write_delay_ns);
+        }
+        std::lock_guard<std::mutex> lk(_mutex);
+        if (!_search_queue.empty() || !_write_queue.empty() || _searches || _writes) {
+            return turbo::FailedPreconditionError("scheduler is busy");
+        }
+        _index = index;
+        _option = option;
+        if (_option.max_searches == 0) {
+            _option.max_searches = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (_option.write_burst == 0) {
+            _option.write_burst = std::max<std::size_t>(1, static_cast<std::size_t>(_option.write_rate));
+        }
+        _tokens = static_cast<double>(_option.write_burst);
+        _refilled = Clock::now();
+        _shed_searches = 0;
+        _shed_writes = 0;
+        return turbo::OkStatus();
+    }
+
+    turbo::Status IndexScheduler::search_vector(SearchContext *sc, SearchResult &result) {
+        auto start = Clock::now();
+        auto r = enter_search(sc);
+        if (!r.ok()) {
+            return r;
+        }
+        // the queue wait is part of the search budget
+        auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        r = _index->search_vector(sc, result, waited);
+        exit_search();
+        return r;
+    }
+
+    turbo::ResultStatus<InsertResult>
+    IndexScheduler::add_vector(const WriteOption &option, turbo::Span<uint8_t> data_point, const label_type &label) {
+        auto r = enter_write(1);
+        if (!r.ok()) {
+            return r;
+        }
+        auto rs = _index->add_vector(option, data_point, label);
+        exit_write();
+        return rs;
+    }
+
+    turbo::ResultStatus<InsertResult>
+    IndexScheduler::add_vectors(const WriteOption &option, turbo::Span<uint8_t> data, turbo::Span<label_type> labels) {
+        auto r = enter_write(labels.size());
+        if (!r.ok()) {
+            return r;
+        }
+        auto rs = _index->add_vectors(option, data, labels);
+        exit_write();
+        return rs;
+    }
+
+    turbo::Status IndexScheduler::remove_vector(const label_type &label) {
+        auto r = enter_write(1);
+        if (!r.ok()) {
+            return r;
+        }
+        r = _index->remove_vector(label);
+        exit_write();
+        return r;
+    }
+
+    std::size_t IndexScheduler::shed_searches() const {
+        std::lock_guard<std::mutex> lk(_mutex);
+        return _shed_searches;
+    }
+
+    std::size_t IndexScheduler::shed_writes() const {
+        std::lock_guard<std::mutex> lk(_mutex);
+        return _shed_writes;
+    }
+
+    std::size_t IndexScheduler::queued_searches() const {
+        std::lock_guard<std::mutex> lk(_mutex);
+        return _search_queue.size();
+    }
+
+    std::size_t IndexScheduler::queued_writes() const {
+        std::lock_guard<std::mutex> lk(_mutex);
+        return _write_queue.size();
+    }
+
+    turbo::Status IndexScheduler::enter_search(SearchContext *sc) {
+        Waiter w;
+        w.since = Clock::now();
+        std::unique_lock<std::mutex> lk(_mutex);
+        _search_queue.push_back(&w);
+        dispatch_locked(w.since);
+        if (w.admitted) {
+            return turbo::OkStatus();
+        }
+        // nothing behind us was admitted, we are still the last one
+        if (_search_queue.size() > _option.max_queued_searches) {
+            _search_queue.pop_back();
+            ++_shed_searches;
+            return turbo::ResourceExhaustedError("{} searches queued", _option.max_queued_searches);
+        }
+        if (sc->timeout_ns == 0) {
+            w.cv.wait(lk, [&w] { return w.admitted; });
+            return turbo::OkStatus();
+        }
+        auto deadline = w.since + std::chrono::nanoseconds(sc->timeout_ns);
+        if (w.cv.wait_until(lk, deadline, [&w] { return w.admitted; })) {
+            return turbo::OkStatus();
+        }
+        _search_queue.erase(std::find(_search_queue.begin(), _search_queue.end(), &w));
+        ++_shed_searches;
+        // a write kSearchFirst held back for us may go now
+        dispatch_locked(Clock::now());
+        return turbo::DeadlineExceededError("search queued past its {} ns timeout", sc->timeout_ns);
+    }
+
+    void IndexScheduler::exit_search() {
+        std::lock_guard<std::mutex> lk(_mutex);
+        --_searches;
+        dispatch_locked(Clock::now());
+    }
+
+    turbo::Status IndexScheduler::enter_write(std::size_t vectors) {
+        Waiter w;
+        w.since = Clock::now();
+        w.cost = static_cast<double>(vectors);
+        std::unique_lock<std::mutex> lk(_mutex);
+        _write_queue.push_back(&w);
+        dispatch_locked(w.since);
+        if (w.admitted) {
+            return turbo::OkStatus();
+        }
+        if (_write_queue.size() > _option.max_queued_writes) {
+            _write_queue.pop_back();
+            ++_shed_writes;
+            return turbo::ResourceExhaustedError("{} writes queued", _option.max_queued_writes);
+        }
+        // the rate limit and the search priority are released by time,
+        // nobody else wakes us then.
+        while (!w.admitted) {
+            auto until = next_write_check_locked(Clock::now());
+            if (until == Clock::time_point::max()) {
+                w.cv.wait(lk);
+            } else {
+                w.cv.wait_until(lk, until);
+            }
+            if (!w.admitted) {
+                dispatch_locked(Clock::now());
+            }
+        }
+        return turbo::OkStatus();
+    }
+
+    void IndexScheduler::exit_write() {
+        std::lock_guard<std::mutex> lk(_mutex);
+        --_writes;
+        dispatch_locked(Clock::now());
+    }
+
+    void IndexScheduler::dispatch_locked(Clock::time_point now) {
+        refill_locked(now);
+        auto admit_searches = [this] {
+            if (_option.priority == SchedulePriority::kWriteFirst && write_pending_locked()) {
+                return;
+            }
+            while (!_search_queue.empty() && _searches < _option.max_searches) {
+                auto *w = _search_queue.front();
+                _search_queue.pop_front();
+                ++_searches;
+                w->admitted = true;
+                w->cv.notify_one();
+            }
+        };
+        auto admit_writes = [this, now] {
+            while (write_ready_locked(now)) {
+                auto *w = _write_queue.front();
+                _write_queue.pop_front();
+                ++_writes;
+                if (_option.write_rate > 0) {
+                    _tokens -= w->cost;
+                }
+                w->admitted = true;
+                w->cv.notify_one();
+            }
+        };
+        if (_option.priority == SchedulePriority::kWriteFirst) {
+            admit_writes();
+            admit_searches();
+        } else {
+            admit_searches();
+            admit_writes();
+        }
+    }
+
+    bool IndexScheduler::write_ready_locked(Clock::time_point now) const {
+        if (_write_queue.empty() || _writes >= _option.max_writes) {
+            return false;
+        }
+        if (_option.write_rate > 0 && _tokens <= 0) {
+            return false;
+        }
+        // searches are admitted first, queued ones are waiting for a turn
+        if (_option.priority == SchedulePriority::kSearchFirst && !_search_queue.empty()) {
+            return now - _write_queue.front()->since >= std::chrono::nanoseconds(_option.max_write_delay_ns);
+        }
+        return true;
+    }
+
+    bool IndexScheduler::write_pending_locked() const {
+        return !_write_queue.empty() && (_option.write_rate <= 0 || _tokens > 0);
+    }
+
+    void IndexScheduler::refill_locked(Clock::time_point now) {
+        if (_option.write_rate <= 0 || now <= _refilled) {
+            return;
+        }
+        double seconds = std::chrono::duration<double>(now - _refilled).count();
+        _tokens = std::min(static_cast<double>(_option.write_burst), _tokens + seconds * _option.write_rate);
+        _refilled = now;
+    }
+
+    IndexScheduler::Clock::time_point IndexScheduler::next_write_check_locked(Clock::time_point now) const {
+        auto next = Clock::time_point::max();
+        if (_option.write_rate > 0 && _tokens <= 0) {
+            // a little past the time the bucket is positive again
+            auto wait = std::chrono::duration<double>(-_tokens / _option.write_rate + 1e-6);
+            next = now + std::chrono::duration_cast<Clock::duration>(wait);
+        }
+        if (_option.priority == SchedulePriority::kSearchFirst && _option.max_write_delay_ns > 0 &&
+            !_search_queue.empty() && !_write_queue.empty()) {
+            next = std::min(next, _write_queue.front()->since + std::chrono::nanoseconds(_option.max_write_delay_ns));
+        }
+        return next;
+    }
+}  // namespace tann
@@ -0,0 +1,145 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef TANN_CORE_INDEX_SCHEDULER_H_
+#define TANN_CORE_INDEX_SCHEDULER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "tann/core/index_core.h"
+
+namespace tann {
+
+    enum class SchedulePriority {
+        // a write waits while searches are queued, for at most
+        // SchedulerOption::max_write_delay_ns
+        kSearchFirst,
+        // a search waits while a write is queued and the rate limit lets
+        // it go, so the running searches drain and the write gets the
+        // update lock
+        kWriteFirst,
+        // searches and writes only wait for their own kind
+        kNone
+    };
+
+    struct SchedulerOption {
+        // searches running at once, 0 is the hardware concurrency
+        std::size_t max_searches{0};
+        // searches waiting for a turn, later ones are shed
+        std::size_t max_queued_searches{constants::kSchedulerQueueSize};
+        // writes running at once, they share the exclusive update lock anyway
+        std::size_t max_writes{1};
+        std::size_t max_queued_writes{constants::kSchedulerQueueSize};
+        // vectors written per second, 0 is no limit. a batch goes when the
+        // bucket is not empty and may take it below zero, the next writes
+        // then wait until it is refilled.
+        double write_rate{0};
+        // vectors the bucket holds, 0 is write_rate
+        std::size_t write_burst{0};
+        SchedulePriority priority{SchedulePriority::kSearchFirst};
+        // 0 lets a write go at once, as with kNone
+        int64_t max_write_delay_ns{constants::kSchedulerWriteDelayNs};
+    };
+
+    //////////////////////////////////////////
+    // admission control in front of an IndexCore. Searches and writes wait
+    // in their own fifo queue, a bounded number of each runs at once and
+    // the queue beyond max_queued_* is shed with a resource exhausted
+    // status, so a burst does not pile onto the workspace pool and the
+    // update lock. Writes are rate limited and, by default, give way to
+    // queued searches so a bulk re-ingestion does not starve interactive
+    // searches. A search waiting past SearchContext::timeout_ns is shed
+    // with a deadline exceeded status, the time it waited is taken off
+    // the budget of the search.
+    class IndexScheduler {
+    public:
+        IndexScheduler() = default;
+
+        // index must outlive the scheduler
+        [[nodiscard]] turbo::Status initialize(IndexCore *index, const SchedulerOption &option);
+
+        [[nodiscard]] turbo::Status search_vector(SearchContext *sc, SearchResult &result);
+
+        [[nodiscard]] turbo::ResultStatus<InsertResult>
+        add_vector(const WriteOption &option, turbo::Span<uint8_t> data_point, const label_type &label);
+
+        [[nodiscard]] turbo::ResultStatus<InsertResult>
+        add_vectors(const WriteOption &option, turbo::Span<uint8_t> data, turbo::Span<label_type> labels);
+
+        [[nodiscard]] turbo::Status remove_vector(const label_type &label);
+
+        [[nodiscard]] IndexCore *index() const {
+            return _index;
+        }
+
+        // requests shed since initialize
+        [[nodiscard]] std::size_t shed_searches() const;
+
+        [[nodiscard]] std::size_t shed_writes() const;
+
+        // requests waiting for a turn now
+        [[nodiscard]] std::size_t queued_searches() const;
+
+        [[nodiscard]] std::size_t queued_writes() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Waiter {
+            std::condition_variable cv;
+            Clock::time_point since;
+            // vectors the write takes from the bucket
+            double cost{0};
+            bool admitted{false};
+        };
+
+        turbo::Status enter_search(SearchContext *sc);
+
+        void exit_search();
+
+        turbo::Status enter_write(std::size_t vectors);
+
+        void exit_write();
+
+        // admit the queue heads that may run now, under _mutex
+        void dispatch_locked(Clock::time_point now);
+
+        bool write_ready_locked(Clock::time_point now) const;
+
+        // a write is queued and the bucket lets it go, kWriteFirst holds
+        // the searches back then
+        bool write_pending_locked() const;
+
+        void refill_locked(Clock::time_point now);
+
+        // when a queued write should look again, under _mutex
+        Clock::time_point next_write_check_locked(Clock::time_point now) const;
+
+    private:
+        IndexCore *_index{nullptr};
+        SchedulerOption _option;
+        mutable std::mutex _mutex;
+        std::deque<Waiter *> _search_queue;
+        std::deque<Waiter *> _write_queue;
+        std::size_t _searches{0};
+        std::size_t _writes{0};
+        double _tokens{0};
+        Clock::time_point _refilled;
+        std::size_t _shed_searches{0};
+        std::size_t _shed_writes{0};
+    };
+}  // namespace tann
+
+#endif  // TANN_CORE_INDEX_SCHEDULER_H_
@@ -25,16 +25,17 @@ namespace tann {
     struct NeighborEntity {
         label_type label{constants::kUnknownLabel};
         location_t lid{constants::kUnknownLocation};
-        double distance{0.0};
+        rank_distance_type distance{0.0};
         bool expanded{false};
 
         NeighborEntity() = default;
 
-        NeighborEntity(double d, location_t o) : lid{o}, distance{d} {
+        NeighborEntity(double d, location_t o) : lid{o}, distance{static_cast<rank_distance_type>(d)} {
 
         }
 
-        NeighborEntity(double d, label_type l, location_t o) : label{l}, lid{o}, distance{d} {
+        NeighborEntity(double d, label_type l, location_t o) : label{l}, lid{o},
+                                                               distance{static_cast<rank_distance_type>(d)} {
         }
 
         inline bool operator<(const NeighborEntity &other) const {
@@ -165,7 +166,7 @@ namespace tann {
 } // namespace tann
 namespace fmt {
     template<>
-    struct formatter<tann::NeighborEntity> : formatter<double> {
+    struct formatter<tann::NeighborEntity> : formatter<float> {
         // parse is inherited from formatter<float>.
 
         auto format(const tann::NeighborEntity &c, format_context &ctx) const {
@@ -22,6 +22,8 @@
 
 namespace tann {
 
+    struct SearchTrace;
+
     struct SearchContext {
         explicit SearchContext(turbo::Span<uint8_t> query) {
             original_query = to_span<uint8_t>(query);
@@ -48,7 +50,19 @@ namespace tann {
     public:
         std::size_t k{0};
         std::size_t search_list{0};
+        // overwrite the engine early stop hops when not 0, see HnswIndexOption.
+        std::size_t early_stop_hops{0};
+        // search budget, 0 is unbounded. the engine returns the best results
+        // so far and sets SearchResult::truncated once any of them is spent.
+        // timeout_ns runs from the same start as SearchResult::cost_ns, the
+        // flat engine counts every scanned vector as a distance computation
+        // and has no hops.
+        int64_t timeout_ns{0};
+        std::size_t max_distance_computations{0};
+        std::size_t max_hops{0};
         BaseFilterFunctor *is_allowed{nullptr};
+        // record what the search does, see SearchTrace
+        SearchTrace *trace{nullptr};
         bool get_raw_vector{false};
         bool is_normalized{false};
         bool desc{false};
@@ -59,11 +73,34 @@ namespace tann {
         std::vector<std::pair<distance_type, label_type>> results;
         std::vector<std::vector<uint8_t>> vectors;
         int64_t cost_ns{0};
+        // the search ran out of its budget, see SearchContext::timeout_ns
+        bool truncated{false};
     };
 
     struct InsertResult {
         int64_t cost_ns{0};
     };
+
+    ///////////////////////////////////////////////////
+    // search list tuning, find the smallest search list
+    // that reaches target_recall at k against the exact
+    // result of the flat engine.
+    struct TuneOption {
+        double target_recall{0.95};
+        std::size_t k{10};
+        // queries drawn from the index when no query is given
+        std::size_t sample_size{100};
+        std::size_t max_search_list{1024};
+        std::size_t random_seed{constants::kHnswRandomSeed};
+    };
+
+    struct TuneResult {
+        std::size_t search_list{0};
+        double recall{0.0};
+        // false when max_search_list misses target_recall, search_list
+        // and recall are those of max_search_list then.
+        bool reached{false};
+    };
 }  // namespace
 
 #endif  // TANN_CORE_SEARCH_CONTEXT_H_
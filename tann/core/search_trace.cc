@@ -0,0 +1,121 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "tann/core/search_trace.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include "turbo/format/format.h"
+
+namespace tann {
+
+    namespace {
+        constexpr LatencyPhase kSearchPhases[] = {LatencyPhase::kSearchPreprocess, LatencyPhase::kSearchLockWait,
+                                                  LatencyPhase::kSearchDescent, LatencyPhase::kSearchBase,
+                                                  LatencyPhase::kSearchMaterialize};
+
+        // the names are part of the output format, they do not follow
+        // renames of the enum
+        const char *phase_name(LatencyPhase phase) {
+            switch (phase) {
+                case LatencyPhase::kSearch:
+                    return "search";
+                case LatencyPhase::kSearchPreprocess:
+                    return "preprocess";
+                case LatencyPhase::kSearchLockWait:
+                    return "lock_wait";
+                case LatencyPhase::kSearchDescent:
+                    return "descent";
+                case LatencyPhase::kSearchBase:
+                    return "base";
+                case LatencyPhase::kSearchMaterialize:
+                    return "materialize";
+                default:
+                    return "unknown";
+            }
+        }
+
+        inline int64_t phase_of(const SearchTrace &trace, LatencyPhase phase) {
+            return trace.phase_ns[static_cast<std::size_t>(phase)];
+        }
+
+        // json has no inf or nan
+        inline std::string json_number(distance_type d) {
+            return std::isfinite(d) ? turbo::format("{}", d) : std::string("null");
+        }
+    }  // namespace
+
+    void SearchTrace::clear() {
+        entry_point = constants::kUnknownLocation;
+        visits.clear();
+        hops.clear();
+        filter_rejections = 0;
+        deleted_skips = 0;
+        truncated = false;
+        std::fill(std::begin(phase_ns), std::end(phase_ns), 0);
+    }
+
+    std::string SearchTrace::to_json() const {
+        std::string out = "{\"entry_point\":";
+        out += entry_point == constants::kUnknownLocation ? std::string("null") : turbo::format("{}", entry_point);
+        out += turbo::format(",\"filter_rejections\":{},\"deleted_skips\":{},\"truncated\":{}", filter_rejections,
+                             deleted_skips, truncated ? "true" : "false");
+        out += ",\"hops\":[";
+        for (std::size_t i = 0; i < hops.size(); ++i) {
+            out += turbo::format("{}{}", i ? "," : "", hops[i]);
+        }
+        out += "],\"phase_ns\":{";
+        out += turbo::format("\"{}\":{}", phase_name(LatencyPhase::kSearch), phase_of(*this, LatencyPhase::kSearch));
+        for (auto phase: kSearchPhases) {
+            out += turbo::format(",\"{}\":{}", phase_name(phase), phase_of(*this, phase));
+        }
+        out += "},\"visits\":[";
+        for (std::size_t i = 0; i < visits.size(); ++i) {
+            auto &v = visits[i];
+            out += turbo::format("{}{{\"lid\":{},\"level\":{},\"distance\":{},\"queued\":{},\"bounded\":{}}}",
+                                 i ? "," : "", v.lid, v.level, json_number(v.distance), v.queued ? "true" : "false",
+                                 v.bounded ? "true" : "false");
+        }
+        out += "]}";
+        return out;
+    }
+
+    std::string SearchTrace::to_chrome_trace() const {
+        // timestamps and durations are in microseconds
+        std::string out = "{\"traceEvents\":[";
+        out += turbo::format("{{\"name\":\"search\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":0,\"dur\":{:.3f},"
+                             "\"args\":{{\"visits\":{},\"filter_rejections\":{},\"deleted_skips\":{},\"truncated\":{}}}}}",
+                             phase_of(*this, LatencyPhase::kSearch) / 1000.0, visits.size(), filter_rejections,
+                             deleted_skips, truncated ? "true" : "false");
+        int64_t ts = 0;
+        for (auto phase: kSearchPhases) {
+            auto dur = phase_of(*this, phase);
+            std::string args;
+            if (phase == LatencyPhase::kSearchDescent || phase == LatencyPhase::kSearchBase) {
+                // hops of the levels the phase covers
+                std::size_t level_hops = 0;
+                for (std::size_t l = 0; l < hops.size(); ++l) {
+                    if ((l == 0) == (phase == LatencyPhase::kSearchBase)) {
+                        level_hops += hops[l];
+                    }
+                }
+                args = turbo::format(",\"args\":{{\"hops\":{}}}", level_hops);
+            }
+            out += turbo::format(",{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":{:.3f},\"dur\":{:.3f}{}}}",
+                                 phase_name(phase), ts / 1000.0, dur / 1000.0, args);
+            ts += dur;
+        }
+        out += "],\"displayTimeUnit\":\"ns\"}";
+        return out;
+    }
+}  // namespace tann
@@ -0,0 +1,80 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef TANN_CORE_SEARCH_TRACE_H_
+#define TANN_CORE_SEARCH_TRACE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "tann/core/types.h"
+#include "tann/core/statistics.h"
+
+namespace tann {
+
+    struct TraceVisit {
+        location_t lid{constants::kUnknownLocation};
+        // graph level, 0 for the flat engine
+        int level{0};
+        distance_type distance{0};
+        // entered the candidate set, or the results of the flat engine
+        bool queued{false};
+        // computed against the worst kept distance, a visit that is not
+        // queued only has a distance past that bound, not the exact one,
+        // see DistanceBase::compare_bounded.
+        bool bounded{false};
+    };
+
+    //////////////////////////////////////////
+    // what one search did, set SearchContext::trace to record it. The
+    // trace is cleared when the search starts, distances are converted
+    // like SearchResult, with binary quantization they are the code
+    // distances the engine searched on. A search without a trace does
+    // not pay for it.
+    struct SearchTrace {
+        location_t entry_point{constants::kUnknownLocation};
+        // every distance computed, in order
+        std::vector<TraceVisit> visits;
+        // expanded nodes per level
+        std::vector<std::size_t> hops;
+        // visited but kept out of the results
+        std::size_t filter_rejections{0};
+        std::size_t deleted_skips{0};
+        bool truncated{false};
+        // see IndexCore::latency
+        int64_t phase_ns[kLatencyPhases]{};
+
+        void clear();
+
+        void add_hop(int level) {
+            if (hops.size() <= static_cast<std::size_t>(level)) {
+                hops.resize(level + 1, 0);
+            }
+            ++hops[level];
+        }
+
+        void add_visit(location_t lid, int level, distance_type distance, bool queued, bool bounded = false) {
+            visits.push_back({lid, level, distance, queued, bounded});
+        }
+
+        [[nodiscard]] std::string to_json() const;
+
+        // chrome://tracing or perfetto json, the search phases as
+        // complete events one after another. the phases are named
+        // search, preprocess, lock_wait, descent, base and materialize in
+        // both outputs.
+        [[nodiscard]] std::string to_chrome_trace() const;
+    };
+}  // namespace tann
+
+#endif  // TANN_CORE_SEARCH_TRACE_H_
@@ -0,0 +1,64 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "tann/core/statistics.h"
+
+namespace tann {
+
+    namespace {
+        // threads take the shards round robin, the first kStatisticsShards
+        // threads of the process never share one.
+        std::atomic<std::size_t> g_next_shard{0};
+        thread_local std::size_t t_shard = g_next_shard.fetch_add(1, std::memory_order_relaxed) %
+                                           constants::kStatisticsShards;
+
+        inline void bump(std::atomic<uint64_t> &c, uint64_t n) {
+            c.fetch_add(n, std::memory_order_relaxed);
+        }
+    }  // namespace
+
+    StatisticsRecorder::Shard &StatisticsRecorder::local() {
+        return _shards[t_shard];
+    }
+
+    void StatisticsRecorder::add_search(uint64_t hops, uint64_t distance_computations, bool truncated) {
+        auto &s = local();
+        bump(s.searches, 1);
+        bump(s.hops, hops);
+        bump(s.distance_computations, distance_computations);
+        if (truncated) {
+            bump(s.truncated_searches, 1);
+        }
+    }
+
+    void StatisticsRecorder::add_inserts(uint64_t n) {
+        bump(local().inserts, n);
+    }
+
+    void StatisticsRecorder::add_delete() {
+        bump(local().deletes, 1);
+    }
+
+    Statistics StatisticsRecorder::snapshot() const {
+        Statistics st;
+        for (auto &s: _shards) {
+            st.searches += s.searches.load(std::memory_order_relaxed);
+            st.truncated_searches += s.truncated_searches.load(std::memory_order_relaxed);
+            st.inserts += s.inserts.load(std::memory_order_relaxed);
+            st.deletes += s.deletes.load(std::memory_order_relaxed);
+            st.distance_computations += s.distance_computations.load(std::memory_order_relaxed);
+            st.hops += s.hops.load(std::memory_order_relaxed);
+        }
+        return st;
+    }
+}  // namespace tann
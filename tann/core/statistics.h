@@ -17,11 +17,78 @@
 #include <atomic>
 #include <cstdint>
 #include <cstddef>
+#include "tann/core/types.h"
 
 namespace tann {
 
+    // counters of an index since it was initialized, see IndexCore::statistics
     struct Statistics {
+        uint64_t searches{0};
+        // searches stopped by their budget, see SearchContext::timeout_ns
+        uint64_t truncated_searches{0};
+        // vectors added, a replaced vacant slot is an insert too
+        uint64_t inserts{0};
+        uint64_t deletes{0};
+        // of the searches, the flat engine counts scanned vectors
+        uint64_t distance_computations{0};
+        uint64_t hops{0};
+        // callers that found every workspace busy and waited
+        uint64_t workspace_waits{0};
+    };
 
+    // latency histograms kept by IndexCore, see IndexCore::latency
+    enum class LatencyPhase {
+        // whole search_vector, the phases below add up to it
+        kSearch,
+        // query copy, normalization and binary code
+        kSearchPreprocess,
+        // waiting for the shared update lock
+        kSearchLockWait,
+        // hnsw upper levels
+        kSearchDescent,
+        // hnsw level 0 or the flat scan
+        kSearchBase,
+        // re-ranking and copying out results
+        kSearchMaterialize,
+        // whole add_vector, or a whole add_vectors batch
+        kInsert,
+        // waiting for the update locks of add_vector or add_vectors
+        kInsertLockWait,
+        kCount
     };
-}
+
+    static constexpr std::size_t kLatencyPhases = static_cast<std::size_t>(LatencyPhase::kCount);
+
+    //////////////////////////////////////////
+    // per thread sharded counters behind Statistics. A thread always adds
+    // to the same shard on its own cache line, so the hot path is an
+    // uncontended relaxed add and a read sums the shards.
+    class StatisticsRecorder {
+    public:
+        void add_search(uint64_t hops, uint64_t distance_computations, bool truncated);
+
+        void add_inserts(uint64_t n);
+
+        void add_delete();
+
+        // workspace_waits is left to the caller
+        [[nodiscard]] Statistics snapshot() const;
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> searches{0};
+            std::atomic<uint64_t> truncated_searches{0};
+            std::atomic<uint64_t> inserts{0};
+            std::atomic<uint64_t> deletes{0};
+            std::atomic<uint64_t> distance_computations{0};
+            std::atomic<uint64_t> hops{0};
+        };
+
+        Shard &local();
+
+    private:
+        Shard _shards[constants::kStatisticsShards];
+    };
+}  // namespace tann
+
 #endif // TANN_CORE_STATISTICS_H_
@@ -25,6 +25,8 @@ namespace tann {
     typedef uint32_t location_t;
     typedef size_t label_type;
     typedef double distance_type;
+    // distances kept in the candidate queues
+    typedef float rank_distance_type;
 
     enum class EngineType {
         ENGINE_NONE,
@@ -39,14 +41,18 @@ namespace tann {
         DT_NONE = 0,
         DT_UINT8,
         DT_FLOAT16,
-        DT_FLOAT
+        DT_FLOAT,
+        DT_INT8,
+        DT_BFLOAT16
     };
 
     inline size_t data_type_size(DataType dt) {
         switch (dt) {
             case DataType::DT_UINT8:
+            case DataType::DT_INT8:
                 return 1;
             case DataType::DT_FLOAT16:
+            case DataType::DT_BFLOAT16:
                 return 2;
             case DataType::DT_FLOAT:
                 return 4;
@@ -105,7 +111,13 @@ namespace tann::constants {
     static constexpr size_t kUnknownSize = std::numeric_limits<size_t>::max();
     static constexpr size_t kMaxElements = 100000;
     static constexpr size_t kBatchSize = 256;
+    static constexpr size_t kGrowStep = 65536;
     static constexpr size_t kLockSlots = 65536;
+    static constexpr size_t kLabelMapShards = 64;
+    static constexpr size_t kStatisticsShards = 64;
+    static constexpr size_t kRerankFactor = 4;
+    static constexpr size_t kSchedulerQueueSize = 1024;
+    static constexpr int64_t kSchedulerWriteDelayNs = 100 * 1000 * 1000;
 
     static constexpr location_t kUnknownLocation = std::numeric_limits<location_t>::max();
     static constexpr label_type kUnknownLabel = std::numeric_limits<label_type>::max();
@@ -114,5 +126,6 @@ namespace tann::constants {
     static constexpr size_t kHnswEf = 50;
     static constexpr size_t kHnswEfConstruction = 200;
     static constexpr size_t kHnswRandomSeed = 100;
+    static constexpr size_t kHnswBuildBatchSize = 1024;
 }  // namespace tann::constants
 #endif  // TANN_CORE_TYPES_H_
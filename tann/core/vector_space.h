@@ -30,11 +30,21 @@ namespace tann {
         using value_type = uint8_t;
     };
 
+    template<>
+    struct data_type_traits<DataType::DT_INT8> {
+        using value_type = int8_t;
+    };
+
     template<>
     struct data_type_traits<DataType::DT_FLOAT16> {
         using value_type = float16;
     };
 
+    template<>
+    struct data_type_traits<DataType::DT_BFLOAT16> {
+        using value_type = bfloat16;
+    };
+
     template<>
     struct data_type_traits<DataType::DT_FLOAT> {
         using value_type = float16;
@@ -45,7 +55,7 @@ namespace tann {
         turbo::Status init(size_t dim, MetricType m, DataType dt) {
             metric_type = m;
             data_type = dt;
-            auto r = DistanceFactory::create_distance_factor(metric_type, data_type);
+            auto r = DistanceFactory::create_distance_factor(metric_type, data_type, dim);
             if (!r.ok()) {
                 return r.status();
             }
@@ -54,7 +64,7 @@ namespace tann {
             type_size = data_type_size(data_type);
             vector_byte_size = dimension * type_size;
             alignment_dim = Allocator::alignment_bytes / type_size;
-            arch_name = turbo::simd::default_arch::name();
+            arch_name = DistanceFactory::arch_name();
             return turbo::OkStatus();
         }
 
@@ -17,12 +17,17 @@
 
 #include <cstdint>
 #include "tann/core/types.h"
+#include "tann/common/executor.h"
 namespace tann {
 
     struct VectorStoreOption {
         uint32_t batch_size{constants::kBatchSize};
         uint32_t max_elements{constants::kMaxElements};
         bool     enable_replace_vacant{true};
+        // keep the sign code of every vector, see IndexOption.
+        bool     binary_quantization{false};
+        // shared with the engine, nullptr is Executor::default_executor()
+        Executor *executor{nullptr};
     };
 }  // namespace tann
 #endif  // TANN_CORE_VECTOR_STORE_OPTION_H_
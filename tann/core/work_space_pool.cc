@@ -0,0 +1,169 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "tann/core/work_space_pool.h"
+#include <thread>
+#include "turbo/log/logging.h"
+
+namespace tann {
+
+    namespace {
+        // slot the thread used last, the first try on the next acquire
+        thread_local std::size_t t_last_slot = std::numeric_limits<std::size_t>::max();
+
+        inline std::size_t start_slot(std::size_t n) {
+            if (t_last_slot == std::numeric_limits<std::size_t>::max()) {
+                t_last_slot = std::hash<std::thread::id>()(std::this_thread::get_id());
+            }
+            return t_last_slot % n;
+        }
+    }  // namespace
+
+    WorkSpacePool::~WorkSpacePool() {
+        clear();
+    }
+
+    turbo::Status WorkSpacePool::initialize(Factory factory, std::size_t initial_size, std::size_t max_size) {
+        clear();
+        _factory = std::move(factory);
+        _max_size = std::max<std::size_t>(1, std::max(initial_size, max_size));
+        _slots.reset(new Slot[_max_size]);
+        for (std::size_t i = 0; i < initial_size; ++i) {
+            auto ws = _factory();
+            if (!ws) {
+                return turbo::ResourceExhaustedError("no memory");
+            }
+            _slots[i].space.store(ws, std::memory_order_release);
+            _created.store(i + 1, std::memory_order_release);
+        }
+        return turbo::OkStatus();
+    }
+
+    void WorkSpacePool::clear() {
+        auto n = _created.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < n; ++i) {
+            delete _slots[i].space.load(std::memory_order_acquire);
+        }
+        _slots.reset();
+        _created.store(0, std::memory_order_release);
+        _max_size = 0;
+        _waits = 0;
+    }
+
+    bool WorkSpacePool::try_claim(std::size_t slot) {
+        auto &s = _slots[slot];
+        if (s.space.load(std::memory_order_acquire) == nullptr || s.busy.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        bool expected = false;
+        return s.busy.compare_exchange_strong(expected, true);
+    }
+
+    std::size_t WorkSpacePool::claim_any() {
+        auto n = _created.load(std::memory_order_acquire);
+        if (n == 0) {
+            return kNoSlot;
+        }
+        auto start = start_slot(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            auto slot = start + i < n ? start + i : start + i - n;
+            if (try_claim(slot)) {
+                t_last_slot = slot;
+                return slot;
+            }
+        }
+        return kNoSlot;
+    }
+
+    std::size_t WorkSpacePool::try_grow() {
+        auto n = _created.load(std::memory_order_acquire);
+        while (n < _max_size) {
+            if (_created.compare_exchange_weak(n, n + 1)) {
+                auto ws = _factory();
+                TLOG_CHECK(ws != nullptr, "can not create work space");
+                _slots[n].busy.store(true, std::memory_order_relaxed);
+                _slots[n].space.store(ws, std::memory_order_release);
+                t_last_slot = n;
+                return n;
+            }
+        }
+        return kNoSlot;
+    }
+
+    std::size_t WorkSpacePool::acquire() {
+        // waiters are served first, only take a slot when nobody waits
+        if (_waiters.load() == 0) {
+            auto slot = claim_any();
+            if (slot != kNoSlot) {
+                return slot;
+            }
+            slot = try_grow();
+            if (slot != kNoSlot) {
+                return slot;
+            }
+        }
+        Waiter self;
+        std::unique_lock<std::mutex> lk(_wait_mutex);
+        _wait_queue.push_back(&self);
+        _waiters.fetch_add(1);
+        // a release may have seen no waiter before we queued
+        serve_waiters_locked();
+        if (self.slot == kNoSlot) {
+            ++_waits;
+        }
+        self.cv.wait(lk, [&self] { return self.slot != kNoSlot; });
+        return self.slot;
+    }
+
+    std::size_t WorkSpacePool::waits() const {
+        std::lock_guard<std::mutex> lk(_wait_mutex);
+        return _waits;
+    }
+
+    void WorkSpacePool::release(std::size_t slot) {
+        if (_waiters.load() > 0) {
+            std::lock_guard<std::mutex> lk(_wait_mutex);
+            if (!_wait_queue.empty()) {
+                hand_off_locked(slot);
+                return;
+            }
+        }
+        _slots[slot].busy.store(false);
+        // pairs with the fetch_add in acquire, one of the two sees the other
+        if (_waiters.load() > 0) {
+            std::lock_guard<std::mutex> lk(_wait_mutex);
+            serve_waiters_locked();
+        }
+    }
+
+    void WorkSpacePool::serve_waiters_locked() {
+        while (!_wait_queue.empty()) {
+            auto slot = claim_any();
+            if (slot == kNoSlot) {
+                slot = try_grow();
+            }
+            if (slot == kNoSlot) {
+                return;
+            }
+            hand_off_locked(slot);
+        }
+    }
+
+    void WorkSpacePool::hand_off_locked(std::size_t slot) {
+        auto waiter = _wait_queue.front();
+        _wait_queue.pop_front();
+        _waiters.fetch_sub(1);
+        waiter->slot = slot;
+        waiter->cv.notify_one();
+    }
+}  // namespace tann
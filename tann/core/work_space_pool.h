@@ -0,0 +1,134 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef TANN_CORE_WORK_SPACE_POOL_H_
+#define TANN_CORE_WORK_SPACE_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include "tann/core/worker_space.h"
+#include "turbo/base/status.h"
+
+namespace tann {
+
+    //////////////////////////////////////////
+    // workspaces handed out to concurrent callers. Every workspace sits in
+    // a slot with a busy flag, acquire claims a free slot by cas starting
+    // from the slot the calling thread used last, so threads fewer than
+    // slots keep their own workspace and never share a cache line. The
+    // pool grows by the factory up to max_size, callers beyond it wait in
+    // fifo order and a release hands its workspace to the oldest waiter.
+    class WorkSpacePool {
+    public:
+        using Factory = std::function<WorkSpace *()>;
+
+        WorkSpacePool() = default;
+
+        ~WorkSpacePool();
+
+        // create initial_size workspaces now, grow to max_size on demand
+        [[nodiscard]] turbo::Status initialize(Factory factory, std::size_t initial_size, std::size_t max_size);
+
+        // blocks only when max_size workspaces are in use
+        [[nodiscard]] std::size_t acquire();
+
+        void release(std::size_t slot);
+
+        [[nodiscard]] WorkSpace *at(std::size_t slot) const {
+            return _slots[slot].space.load(std::memory_order_acquire);
+        }
+
+        // workspaces created so far
+        [[nodiscard]] std::size_t size() const {
+            return _created.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]] std::size_t max_size() const {
+            return _max_size;
+        }
+
+        // acquires that found every workspace busy and waited
+        [[nodiscard]] std::size_t waits() const;
+
+    private:
+        static constexpr std::size_t kNoSlot = std::numeric_limits<std::size_t>::max();
+
+        struct alignas(64) Slot {
+            std::atomic<WorkSpace *> space{nullptr};
+            std::atomic<bool> busy{false};
+        };
+
+        struct Waiter {
+            std::condition_variable cv;
+            std::size_t slot{kNoSlot};
+        };
+
+        bool try_claim(std::size_t slot);
+
+        // claim any free slot, starting from the one the thread used last
+        std::size_t claim_any();
+
+        // create a workspace in a new slot, kNoSlot at max_size
+        std::size_t try_grow();
+
+        // give free slots to the waiters in order, under _wait_mutex
+        void serve_waiters_locked();
+
+        // hand a claimed slot to the oldest waiter, under _wait_mutex
+        void hand_off_locked(std::size_t slot);
+
+        void clear();
+
+    private:
+        Factory _factory;
+        std::unique_ptr<Slot[]> _slots;
+        std::size_t _max_size{0};
+        std::atomic<std::size_t> _created{0};
+        std::atomic<std::size_t> _waiters{0};
+        mutable std::mutex _wait_mutex;
+        std::deque<Waiter *> _wait_queue;
+        std::size_t _waits{0};
+    };
+
+    class WorkSpaceGuard {
+    public:
+        explicit WorkSpaceGuard(WorkSpacePool &pool) : _pool(pool), _slot(pool.acquire()) {
+            _space = pool.at(_slot);
+        }
+
+        WorkSpace *work_space() {
+            return _space;
+        }
+
+        ~WorkSpaceGuard() {
+            _space->clear();
+            _pool.release(_slot);
+        }
+
+    private:
+        WorkSpacePool &_pool;
+        std::size_t _slot;
+        WorkSpace *_space;
+
+        WorkSpaceGuard(const WorkSpaceGuard &) = delete;
+
+        WorkSpaceGuard &operator=(const WorkSpaceGuard &) = delete;
+    };
+}  // namespace tann
+
+#endif  // TANN_CORE_WORK_SPACE_POOL_H_
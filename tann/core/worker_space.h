@@ -14,9 +14,12 @@
 #ifndef TANN_CORE_WORKER_SPACE_H_
 #define TANN_CORE_WORKER_SPACE_H_
 
+#include <algorithm>
+#include <iterator>
 #include "tann/core/search_context.h"
+#include "tann/core/statistics.h"
 #include "tann/core/neighbor_queue.h"
-#include "tann/common/concurrent_queue.h"
+#include "tann/distance/distance_base.h"
 #include "turbo/times/stop_watcher.h"
 
 namespace tann {
@@ -26,78 +29,110 @@ namespace tann {
         SearchContext *search_context{nullptr};
         NeighborQueue best_l_nodes;
         turbo::Span<uint8_t> query_view;
+        // norm of query_view for metrics that use_norm
+        double query_norm{0.0};
+        // sign code of query_view when the store keeps codes, the
+        // engines then search on codes, see IndexOption::binary_quantization.
+        std::vector<uint8_t> query_code;
+        // candidates the engine search returns, sc->k unless re-ranked.
+        std::size_t k{0};
+        // the exact re-scored candidates, swapped with best_l_nodes
+        NeighborQueue rerank_nodes;
+        std::size_t search_list{0};
         WriteOption write_option;
         bool        is_update{false};
         turbo::StopWatcher timer;
+        // what is left of SearchContext::timeout_ns once the search is set
+        // up, less the time it waited in front of the index. 0 is unbounded.
+        int64_t timeout_ns{0};
+        // spent budget of the search, see SearchContext::timeout_ns
+        std::size_t hops{0};
+        std::size_t distance_computations{0};
+        bool truncated{false};
+        // time per phase of the running request, see mark
+        int64_t phase_ns[kLatencyPhases]{};
+        int64_t phase_mark_ns{0};
 
-        void set_up(SearchContext *sc) {
+        // queued_ns is the time the search already waited, see IndexScheduler
+        void set_up(SearchContext *sc, const DistanceBase *distance, int64_t queued_ns = 0) {
             timer.reset();
             search_context = sc;
+            reset_budget();
+            timeout_ns = sc->timeout_ns ? std::max<int64_t>(1, sc->timeout_ns - queued_ns) : 0;
+            reset_phases();
+            search_list = sc->search_list;
+            k = sc->k;
             make_aligned_query(sc->original_query, raw_query);
             query_view = to_span<uint8_t>(raw_query);
+            set_up_norm(distance);
             best_l_nodes.clear();
             best_l_nodes.reserve(sc->k);
         }
 
         // for write
-        void set_up(const WriteOption &option, turbo::Span<uint8_t> query) {
+        void set_up(const WriteOption &option, turbo::Span<uint8_t> query, const DistanceBase *distance) {
+            timer.reset();
             search_context = nullptr;
+            timeout_ns = 0;
+            reset_budget();
+            reset_phases();
             make_aligned_query(query, raw_query);
             query_view = to_span<uint8_t>(raw_query);
+            set_up_norm(distance);
             write_option = option;
         }
 
-        void clear() {
-            search_context = nullptr;
-            best_l_nodes.clear();
-            is_update = false;
-            clear_sub();
+        // call again if query_view is changed after set_up
+        void set_up_norm(const DistanceBase *distance) {
+            query_norm = distance->use_norm() ? distance->norm(query_view) : 0.0;
         }
-    protected:
-        virtual void clear_sub() = 0;
-    protected:
-        AlignedQuery<uint8_t> raw_query;
-    };
 
-    template<typename T>
-    class WorkSpaceGuard {
-    public:
-        WorkSpaceGuard(ConcurrentQueue<T *> &query_scratch) : _space_pool(query_scratch) {
-            _space = query_scratch.pop();
-            while (_space == nullptr) {
-                query_scratch.wait_for_push_notify();
-                _space = query_scratch.pop();
+        // charge expanded nodes and the distances they took, true once the
+        // budget of the search context is spent and the engine should
+        // return what it has.
+        bool over_budget(std::size_t new_hops, std::size_t computations) {
+            hops += new_hops;
+            distance_computations += computations;
+            if (truncated || search_context == nullptr) {
+                return truncated;
             }
+            auto *sc = search_context;
+            truncated = (sc->max_hops && hops >= sc->max_hops) ||
+                        (sc->max_distance_computations && distance_computations >= sc->max_distance_computations) ||
+                        (timeout_ns && timer.elapsed_nano() >= timeout_ns);
+            return truncated;
         }
 
-        T *work_space() {
-            return _space;
+        // the time since the last mark goes to phase
+        void mark(LatencyPhase phase) {
+            auto now = timer.elapsed_nano();
+            phase_ns[static_cast<std::size_t>(phase)] += now - phase_mark_ns;
+            phase_mark_ns = now;
         }
 
-        ~WorkSpaceGuard() {
-            _space->clear();
-            _space_pool.push(_space);
-            _space_pool.push_notify_all();
+        void reset_phases() {
+            std::fill(std::begin(phase_ns), std::end(phase_ns), 0);
+            phase_mark_ns = 0;
         }
 
-        void destroy() {
-            while (!_space_pool.empty()) {
-                auto scratch = _space_pool.pop();
-                while (scratch == nullptr) {
-                    _space_pool.wait_for_push_notify();
-                    scratch = _space_pool.pop();
-                }
-                delete scratch;
-            }
+        void reset_budget() {
+            hops = 0;
+            distance_computations = 0;
+            truncated = false;
         }
 
-    private:
-        T *_space;
-        ConcurrentQueue<T *> &_space_pool;
-
-        WorkSpaceGuard(const WorkSpaceGuard<T> &) = delete;
-
-        WorkSpaceGuard &operator=(const WorkSpaceGuard<T> &) = delete;
+        void clear() {
+            search_context = nullptr;
+            reset_budget();
+            best_l_nodes.clear();
+            query_code.clear();
+            is_update = false;
+            clear_sub();
+        }
+    protected:
+        virtual void clear_sub() = 0;
+    protected:
+        AlignedQuery<uint8_t> raw_query;
     };
 }  // namespace tann
 
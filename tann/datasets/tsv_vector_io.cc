@@ -49,7 +49,9 @@ namespace tann {
             return turbo::OkStatus();
         }
         template  turbo::Status convert_to_vector<uint8_t>(const std::string&line, std::size_t ndim, turbo::Span<uint8_t> &vector);
+        template  turbo::Status convert_to_vector<int8_t>(const std::string&line, std::size_t ndim, turbo::Span<uint8_t> &vector);
         template  turbo::Status convert_to_vector<float16>(const std::string&line, std::size_t ndim, turbo::Span<uint8_t> &vector);
+        template  turbo::Status convert_to_vector<bfloat16>(const std::string&line, std::size_t ndim, turbo::Span<uint8_t> &vector);
         template  turbo::Status convert_to_vector<float>(const std::string&line, std::size_t ndim, turbo::Span<uint8_t> &vector);
 
         template <typename T>
@@ -63,7 +65,9 @@ namespace tann {
         }
 
         template turbo::Status convert_to_string<uint8_t>(std::size_t ndim, turbo::Span<uint8_t> vector, std::string *result);
+        template turbo::Status convert_to_string<int8_t>(std::size_t ndim, turbo::Span<uint8_t> vector, std::string *result);
         template turbo::Status convert_to_string<float16>(std::size_t ndim, turbo::Span<uint8_t> vector, std::string *result);
+        template turbo::Status convert_to_string<bfloat16>(std::size_t ndim, turbo::Span<uint8_t> vector, std::string *result);
         template turbo::Status convert_to_string<float>(std::size_t ndim, turbo::Span<uint8_t> vector, std::string *result);
     }  // namespace detail
     turbo::Status TsvVectorSetReader::init() {
@@ -112,8 +116,12 @@ namespace tann {
         ++_has_read;
         if(_option.data_type == DataType::DT_UINT8) {
             return detail::convert_to_vector<uint8_t>(line, _option.dimension, vector);
+        } else if(_option.data_type == DataType::DT_INT8) {
+            return detail::convert_to_vector<int8_t>(line, _option.dimension, vector);
         } else if(_option.data_type == DataType::DT_FLOAT16) {
             return detail::convert_to_vector<float16>(line, _option.dimension, vector);
+        } else if(_option.data_type == DataType::DT_BFLOAT16) {
+            return detail::convert_to_vector<bfloat16>(line, _option.dimension, vector);
         } else if(_option.data_type == DataType::DT_FLOAT) {
             return detail::convert_to_vector<float>(line, _option.dimension, vector);
         }
@@ -142,8 +150,12 @@ namespace tann {
         std::string line;
         if(_option.data_type == DataType::DT_UINT8) {
             r = detail::convert_to_string<uint8_t>(_option.dimension, vector, &line);
+        } else if(_option.data_type == DataType::DT_INT8) {
+            r = detail::convert_to_string<int8_t>(_option.dimension, vector, &line);
         } else if(_option.data_type == DataType::DT_FLOAT16) {
             r = detail::convert_to_string<float16>(_option.dimension, vector, &line);
+        } else if(_option.data_type == DataType::DT_BFLOAT16) {
+            r = detail::convert_to_string<bfloat16>(_option.dimension, vector, &line);
         } else if(_option.data_type == DataType::DT_FLOAT) {
             r = detail::convert_to_string<float>(_option.dimension, vector, &line);
         } else {
@@ -0,0 +1,82 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tann/distance/distance_base.h"
+#include <cstdlib>
+
+namespace tann {
+
+    void distance_check_failed(const char *what, const char *file, int line) {
+        TLOG_CHECK(false, "{}:{} check failed: {}", file, line, what);
+        std::abort();
+    }
+
+    DistanceBase::DistanceBase(tann::MetricType dist_metric) : _distance_metric(dist_metric) {
+    }
+
+    double DistanceBase::compare_rank(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const {
+        return compare(a, b);
+    }
+
+    double DistanceBase::compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const {
+        return compare_rank(a, b);
+    }
+
+    void DistanceBase::compare_rank_batch(turbo::Span<uint8_t> a, const uint8_t *bs, std::size_t stride,
+                                          turbo::Span<double> out) const {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = compare_rank(turbo::Span<uint8_t>(const_cast<uint8_t *>(bs) + i * stride, a.size()), a);
+        }
+    }
+
+    double DistanceBase::rank_to_distance(double d) const {
+        return d;
+    }
+
+    bool DistanceBase::use_norm() const {
+        return false;
+    }
+
+    double DistanceBase::norm(turbo::Span<uint8_t> a) const {
+        return 0.0;
+    }
+
+    double DistanceBase::compare_rank_with_norm(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double norm_a,
+                                                double norm_b) const {
+        return compare_rank(a, b);
+    }
+
+    uint32_t DistanceBase::post_normalization_dimension(uint32_t orig_dimension) const {
+        return orig_dimension;
+    }
+
+    tann::MetricType DistanceBase::get_metric() const {
+        return _distance_metric;
+    }
+
+    bool DistanceBase::preprocessing_required() const {
+        return false;
+    }
+
+    void DistanceBase::preprocess_base_points(turbo::Span<uint8_t> original_data, size_t dim) {
+    }
+
+    void DistanceBase::preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query) {
+        TLOG_CHECK_LE(query_vec.size(), scratch_query.size(),
+                      "input query vector size must little equal than des vector size.");
+        std::memcpy(scratch_query.data(), query_vec.data(), query_vec.size() * sizeof(uint8_t));
+    }
+
+    DistanceBase::~DistanceBase() = default;
+}  // namespace tann
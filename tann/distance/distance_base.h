@@ -0,0 +1,116 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_DISTANCE_DISTANCE_BASE_H_
+#define TANN_DISTANCE_DISTANCE_BASE_H_
+
+#include <cstring>
+#include "tann/common/config.h"
+#include "turbo/meta/span.h"
+#include "turbo/log/logging.h"
+#include "tann/core/types.h"
+
+namespace tann {
+
+    // report a failed check of the distance kernels, it is defined in a
+    // baseline translation unit so the simd tiers carry no logging code.
+    TURBO_DLL [[noreturn]] void distance_check_failed(const char *what, const char *file, int line);
+
+#define TANN_DISTANCE_CHECK(cond, what)                                 \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            ::tann::distance_check_failed(what, __FILE__, __LINE__);    \
+        }                                                               \
+    } while (0)
+
+    // DistanceBase is shared by every simd tier of the kernels, it is
+    // kept out of the per tier namespace, see simd_namespace.h. Its
+    // members are defined in distance_base.cc, built with the library
+    // flags, so no tier emits a copy of them.
+    class DistanceBase {
+    public:
+        TURBO_DLL explicit DistanceBase(tann::MetricType dist_metric);
+
+        // distance comparison function
+        TURBO_DLL [[nodiscard]] virtual double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const = 0;
+
+        // distance used to rank candidates inside the engines, it orders
+        // the same as compare but may skip work, e.g. the sqrt of l2.
+        TURBO_DLL [[nodiscard]] virtual double compare_rank(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const;
+
+        // compare_rank that may stop once the result is known to be greater
+        // than upper_bound, it then returns a partial value still greater
+        // than upper_bound. Results not greater than upper_bound are exact.
+        TURBO_DLL [[nodiscard]] virtual double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const;
+
+        // compare_rank of the vectors at bs + i * stride against a into out[i]
+        // for i in [0, out.size()), each vector holds a.size() bytes.
+        TURBO_DLL virtual void
+        compare_rank_batch(turbo::Span<uint8_t> a, const uint8_t *bs, std::size_t stride,
+                           turbo::Span<double> out) const;
+
+        // map a compare_rank result to the compare result.
+        TURBO_DLL [[nodiscard]] virtual double rank_to_distance(double d) const;
+
+        // the metric can use the l2 norms of the vectors, the store keeps
+        // one per vector and the search computes the query one once.
+        TURBO_DLL [[nodiscard]] virtual bool use_norm() const;
+
+        // the norm passed to compare_rank_with_norm.
+        TURBO_DLL [[nodiscard]] virtual double norm(turbo::Span<uint8_t> a) const;
+
+        // compare_rank with norm(a) and norm(b) known.
+        TURBO_DLL [[nodiscard]] virtual double
+        compare_rank_with_norm(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double norm_a, double norm_b) const;
+
+        // For MIPS, normalization adds an extra dimension to the vectors.
+        // This function lets callers know if the normalization process
+        // changes the dimension.
+        TURBO_DLL [[nodiscard]] virtual uint32_t post_normalization_dimension(uint32_t orig_dimension) const;
+
+        TURBO_DLL [[nodiscard]] virtual tann::MetricType get_metric() const;
+
+        // This is for efficiency. If no normalization is required, the callers
+        // can simply ignore the normalize_data_for_build() function.
+        TURBO_DLL [[nodiscard]] virtual bool preprocessing_required() const;
+
+        // Check the preprocessing_required() function before calling this.
+        // Clients can call the function like this:
+        //
+        //  if (metric->preprocessing_required()){
+        //     T* normalized_data_batch;
+        //      Split data into batches of batch_size and for each, call:
+        //       metric->preprocess_base_points(data_batch, batch_size);
+        //
+        //  TODO: This does not take into account the case for SSD inner product
+        //  where the dimensions change after normalization.
+        TURBO_DLL virtual void preprocess_base_points(turbo::Span<uint8_t> original_data, size_t dim);
+
+        // Invokes normalization for a single vector during search. The scratch space
+        // has to be created by the caller keeping track of the fact that
+        // normalization might change the dimension of the query vector.
+        TURBO_DLL virtual void
+        preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query);
+
+        // the out of line destructor is the key function, the vtable is
+        // emitted with it in distance_base.cc.
+        TURBO_DLL virtual ~DistanceBase();
+
+    protected:
+        tann::MetricType _distance_metric;
+    };
+}  // namespace tann
+
+#endif  // TANN_DISTANCE_DISTANCE_BASE_H_
@@ -0,0 +1,87 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tann/distance/distance_factory.h"
+#include "tann/distance/distance_factory_impl.h"
+#include "turbo/format/format.h"
+#include "turbo/meta/reflect.h"
+#include "turbo/log/logging.h"
+
+namespace tann {
+
+    namespace {
+        // the status for a kernel of the tiers, nullptr means there
+        // is no kernel for m and dt.
+        turbo::ResultStatus<DistanceBase*> checked_distance(DistanceBase *d, MetricType m, DataType dt) {
+            if (d != nullptr) {
+                if (dt == DataType::DT_UINT8 && (m == METRIC_COSINE || m == METRIC_ANGLE)) {
+                    TLOG_WARN("Although tann supports the {} measurement"
+                              "method of this data type: uint8_t, it is not recommended"
+                              "to use this type of integer data for this type of "
+                              "measurement. It is recommended to use the floating "
+                              "point data type to avoid the loss of numerical accuracy.",
+                              turbo::nameof_enum(m));
+                }
+                return d;
+            }
+            auto name = turbo::nameof_enum(m);
+            if (name.empty()) {
+                return turbo::UnknownError("unknown distance type: {}", static_cast<int>(m));
+            }
+            return turbo::UnavailableError("{} type do support {} type metric", turbo::nameof_enum(dt), name);
+        }
+    }  // namespace
+
+    turbo::ResultStatus<DistanceBase*> create_distance_native(MetricType m, DataType dt, std::size_t dim) {
+        return checked_distance(new_prim_distance(m, dt, dim), m, dt);
+    }
+
+#if defined(TANN_WITH_SIMD_DISPATCH)
+    turbo::ResultStatus<DistanceBase*> create_distance_sse4(MetricType m, DataType dt, std::size_t dim) {
+        return checked_distance(new_distance_sse4(m, dt, dim), m, dt);
+    }
+
+    turbo::ResultStatus<DistanceBase*> create_distance_avx2(MetricType m, DataType dt, std::size_t dim) {
+        return checked_distance(new_distance_avx2(m, dt, dim), m, dt);
+    }
+
+    turbo::ResultStatus<DistanceBase*> create_distance_avx512(MetricType m, DataType dt, std::size_t dim) {
+        return checked_distance(new_distance_avx512(m, dt, dim), m, dt);
+    }
+#endif  // TANN_WITH_SIMD_DISPATCH
+
+    turbo::ResultStatus<DistanceBase*> DistanceFactory::create_distance_factor(MetricType m, DataType dt, std::size_t dim) {
+#if defined(TANN_WITH_SIMD_DISPATCH)
+        switch (simd_level()) {
+            case SimdLevel::SIMD_AVX512:
+                return create_distance_avx512(m, dt, dim);
+            case SimdLevel::SIMD_AVX2:
+                return create_distance_avx2(m, dt, dim);
+            case SimdLevel::SIMD_SSE4:
+                return create_distance_sse4(m, dt, dim);
+            default:
+                break;
+        }
+#endif
+        return create_distance_native(m, dt, dim);
+    }
+
+    std::string DistanceFactory::arch_name() {
+        auto level = simd_level();
+        if (level == SimdLevel::SIMD_NATIVE) {
+            return turbo::format("native/{}", turbo::simd::default_arch::name());
+        }
+        return simd_level_name(level);
+    }
+}  // namespace tann
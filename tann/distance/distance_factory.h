@@ -14,144 +14,40 @@
 #ifndef TANN_DISTANCE_DISTANCE_FACTORY_H_
 #define TANN_DISTANCE_DISTANCE_FACTORY_H_
 
-#include <type_traits>
-#include "tann/distance/primitive_distance.h"
+#include "tann/distance/distance_base.h"
+#include "tann/common/cpu_features.h"
 #include "tann/core/types.h"
 #include "turbo/base/result_status.h"
-#include "turbo/meta/reflect.h"
-#include "turbo/log/logging.h"
 
 namespace tann {
 
+    // the kernels of each simd tier are built in their own translation
+    // unit with the tier flags, see tann/CMakeLists.txt.
+    turbo::ResultStatus<DistanceBase*> create_distance_native(MetricType m, DataType dt, std::size_t dim = 0);
+
+    turbo::ResultStatus<DistanceBase*> create_distance_sse4(MetricType m, DataType dt, std::size_t dim = 0);
+
+    turbo::ResultStatus<DistanceBase*> create_distance_avx2(MetricType m, DataType dt, std::size_t dim = 0);
+
+    turbo::ResultStatus<DistanceBase*> create_distance_avx512(MetricType m, DataType dt, std::size_t dim = 0);
+
+    // the entries of the tier translation units, nullptr if the tier has
+    // no kernel for m and dt. They return a plain pointer so the tiers
+    // instantiate no status code, create_distance_* wraps them.
+    DistanceBase *new_distance_sse4(MetricType m, DataType dt, std::size_t dim);
+
+    DistanceBase *new_distance_avx2(MetricType m, DataType dt, std::size_t dim);
+
+    DistanceBase *new_distance_avx512(MetricType m, DataType dt, std::size_t dim);
+
     class DistanceFactory {
     public:
-        static inline turbo::ResultStatus<DistanceBase*> create_distance_factor(MetricType m, DataType dt) {
-            if (dt == DataType::DT_FLOAT16) {
-                switch (m) {
-                    case METRIC_L1:{
-                        return new PrimDistanceL1Float16();
-                    }
-                    case METRIC_L2: {
-                        return new PrimDistanceL2Float16();
-                    }
-                    case METRIC_IP: {
-                        return new PrimDistanceIPFloat16();
-                    }
-                    case METRIC_HAMMING:
-                    case METRIC_JACCARD:{
-                        return turbo::UnavailableError("float type do support {} type metric", turbo::nameof_enum(m));
-                    }
-                    case METRIC_COSINE: {
-                        return new PrimDistanceCosineFloat16();
-                    }
-                    case METRIC_ANGLE: {
-                        return new PrimDistanceAngleFloat16();
-                    }
-                    case METRIC_NORMALIZED_COSINE: {
-                        return new PrimDistanceNormalizedCosineFloat16();
-                    }
-                    case METRIC_NORMALIZED_ANGLE: {
-                        return new PrimDistanceNormalizedAngleFloat16();
-                    }
-                    case METRIC_NORMALIZED_L2: {
-                        return new PrimDistanceNormalizedL2Float16();
-                    }
-                    case METRIC_POINCARE: {
-                        return new PrimDistancePoincareFloat16();
-                    }
-                    case METRIC_LORENTZ: {
-                        return new PrimDistanceLorentzFloat16();
-                    }
-                    default:
-                        return turbo::UnknownError("unknown distance type: {}", static_cast<int>(m));
-                }
-            } else if (dt == DataType::DT_FLOAT) {
-                switch (m) {
-                    case METRIC_L1:{
-                        return new PrimDistanceL1Float();
-                    }
-                    case METRIC_L2: {
-                        return new PrimDistanceL2Float();
-                    }
-                    case METRIC_IP: {
-                        return new PrimDistanceIPFloat();
-                    }
-                    case METRIC_HAMMING:
-                    case METRIC_JACCARD:{
-                        return turbo::UnavailableError("float type do support {} type metric", turbo::nameof_enum(m));
-                    }
-                    case METRIC_COSINE: {
-                        return new PrimDistanceCosineFloat();
-                    }
-                    case METRIC_ANGLE: {
-                        return new PrimDistanceAngleFloat();
-                    }
-                    case METRIC_NORMALIZED_COSINE: {
-                        return new PrimDistanceNormalizedCosineFloat();
-                    }
-                    case METRIC_NORMALIZED_ANGLE: {
-                        return new PrimDistanceNormalizedAngleFloat();
-                    }
-                    case METRIC_NORMALIZED_L2: {
-                        return new PrimDistanceNormalizedL2Float();
-                    }
-                    case METRIC_POINCARE: {
-                        return new PrimDistancePoincareFloat();
-                    }
-                    case METRIC_LORENTZ: {
-                        return new PrimDistanceLorentzFloat();
-                    }
-                    default:
-                        return turbo::UnknownError("unknown distance type: {}", static_cast<int>(m));
-                }
-            } else if (dt == DataType::DT_UINT8) {
-                switch (m) {
-                    case METRIC_HAMMING:{
-                        return new PrimDistanceHammingUint8();
-                    }
-                    case METRIC_JACCARD:{
-                        return new PrimDistanceJaccardUint8();
-                    }
-                    case METRIC_L1:{
-                        return new PrimDistanceL1Uint8();
-                    }
-                    case METRIC_L2: {
-                        return new PrimDistanceL2Uint8();
-                    }
-                    case METRIC_IP: {
-                        return new PrimDistanceIPUint8();
-                    }
-                    case METRIC_COSINE: {
-                        TLOG_WARN("Although tann supports the {} measurement"
-                                  "method of this data type: uint8_t, it is not recommended"
-                                  "to use this type of integer data for this type of "
-                                  "measurement. It is recommended to use the floating "
-                                  "point data type to avoid the loss of numerical accuracy.",
-                                  turbo::nameof_enum(m));
-                        return new PrimDistanceCosineUint8();
-                    }
-                    case METRIC_ANGLE: {
-                        TLOG_WARN("Although tann supports the {} measurement"
-                                  "method of this data type: uint8_t, it is not recommended"
-                                  "to use this type of integer data for this type of "
-                                  "measurement. It is recommended to use the floating "
-                                  "point data type to avoid the loss of numerical accuracy.",
-                                  turbo::nameof_enum(m));
-                        return new PrimDistanceAngleUint8();
-                    }
-                    case METRIC_NORMALIZED_COSINE:
-                    case METRIC_NORMALIZED_ANGLE:
-                    case METRIC_NORMALIZED_L2:
-                    case METRIC_POINCARE:
-                    case METRIC_LORENTZ: {
-                        return turbo::UnavailableError("float type do support {} type metric", turbo::nameof_enum(m));
-                    }
-                    default:
-                        return turbo::UnknownError("unknown distance type: {}", static_cast<int>(m));
-                }
-            }
-            return nullptr;
-        }
+        // create the distance with the kernels of simd_level(), a known
+        // dim lets the factory pick kernels unrolled for it.
+        static turbo::ResultStatus<DistanceBase*> create_distance_factor(MetricType m, DataType dt, std::size_t dim = 0);
+
+        // name of the kernel tier create_distance_factor uses.
+        static std::string arch_name();
     };
 }  // namespace tann
 
@@ -0,0 +1,237 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef TANN_DISTANCE_DISTANCE_FACTORY_IMPL_H_
+#define TANN_DISTANCE_DISTANCE_FACTORY_IMPL_H_
+
+#include "tann/distance/simd_namespace.h"
+#include "tann/distance/primitive_distance.h"
+#include "tann/core/types.h"
+
+namespace tann {
+inline namespace TANN_SIMD_NAMESPACE {
+
+    template<std::size_t Dim>
+    inline DistanceBase *create_fixed_dim_distance(MetricType m) {
+        switch (m) {
+            case METRIC_L2:
+                return new PrimDistanceL2FloatDim<Dim>();
+            case METRIC_IP:
+                return new PrimDistanceIPFloatDim<Dim>();
+            default:
+                return nullptr;
+        }
+    }
+
+    // float kernels unrolled for the common embedding sizes,
+    // nullptr if there is none for m and dim.
+    inline DistanceBase *create_fixed_dim_distance(MetricType m, std::size_t dim) {
+        switch (dim) {
+            case 96:
+                return create_fixed_dim_distance<96>(m);
+            case 128:
+                return create_fixed_dim_distance<128>(m);
+            case 384:
+                return create_fixed_dim_distance<384>(m);
+            case 768:
+                return create_fixed_dim_distance<768>(m);
+            case 960:
+                return create_fixed_dim_distance<960>(m);
+            case 1536:
+                return create_fixed_dim_distance<1536>(m);
+            default:
+                return nullptr;
+        }
+    }
+
+    // the kernels of the tier this header is compiled for, dim 0
+    // means the dimension is unknown and the generic kernels are used.
+    // nullptr if the tier has no kernel for m and dt, the caller owns
+    // the error reporting so the tiers build no status or log code.
+    inline DistanceBase *new_prim_distance(MetricType m, DataType dt, std::size_t dim) {
+        if (dt == DataType::DT_FLOAT) {
+            auto *fixed = create_fixed_dim_distance(m, dim);
+            if (fixed != nullptr) {
+                return fixed;
+            }
+        }
+        if (dt == DataType::DT_FLOAT16) {
+            switch (m) {
+                case METRIC_L1:{
+                    return new PrimDistanceL1Float16();
+                }
+                case METRIC_L2: {
+                    return new PrimDistanceL2Float16();
+                }
+                case METRIC_IP: {
+                    return new PrimDistanceIPFloat16();
+                }
+                case METRIC_HAMMING:
+                case METRIC_JACCARD:{
+                    return nullptr;
+                }
+                case METRIC_COSINE: {
+                    return new PrimDistanceCosineFloat16();
+                }
+                case METRIC_ANGLE: {
+                    return new PrimDistanceAngleFloat16();
+                }
+                case METRIC_NORMALIZED_COSINE: {
+                    return new PrimDistanceNormalizedCosineFloat16();
+                }
+                case METRIC_NORMALIZED_ANGLE: {
+                    return new PrimDistanceNormalizedAngleFloat16();
+                }
+                case METRIC_NORMALIZED_L2: {
+                    return new PrimDistanceNormalizedL2Float16();
+                }
+                case METRIC_POINCARE: {
+                    return new PrimDistancePoincareFloat16();
+                }
+                case METRIC_LORENTZ: {
+                    return new PrimDistanceLorentzFloat16();
+                }
+                default:
+                    return nullptr;
+            }
+        } else if (dt == DataType::DT_BFLOAT16) {
+            switch (m) {
+                case METRIC_L1:{
+                    return new PrimDistanceL1BFloat16();
+                }
+                case METRIC_L2: {
+                    return new PrimDistanceL2BFloat16();
+                }
+                case METRIC_IP: {
+                    return new PrimDistanceIPBFloat16();
+                }
+                case METRIC_HAMMING:
+                case METRIC_JACCARD:{
+                    return nullptr;
+                }
+                case METRIC_COSINE: {
+                    return new PrimDistanceCosineBFloat16();
+                }
+                case METRIC_ANGLE: {
+                    return new PrimDistanceAngleBFloat16();
+                }
+                case METRIC_NORMALIZED_COSINE: {
+                    return new PrimDistanceNormalizedCosineBFloat16();
+                }
+                case METRIC_NORMALIZED_ANGLE: {
+                    return new PrimDistanceNormalizedAngleBFloat16();
+                }
+                case METRIC_NORMALIZED_L2: {
+                    return new PrimDistanceNormalizedL2BFloat16();
+                }
+                case METRIC_POINCARE: {
+                    return new PrimDistancePoincareBFloat16();
+                }
+                case METRIC_LORENTZ: {
+                    return new PrimDistanceLorentzBFloat16();
+                }
+                default:
+                    return nullptr;
+            }
+        } else if (dt == DataType::DT_FLOAT) {
+            switch (m) {
+                case METRIC_L1:{
+                    return new PrimDistanceL1Float();
+                }
+                case METRIC_L2: {
+                    return new PrimDistanceL2Float();
+                }
+                case METRIC_IP: {
+                    return new PrimDistanceIPFloat();
+                }
+                case METRIC_HAMMING:
+                case METRIC_JACCARD:{
+                    return nullptr;
+                }
+                case METRIC_COSINE: {
+                    return new PrimDistanceCosineFloat();
+                }
+                case METRIC_ANGLE: {
+                    return new PrimDistanceAngleFloat();
+                }
+                case METRIC_NORMALIZED_COSINE: {
+                    return new PrimDistanceNormalizedCosineFloat();
+                }
+                case METRIC_NORMALIZED_ANGLE: {
+                    return new PrimDistanceNormalizedAngleFloat();
+                }
+                case METRIC_NORMALIZED_L2: {
+                    return new PrimDistanceNormalizedL2Float();
+                }
+                case METRIC_POINCARE: {
+                    return new PrimDistancePoincareFloat();
+                }
+                case METRIC_LORENTZ: {
+                    return new PrimDistanceLorentzFloat();
+                }
+                default:
+                    return nullptr;
+            }
+        } else if (dt == DataType::DT_UINT8) {
+            switch (m) {
+                case METRIC_HAMMING:{
+                    return new PrimDistanceHammingUint8();
+                }
+                case METRIC_JACCARD:{
+                    return new PrimDistanceJaccardUint8();
+                }
+                case METRIC_L1:{
+                    return new PrimDistanceL1Uint8();
+                }
+                case METRIC_L2: {
+                    return new PrimDistanceL2Uint8();
+                }
+                case METRIC_IP: {
+                    return new PrimDistanceIPUint8();
+                }
+                case METRIC_COSINE: {
+                    return new PrimDistanceCosineUint8();
+                }
+                case METRIC_ANGLE: {
+                    return new PrimDistanceAngleUint8();
+                }
+                default:
+                    return nullptr;
+            }
+        } else if (dt == DataType::DT_INT8) {
+            switch (m) {
+                case METRIC_L1:{
+                    return new PrimDistanceL1Int8();
+                }
+                case METRIC_L2: {
+                    return new PrimDistanceL2Int8();
+                }
+                case METRIC_IP: {
+                    return new PrimDistanceIPInt8();
+                }
+                case METRIC_COSINE: {
+                    return new PrimDistanceCosineInt8();
+                }
+                case METRIC_ANGLE: {
+                    return new PrimDistanceAngleInt8();
+                }
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+}  // namespace TANN_SIMD_NAMESPACE
+}  // namespace tann
+
+#endif  // TANN_DISTANCE_DISTANCE_FACTORY_IMPL_H_
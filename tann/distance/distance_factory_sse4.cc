@@ -0,0 +1,27 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// built with the sse4 flags, see tann/CMakeLists.txt
+#if defined(TANN_WITH_SIMD_DISPATCH)
+#define TANN_SIMD_NAMESPACE simd_sse4
+#include "tann/distance/distance_factory.h"
+#include "tann/distance/distance_factory_impl.h"
+
+namespace tann {
+
+    DistanceBase *new_distance_sse4(MetricType m, DataType dt, std::size_t dim) {
+        return new_prim_distance(m, dt, dim);
+    }
+}  // namespace tann
+#endif  // TANN_WITH_SIMD_DISPATCH
@@ -0,0 +1,239 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef TANN_DISTANCE_HALF_KERNELS_H_
+#define TANN_DISTANCE_HALF_KERNELS_H_
+
+#include <cstddef>
+#include "tann/distance/simd_namespace.h"
+#include "tann/common/config.h"
+#include "turbo/simd/simd.h"
+
+namespace tann {
+inline namespace TANN_SIMD_NAMESPACE {
+    ////////////////////////////////////////////////////////////////////////////////////
+    // 16 bit float kernels, float16 is widened by F16C (vcvtph2ps), one by
+    // one on a tier without it, and bfloat16 by a 16 bit shift, the sums are
+    // kept in float lanes.
+    namespace kernels {
+
+        enum HalfOp : unsigned {
+            kHalfDot = 1,
+            kHalfNormA = 2,
+            kHalfNormB = 4,
+            kHalfL2 = 8,
+            kHalfL1 = 16
+        };
+
+        struct HalfSums {
+            float dot{0.0f};
+            float norm_a{0.0f};
+            float norm_b{0.0f};
+            float l2{0.0f};
+            float l1{0.0f};
+        };
+
+#if TURBO_WITH_AVX512F
+        inline __m512 load16_ps(const float16 *p) {
+            return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+        }
+
+        inline __m512 load16_ps(const bfloat16 *p) {
+            __m512i v = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+            return _mm512_castsi512_ps(_mm512_slli_epi32(v, 16));
+        }
+#endif
+
+#if TURBO_WITH_AVX2
+        inline __m256 load8_ps(const float16 *p) {
+            return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        }
+
+        inline __m256 load8_ps(const bfloat16 *p) {
+            __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+            return _mm256_castsi256_ps(_mm256_slli_epi32(v, 16));
+        }
+
+        inline __m256 madd8_ps(__m256 a, __m256 b, __m256 c) {
+#if defined(__FMA__)
+            return _mm256_fmadd_ps(a, b, c);
+#else
+            return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+        }
+
+        inline float reduce8_ps(__m256 v) {
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            __attribute__((aligned(16))) float f[4];
+            _mm_store_ps(f, s);
+            return f[0] + f[1] + f[2] + f[3];
+        }
+#endif
+
+#if TURBO_WITH_SSE2
+        // the sse4 tier does not require F16C
+        inline __m128 load4_ps(const float16 *p) {
+#if defined(__F16C__)
+            return _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+#else
+            return _mm_setr_ps(static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]),
+                               static_cast<float>(p[3]));
+#endif
+        }
+
+        // the bits go to the high half of each lane, sse2 only
+        inline __m128 load4_ps(const bfloat16 *p) {
+            __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+            return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), v));
+        }
+
+        inline float reduce4_ps(__m128 v) {
+            __attribute__((aligned(16))) float f[4];
+            _mm_store_ps(f, v);
+            return f[0] + f[1] + f[2] + f[3];
+        }
+#endif
+
+        // the sums selected by ops (HalfOp bits) of a and b in one pass,
+        // T is float16 or bfloat16. The tail is done in scalar, nothing is
+        // read past n.
+        template<unsigned ops, typename T>
+        inline HalfSums half_reduce(const T *pa, const T *pb, std::size_t n) {
+            HalfSums r;
+            std::size_t i = 0;
+#if TURBO_WITH_AVX512F
+            {
+                __m512 dot = _mm512_setzero_ps();
+                __m512 na = _mm512_setzero_ps();
+                __m512 nb = _mm512_setzero_ps();
+                __m512 l2 = _mm512_setzero_ps();
+                __m512 l1 = _mm512_setzero_ps();
+                for (; i + 16 <= n; i += 16) {
+                    __m512 x = load16_ps(pa + i);
+                    __m512 y = load16_ps(pb + i);
+                    if constexpr ((ops & kHalfDot) != 0) {
+                        dot = _mm512_fmadd_ps(x, y, dot);
+                    }
+                    if constexpr ((ops & kHalfNormA) != 0) {
+                        na = _mm512_fmadd_ps(x, x, na);
+                    }
+                    if constexpr ((ops & kHalfNormB) != 0) {
+                        nb = _mm512_fmadd_ps(y, y, nb);
+                    }
+                    if constexpr ((ops & (kHalfL2 | kHalfL1)) != 0) {
+                        __m512 d = _mm512_sub_ps(x, y);
+                        if constexpr ((ops & kHalfL2) != 0) {
+                            l2 = _mm512_fmadd_ps(d, d, l2);
+                        }
+                        if constexpr ((ops & kHalfL1) != 0) {
+                            l1 = _mm512_add_ps(l1, _mm512_abs_ps(d));
+                        }
+                    }
+                }
+                r.dot += _mm512_reduce_add_ps(dot);
+                r.norm_a += _mm512_reduce_add_ps(na);
+                r.norm_b += _mm512_reduce_add_ps(nb);
+                r.l2 += _mm512_reduce_add_ps(l2);
+                r.l1 += _mm512_reduce_add_ps(l1);
+            }
+#endif
+#if TURBO_WITH_AVX2
+            {
+                const __m256 sign = _mm256_set1_ps(-0.0f);
+                __m256 dot = _mm256_setzero_ps();
+                __m256 na = _mm256_setzero_ps();
+                __m256 nb = _mm256_setzero_ps();
+                __m256 l2 = _mm256_setzero_ps();
+                __m256 l1 = _mm256_setzero_ps();
+                for (; i + 8 <= n; i += 8) {
+                    __m256 x = load8_ps(pa + i);
+                    __m256 y = load8_ps(pb + i);
+                    if constexpr ((ops & kHalfDot) != 0) {
+                        dot = madd8_ps(x, y, dot);
+                    }
+                    if constexpr ((ops & kHalfNormA) != 0) {
+                        na = madd8_ps(x, x, na);
+                    }
+                    if constexpr ((ops & kHalfNormB) != 0) {
+                        nb = madd8_ps(y, y, nb);
+                    }
+                    if constexpr ((ops & (kHalfL2 | kHalfL1)) != 0) {
+                        __m256 d = _mm256_sub_ps(x, y);
+                        if constexpr ((ops & kHalfL2) != 0) {
+                            l2 = madd8_ps(d, d, l2);
+                        }
+                        if constexpr ((ops & kHalfL1) != 0) {
+                            l1 = _mm256_add_ps(l1, _mm256_andnot_ps(sign, d));
+                        }
+                    }
+                }
+                r.dot += reduce8_ps(dot);
+                r.norm_a += reduce8_ps(na);
+                r.norm_b += reduce8_ps(nb);
+                r.l2 += reduce8_ps(l2);
+                r.l1 += reduce8_ps(l1);
+            }
+#endif
+#if TURBO_WITH_SSE2
+            {
+                const __m128 sign = _mm_set1_ps(-0.0f);
+                __m128 dot = _mm_setzero_ps();
+                __m128 na = _mm_setzero_ps();
+                __m128 nb = _mm_setzero_ps();
+                __m128 l2 = _mm_setzero_ps();
+                __m128 l1 = _mm_setzero_ps();
+                for (; i + 4 <= n; i += 4) {
+                    __m128 x = load4_ps(pa + i);
+                    __m128 y = load4_ps(pb + i);
+                    if constexpr ((ops & kHalfDot) != 0) {
+                        dot = _mm_add_ps(dot, _mm_mul_ps(x, y));
+                    }
+                    if constexpr ((ops & kHalfNormA) != 0) {
+                        na = _mm_add_ps(na, _mm_mul_ps(x, x));
+                    }
+                    if constexpr ((ops & kHalfNormB) != 0) {
+                        nb = _mm_add_ps(nb, _mm_mul_ps(y, y));
+                    }
+                    if constexpr ((ops & (kHalfL2 | kHalfL1)) != 0) {
+                        __m128 d = _mm_sub_ps(x, y);
+                        if constexpr ((ops & kHalfL2) != 0) {
+                            l2 = _mm_add_ps(l2, _mm_mul_ps(d, d));
+                        }
+                        if constexpr ((ops & kHalfL1) != 0) {
+                            l1 = _mm_add_ps(l1, _mm_andnot_ps(sign, d));
+                        }
+                    }
+                }
+                r.dot += reduce4_ps(dot);
+                r.norm_a += reduce4_ps(na);
+                r.norm_b += reduce4_ps(nb);
+                r.l2 += reduce4_ps(l2);
+                r.l1 += reduce4_ps(l1);
+            }
+#endif
+            for (; i < n; ++i) {
+                float x = static_cast<float>(pa[i]);
+                float y = static_cast<float>(pb[i]);
+                r.dot += x * y;
+                r.norm_a += x * x;
+                r.norm_b += y * y;
+                r.l2 += (x - y) * (x - y);
+                r.l1 += x > y ? x - y : y - x;
+            }
+            return r;
+        }
+    }  // namespace kernels
+}  // namespace TANN_SIMD_NAMESPACE
+}  // namespace tann
+
+#endif  // TANN_DISTANCE_HALF_KERNELS_H_
@@ -0,0 +1,293 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef TANN_DISTANCE_POPCOUNT_KERNELS_H_
+#define TANN_DISTANCE_POPCOUNT_KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "tann/distance/simd_namespace.h"
+#include "tann/common/cpu_features.h"
+#include "turbo/simd/simd.h"
+#include "turbo/base/bits.h"
+
+// the avx512 tier is not built for VPOPCNTDQ, its kernels are compiled for
+// it by the target attribute and only called when the cpu has it.
+#if TURBO_WITH_AVX512BW
+#if defined(__AVX512VPOPCNTDQ__)
+#define TANN_VPOPCNT_TARGET
+#else
+#define TANN_VPOPCNT_TARGET __attribute__((target("avx512vpopcntdq")))
+#endif
+#endif
+
+namespace tann {
+inline namespace TANN_SIMD_NAMESPACE {
+    ////////////////////////////////////////////////////////////////////////////////////
+    // population count kernels for binary codes. vpopcntq counts 64 bit lanes on
+    // AVX-512 cpus that have it, AVX2 counts nibbles with pshufb and folds blocks of
+    // 16 vectors with a Harley-Seal carry save adder tree, the rest uses popcnt.
+    // Loads are unaligned and nothing is read past the codes.
+    namespace kernels {
+
+        enum BitOp : unsigned {
+            kBitXor,
+            kBitAnd,
+            kBitOr
+        };
+
+        template<BitOp op>
+        inline uint64_t bit_op64(uint64_t a, uint64_t b) {
+            if constexpr (op == kBitXor) {
+                return a ^ b;
+            } else if constexpr (op == kBitAnd) {
+                return a & b;
+            } else {
+                return a | b;
+            }
+        }
+
+        template<BitOp op>
+        inline uint64_t bit_count_scalar(const uint8_t *pa, const uint8_t *pb, std::size_t n) {
+            uint64_t count = 0;
+            std::size_t i = 0;
+            for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+                uint64_t a;
+                uint64_t b;
+                std::memcpy(&a, pa + i, sizeof(a));
+                std::memcpy(&b, pb + i, sizeof(b));
+                count += turbo::popcount(bit_op64<op>(a, b));
+            }
+            for (; i < n; ++i) {
+                count += turbo::popcount(bit_op64<op>(pa[i], pb[i]));
+            }
+            return count;
+        }
+
+#if TURBO_WITH_AVX512BW
+        inline bool has_vpopcntdq() {
+#if defined(__AVX512VPOPCNTDQ__)
+            return true;
+#else
+            static const bool has = cpu_features().avx512vpopcntdq;
+            return has;
+#endif
+        }
+
+        template<BitOp op>
+        inline __m512i bit_op512(__m512i a, __m512i b) {
+            if constexpr (op == kBitXor) {
+                return _mm512_xor_si512(a, b);
+            } else if constexpr (op == kBitAnd) {
+                return _mm512_and_si512(a, b);
+            } else {
+                return _mm512_or_si512(a, b);
+            }
+        }
+
+        // the tail is read by a masked load, the masked out bytes are zero
+        // and count nothing for every op.
+        inline __mmask64 tail_mask64(std::size_t n) {
+            return n >= 64 ? ~__mmask64(0) : (__mmask64(1) << n) - 1;
+        }
+
+        template<BitOp op>
+        TANN_VPOPCNT_TARGET inline uint64_t bit_count_vpopcnt(const uint8_t *pa, const uint8_t *pb, std::size_t n) {
+            __m512i acc = _mm512_setzero_si512();
+            std::size_t i = 0;
+            for (; i + 64 <= n; i += 64) {
+                __m512i a = _mm512_loadu_si512(pa + i);
+                __m512i b = _mm512_loadu_si512(pb + i);
+                acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(bit_op512<op>(a, b)));
+            }
+            if (i < n) {
+                __mmask64 m = tail_mask64(n - i);
+                __m512i a = _mm512_maskz_loadu_epi8(m, pa + i);
+                __m512i b = _mm512_maskz_loadu_epi8(m, pb + i);
+                acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(bit_op512<op>(a, b)));
+            }
+            return _mm512_reduce_add_epi64(acc);
+        }
+
+        // codes of at most 64 bytes, the query stays in a register.
+        template<BitOp op, typename Out>
+        TANN_VPOPCNT_TARGET inline void
+        bit_count_many_vpopcnt(const uint8_t *q, const uint8_t *base, std::size_t size, std::size_t stride,
+                               std::size_t n, Out *out) {
+            __mmask64 m = tail_mask64(size);
+            __m512i qv = _mm512_maskz_loadu_epi8(m, q);
+            for (std::size_t j = 0; j < n; ++j) {
+                __m512i v = _mm512_maskz_loadu_epi8(m, base + j * stride);
+                out[j] = static_cast<Out>(_mm512_reduce_add_epi64(_mm512_popcnt_epi64(bit_op512<op>(qv, v))));
+            }
+        }
+#endif
+
+#if TURBO_WITH_AVX2
+        inline __m256i load256(const uint8_t *p) {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        }
+
+        template<BitOp op>
+        inline __m256i bit_op256(__m256i a, __m256i b) {
+            if constexpr (op == kBitXor) {
+                return _mm256_xor_si256(a, b);
+            } else if constexpr (op == kBitAnd) {
+                return _mm256_and_si256(a, b);
+            } else {
+                return _mm256_or_si256(a, b);
+            }
+        }
+
+        template<BitOp op>
+        inline __m256i load_op256(const uint8_t *pa, const uint8_t *pb) {
+            return bit_op256<op>(load256(pa), load256(pb));
+        }
+
+        // bit count of each 64 bit lane, nibbles are looked up by pshufb
+        // and the bytes summed by psadbw.
+        inline __m256i popcount256(__m256i v) {
+            const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+            const __m256i low_mask = _mm256_set1_epi8(0x0f);
+            __m256i lo = _mm256_and_si256(v, low_mask);
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+            __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+            return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+        }
+
+        // carry save adder, a + b + c = 2 * h + l bitwise.
+        inline void csa256(__m256i &h, __m256i &l, __m256i a, __m256i b, __m256i c) {
+            __m256i u = _mm256_xor_si256(a, b);
+            h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+            l = _mm256_xor_si256(u, c);
+        }
+
+        inline uint64_t reduce256_epi64(__m256i v) {
+            return static_cast<uint64_t>(_mm256_extract_epi64(v, 0)) + static_cast<uint64_t>(_mm256_extract_epi64(v, 1)) +
+                   static_cast<uint64_t>(_mm256_extract_epi64(v, 2)) + static_cast<uint64_t>(_mm256_extract_epi64(v, 3));
+        }
+
+        // W vectors of 32 bytes per code, the query stays in registers.
+        template<BitOp op, std::size_t W, typename Out>
+        inline void bit_count_many_avx2(const uint8_t *q, const uint8_t *base, std::size_t stride,
+                                        std::size_t n, Out *out) {
+            __m256i qv[W];
+            for (std::size_t k = 0; k < W; ++k) {
+                qv[k] = load256(q + 32 * k);
+            }
+            for (std::size_t j = 0; j < n; ++j) {
+                const uint8_t *p = base + j * stride;
+                __m256i acc = popcount256(bit_op256<op>(qv[0], load256(p)));
+                for (std::size_t k = 1; k < W; ++k) {
+                    acc = _mm256_add_epi64(acc, popcount256(bit_op256<op>(qv[k], load256(p + 32 * k))));
+                }
+                out[j] = static_cast<Out>(reduce256_epi64(acc));
+            }
+        }
+#endif
+
+        // number of set bits of a op b over n bytes.
+        template<BitOp op>
+        inline uint64_t bit_count(const uint8_t *pa, const uint8_t *pb, std::size_t n) {
+#if TURBO_WITH_AVX512BW
+            if (has_vpopcntdq()) {
+                return bit_count_vpopcnt<op>(pa, pb, n);
+            }
+#endif
+            uint64_t count = 0;
+            std::size_t i = 0;
+#if TURBO_WITH_AVX2
+            {
+                __m256i total = _mm256_setzero_si256();
+                __m256i ones = _mm256_setzero_si256();
+                __m256i twos = _mm256_setzero_si256();
+                __m256i fours = _mm256_setzero_si256();
+                __m256i eights = _mm256_setzero_si256();
+                __m256i twos_a, twos_b, fours_a, fours_b, eights_a, eights_b, sixteens;
+                for (; i + 16 * 32 <= n; i += 16 * 32) {
+                    auto v = [&](std::size_t k) {
+                        return load_op256<op>(pa + i + 32 * k, pb + i + 32 * k);
+                    };
+                    csa256(twos_a, ones, ones, v(0), v(1));
+                    csa256(twos_b, ones, ones, v(2), v(3));
+                    csa256(fours_a, twos, twos, twos_a, twos_b);
+                    csa256(twos_a, ones, ones, v(4), v(5));
+                    csa256(twos_b, ones, ones, v(6), v(7));
+                    csa256(fours_b, twos, twos, twos_a, twos_b);
+                    csa256(eights_a, fours, fours, fours_a, fours_b);
+                    csa256(twos_a, ones, ones, v(8), v(9));
+                    csa256(twos_b, ones, ones, v(10), v(11));
+                    csa256(fours_a, twos, twos, twos_a, twos_b);
+                    csa256(twos_a, ones, ones, v(12), v(13));
+                    csa256(twos_b, ones, ones, v(14), v(15));
+                    csa256(fours_b, twos, twos, twos_a, twos_b);
+                    csa256(eights_b, fours, fours, fours_a, fours_b);
+                    csa256(sixteens, eights, eights, eights_a, eights_b);
+                    total = _mm256_add_epi64(total, popcount256(sixteens));
+                }
+                total = _mm256_slli_epi64(total, 4);
+                total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(eights), 3));
+                total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(fours), 2));
+                total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(twos), 1));
+                total = _mm256_add_epi64(total, popcount256(ones));
+                for (; i + 32 <= n; i += 32) {
+                    total = _mm256_add_epi64(total, popcount256(load_op256<op>(pa + i, pb + i)));
+                }
+                count += reduce256_epi64(total);
+            }
+#endif
+            return count + bit_count_scalar<op>(pa + i, pb + i, n - i);
+        }
+
+        // bit_count of the query q against n codes of size bytes, the j-th
+        // code starts at base + j * stride.
+        template<BitOp op, typename Out>
+        inline void bit_count_many(const uint8_t *q, const uint8_t *base, std::size_t size, std::size_t stride,
+                                   std::size_t n, Out *out) {
+#if TURBO_WITH_AVX512BW
+            if (size <= 64 && has_vpopcntdq()) {
+                bit_count_many_vpopcnt<op>(q, base, size, stride, n, out);
+                return;
+            }
+#endif
+#if TURBO_WITH_AVX2
+            switch (size) {
+                case 32:
+                    bit_count_many_avx2<op, 1>(q, base, stride, n, out);
+                    return;
+                case 64:
+                    bit_count_many_avx2<op, 2>(q, base, stride, n, out);
+                    return;
+                case 96:
+                    bit_count_many_avx2<op, 3>(q, base, stride, n, out);
+                    return;
+                case 128:
+                    bit_count_many_avx2<op, 4>(q, base, stride, n, out);
+                    return;
+                default:
+                    break;
+            }
+#endif
+            for (std::size_t j = 0; j < n; ++j) {
+                out[j] = static_cast<Out>(bit_count<op>(q, base + j * stride, size));
+            }
+        }
+    }  // namespace kernels
+}  // namespace TANN_SIMD_NAMESPACE
+}  // namespace tann
+
+#undef TANN_VPOPCNT_TARGET
+
+#endif  // TANN_DISTANCE_POPCOUNT_KERNELS_H_
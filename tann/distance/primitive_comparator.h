@@ -15,13 +15,27 @@
 #ifndef TANN_DISTANCE_PRIMITIVE_COMPARATOR_H_
 #define TANN_DISTANCE_PRIMITIVE_COMPARATOR_H_
 
+#include "tann/distance/simd_namespace.h"
 #include "tann/common/config.h"
+#include "tann/common/unroll.h"
+#include "tann/distance/popcount_kernels.h"
 #include "turbo/simd/simd.h"
 #include "turbo/meta/span.h"
-#include "turbo/log/logging.h"
+#include "tann/distance/distance_base.h"
 #include "turbo/base/bits.h"
 
+// the avx512 tier is not built for VNNI, its int8 kernel is compiled for
+// it by the target attribute and only called when the cpu has it.
+#if TURBO_WITH_AVX512BW
+#if defined(__AVX512VNNI__)
+#define TANN_VNNI_TARGET
+#else
+#define TANN_VNNI_TARGET __attribute__((target("avx512vnni")))
+#endif
+#endif
+
 namespace tann {
+inline namespace TANN_SIMD_NAMESPACE {
 
     class PrimComparator {
     public:
@@ -77,7 +91,7 @@ namespace tann {
             constexpr bool is_float_type = std::is_floating_point_v<T>;
             bool is_aligned = turbo::simd::is_aligned(static_cast<const T *>(a.data())) &&
                               turbo::simd::is_aligned(static_cast<const T *>(b.data()));
-            TLOG_CHECK(is_aligned, "the memory must be aligned");
+            TANN_DISTANCE_CHECK(is_aligned, "the memory must be aligned");
             std::size_t inc = b_type::size;
             std::size_t size = a.size();
             // size for which the vectorization is possible
@@ -98,6 +112,25 @@ namespace tann {
             return sum;
         }
 
+        // elements compared between two checks of the bound in the
+        // *_bounded kernels, a multiple of every simd alignment.
+        static constexpr std::size_t kBoundedBlock = 128;
+
+        // compare_l1 in blocks, stops when the partial sum is
+        // greater than upper_bound.
+        template<typename T>
+        inline static double compare_l1_bounded(const turbo::Span<T> &a, const turbo::Span<T> &b, double upper_bound) {
+            double sum = 0.0;
+            for (std::size_t i = 0; i < a.size(); i += kBoundedBlock) {
+                auto n = std::min(kBoundedBlock, a.size() - i);
+                sum += compare_l1(a.subspan(i, n), b.subspan(i, n));
+                if (sum > upper_bound) {
+                    break;
+                }
+            }
+            return sum;
+        }
+
         // l2 comparators
         template<typename T, typename COMPARE_TYPE>
         inline static double simple_compare_l2(const turbo::Span<T> &a, const turbo::Span<T> &b) {
@@ -137,10 +170,12 @@ namespace tann {
             return simple_compare_l2<float16, double>(a, b);
         }
 
+        // squared l2 with float accumulators, it ranks the same as
+        // compare_l2 and is what the search uses.
         template<typename T>
-        inline static double compare_l2(const turbo::Span<T> &a, const turbo::Span<T> &b) {
-            TLOG_CHECK( turbo::simd::is_aligned(a.data()), "{} not aligned", turbo::Ptr(a.data()));
-            TLOG_CHECK( turbo::simd::is_aligned(b.data()), "{} not aligned", turbo::Ptr(b.data()));
+        inline static float compare_l2_sqr(const turbo::Span<T> &a, const turbo::Span<T> &b) {
+            TANN_DISTANCE_CHECK(turbo::simd::is_aligned(a.data()), "the memory must be aligned");
+            TANN_DISTANCE_CHECK(turbo::simd::is_aligned(b.data()), "the memory must be aligned");
             using b_type = turbo::simd::batch<T, turbo::simd::default_arch>;
             static_assert(sizeof(T) >= 4, "sizeof(T) >= 4");
             std::size_t inc = b_type::size;
@@ -148,19 +183,91 @@ namespace tann {
             // size for which the vectorization is possible
             std::size_t vec_size = size - size % inc;
             b_type sum_v = b_type::broadcast(0.0);
-            double sum = 0.0;
             for (std::size_t i = 0; i < vec_size; i += inc) {
                 b_type avec = b_type::load(&a[i], turbo::simd::unaligned_mode());
                 b_type bvec = b_type::load(&b[i], turbo::simd::unaligned_mode());
                 auto diff = avec - bvec;
                 sum_v += turbo::simd::mul(diff, diff);
             }
-            sum += turbo::simd::reduce_add(sum_v);
+            float sum = turbo::simd::reduce_add(sum_v);
             for (std::size_t i = vec_size; i < size; ++i) {
                 auto df = a[i] - b[i];
                 sum += df * df;
             }
-            return sqrt(sum);
+            return sum;
+        }
+
+        template<typename T>
+        inline static double compare_l2(const turbo::Span<T> &a, const turbo::Span<T> &b) {
+            return sqrt(static_cast<double>(compare_l2_sqr(a, b)));
+        }
+
+        // compare_l2_sqr in blocks, stops when the partial sum is
+        // greater than upper_bound.
+        template<typename T>
+        inline static float compare_l2_sqr_bounded(const turbo::Span<T> &a, const turbo::Span<T> &b, double upper_bound) {
+            float sum = 0.0f;
+            for (std::size_t i = 0; i < a.size(); i += kBoundedBlock) {
+                auto n = std::min(kBoundedBlock, a.size() - i);
+                sum += compare_l2_sqr(a.subspan(i, n), b.subspan(i, n));
+                if (sum > upper_bound) {
+                    break;
+                }
+            }
+            return sum;
+        }
+
+        // squared l2 for a dimension known at compile time, fully unrolled
+        // with two accumulators, no tail and no alignment checks.
+        template<std::size_t Dim>
+        inline static float compare_l2_sqr_fixed(const float *a, const float *b) {
+            using b_type = turbo::simd::batch<float, turbo::simd::default_arch>;
+            constexpr std::size_t inc = b_type::size;
+            static_assert(Dim % (2 * inc) == 0, "Dim must be a multiple of two batches");
+            b_type s0 = b_type::broadcast(0.0f);
+            b_type s1 = b_type::broadcast(0.0f);
+            unroll<Dim / (2 * inc)>([&](auto k) {
+                constexpr std::size_t i = decltype(k)::value * 2 * inc;
+                b_type d0 = b_type::load(a + i, turbo::simd::unaligned_mode()) -
+                            b_type::load(b + i, turbo::simd::unaligned_mode());
+                b_type d1 = b_type::load(a + i + inc, turbo::simd::unaligned_mode()) -
+                            b_type::load(b + i + inc, turbo::simd::unaligned_mode());
+                s0 += d0 * d0;
+                s1 += d1 * d1;
+            });
+            return turbo::simd::reduce_add(s0 + s1);
+        }
+
+        template<std::size_t Dim>
+        inline static float compare_l2_sqr_fixed_bounded(const float *a, const float *b, double upper_bound) {
+            // the largest block of at most 128 elements that divides Dim
+            constexpr std::size_t block = Dim % 128 == 0 ? 128 : (Dim % 64 == 0 ? 64 : 32);
+            static_assert(Dim % block == 0, "Dim must be a multiple of 32");
+            float sum = 0.0f;
+            for (std::size_t i = 0; i < Dim; i += block) {
+                sum += compare_l2_sqr_fixed<block>(a + i, b + i);
+                if (sum > upper_bound) {
+                    break;
+                }
+            }
+            return sum;
+        }
+
+        template<std::size_t Dim>
+        inline static float compare_inner_product_fixed(const float *a, const float *b) {
+            using b_type = turbo::simd::batch<float, turbo::simd::default_arch>;
+            constexpr std::size_t inc = b_type::size;
+            static_assert(Dim % (2 * inc) == 0, "Dim must be a multiple of two batches");
+            b_type s0 = b_type::broadcast(0.0f);
+            b_type s1 = b_type::broadcast(0.0f);
+            unroll<Dim / (2 * inc)>([&](auto k) {
+                constexpr std::size_t i = decltype(k)::value * 2 * inc;
+                s0 += b_type::load(a + i, turbo::simd::unaligned_mode()) *
+                      b_type::load(b + i, turbo::simd::unaligned_mode());
+                s1 += b_type::load(a + i + inc, turbo::simd::unaligned_mode()) *
+                      b_type::load(b + i + inc, turbo::simd::unaligned_mode());
+            });
+            return turbo::simd::reduce_add(s0 + s1);
         }
         /////
         /// hamming distance
@@ -179,38 +286,22 @@ namespace tann {
             return static_cast<double>(count);
         }
 
-        template<size_t N>
-        inline static double popcount(const turbo::simd::batch<uint64_t, turbo::simd::default_arch> &a) {
-            TLOG_CHECK(false, "not impl");
-            return 0;
-        }
-
+        // T is any unsigned type, the codes are compared as bytes.
         template<typename T>
         inline static double compare_hamming(const turbo::Span<T> &a, const turbo::Span<T> &b) {
-            using b_type = turbo::simd::batch<T, turbo::simd::default_arch>;
-            using cb_type = turbo::simd::batch<uint64_t, turbo::simd::default_arch>;
             static_assert(std::is_integral_v<T>, "must be integer typer");
             static_assert(std::is_unsigned_v<T>, "must be integer typer");
-            bool is_aligned = turbo::simd::is_aligned(static_cast<const T *>(a.data())) &&
-                              turbo::simd::is_aligned(static_cast<const T *>(b.data()));
-            TLOG_CHECK(is_aligned, "the memory must be aligned");
-            std::size_t inc = b_type::size;
-            std::size_t size = a.size();
-            // size for which the vectorization is possible
-            std::size_t vec_size = size - size % inc;
-            constexpr size_t neles = turbo::simd::default_arch::alignment() / sizeof(uint64_t);
-            double sum = 0.0;
-            for (std::size_t i = 0; i < vec_size; i += inc) {
-                cb_type avec = cb_type::load(reinterpret_cast<const uint64_t *>(&a[i]), turbo::simd::aligned_mode());
-                cb_type bvec = cb_type::load(reinterpret_cast<const uint64_t *>(&b[i]), turbo::simd::aligned_mode());
-                sum += popcount<neles>(avec ^ bvec);
+            return static_cast<double>(kernels::bit_count<kernels::kBitXor>(
+                    reinterpret_cast<const uint8_t *>(a.data()), reinterpret_cast<const uint8_t *>(b.data()),
+                    a.size() * sizeof(T)));
+        }
 
-            }
-            for (std::size_t i = vec_size; i < size; i += sizeof(uint64_t)) {
-                sum += turbo::popcount(
-                        *reinterpret_cast<const uint64_t *>(&a[i]) ^ *reinterpret_cast<const uint64_t *>(&b[i]));
-            }
-            return sum;
+        // compare_hamming of a against out.size() codes of a.size() bytes,
+        // the i-th code starts at bs + i * stride.
+        inline static void
+        compare_hamming_batch(const turbo::Span<uint8_t> &a, const uint8_t *bs, std::size_t stride,
+                              turbo::Span<double> out) {
+            kernels::bit_count_many<kernels::kBitXor>(a.data(), bs, a.size(), stride, out.size(), out.data());
         }
 
         ////////////
@@ -234,34 +325,13 @@ namespace tann {
 
         template<typename T>
         inline static double compare_jaccard(const turbo::Span<T> &a, const turbo::Span<T> &b) {
-            using b_type = turbo::simd::batch<T, turbo::simd::default_arch>;
-            using cb_type = turbo::simd::batch<uint64_t, turbo::simd::default_arch>;
             static_assert(std::is_integral_v<T>, "must be integer typer");
             static_assert(std::is_unsigned_v<T>, "must be integer typer");
-            bool is_aligned = turbo::simd::is_aligned(static_cast<const T *>(a.data())) &&
-                              turbo::simd::is_aligned(static_cast<const T *>(b.data()));
-            TLOG_CHECK(is_aligned, "the memory must be aligned");
-            std::size_t inc = b_type::size;
-            std::size_t size = a.size();
-            // size for which the vectorization is possible
-            std::size_t vec_size = size - size % inc;
-            constexpr size_t neles = turbo::simd::default_arch::alignment() / sizeof(uint64_t);
-            double sum = 0.0;
-            double sum_de = 0.0;
-            for (std::size_t i = 0; i < vec_size; i += inc) {
-                cb_type avec = cb_type::load(reinterpret_cast<const uint64_t *>(&a[i]), turbo::simd::aligned_mode());
-                cb_type bvec = cb_type::load(reinterpret_cast<const uint64_t *>(&b[i]), turbo::simd::aligned_mode());
-
-                sum += popcount<neles>(avec & bvec);
-                sum_de += popcount<neles>(avec | bvec);
-
-            }
-            for (std::size_t i = vec_size; i < size; i += sizeof(uint64_t)) {
-                sum += turbo::popcount(
-                        *reinterpret_cast<const uint64_t *>(&a[i]) & *reinterpret_cast<const uint64_t *>(&b[i]));
-                sum_de += turbo::popcount(
-                        *reinterpret_cast<const uint64_t *>(&a[i]) | *reinterpret_cast<const uint64_t *>(&b[i]));
-            }
+            auto pa = reinterpret_cast<const uint8_t *>(a.data());
+            auto pb = reinterpret_cast<const uint8_t *>(b.data());
+            auto n = a.size() * sizeof(T);
+            auto sum = static_cast<double>(kernels::bit_count<kernels::kBitAnd>(pa, pb, n));
+            auto sum_de = static_cast<double>(kernels::bit_count<kernels::kBitOr>(pa, pb, n));
             return 1.0 - sum / sum_de;
         }
 
@@ -291,7 +361,7 @@ namespace tann {
             using b_type = turbo::simd::batch<T, turbo::simd::default_arch>;
             bool is_aligned = turbo::simd::is_aligned(static_cast<const T *>(a.data())) &&
                               turbo::simd::is_aligned(static_cast<const T *>(b.data()));
-            TLOG_CHECK(is_aligned, "the memory must be aligned");
+            TANN_DISTANCE_CHECK(is_aligned, "the memory must be aligned");
             static_assert(sizeof(T) >= 4, "sizeof(T) >= 4");
             std::size_t inc = b_type::size;
             std::size_t size = a.size();
@@ -324,9 +394,7 @@ namespace tann {
 
         //////////////////////////////
         /// angle distance
-        template<typename T>
-        inline static double compare_angle(const turbo::Span<T> &a, const turbo::Span<T> &b) {
-            double cosine = compare_cosine(a, b);
+        inline static double cosine_to_angle(double cosine) {
             if (cosine >= 1.0) {
                 return 0.0;
             } else if (cosine <= -1.0) {
@@ -336,6 +404,11 @@ namespace tann {
             }
         }
 
+        template<typename T>
+        inline static double compare_angle(const turbo::Span<T> &a, const turbo::Span<T> &b) {
+            return cosine_to_angle(compare_cosine(a, b));
+        }
+
         template<typename T>
         inline static double
         simple_compare_inner_product(const turbo::Span<T> &a, const turbo::Span<T> &b) {
@@ -352,7 +425,7 @@ namespace tann {
             using b_type = turbo::simd::batch<T, turbo::simd::default_arch>;
             bool is_aligned = turbo::simd::is_aligned(static_cast<const T *>(a.data())) &&
                               turbo::simd::is_aligned(static_cast<const T *>(b.data()));
-            TLOG_CHECK(is_aligned, "the memory must be aligned");
+            TANN_DISTANCE_CHECK(is_aligned, "the memory must be aligned");
             static_assert(sizeof(T) >= 4, "sizeof(T) >= 4");
             std::size_t inc = b_type::size;
             std::size_t size = a.size();
@@ -423,12 +496,14 @@ namespace tann {
             return std::acosh(1 + 2.0 * c2 * c2 / (1.0 - sum_a) / (1.0 - sum_b));
         }
 
+        // 2 * |a - b|^2 / ((1 - |a|^2) * (1 - |b|^2)) in one pass, the poincare
+        // distance is acosh(1 + rank) and grows with it, the engines rank by it.
         template<typename T>
-        inline static double compare_poincare(const turbo::Span<T> &a, const turbo::Span<T> &b) {
+        inline static double compare_poincare_rank(const turbo::Span<T> &a, const turbo::Span<T> &b) {
             using b_type = turbo::simd::batch<T, turbo::simd::default_arch>;
             bool is_aligned = turbo::simd::is_aligned(static_cast<const T *>(a.data())) &&
                               turbo::simd::is_aligned(static_cast<const T *>(b.data()));
-            TLOG_CHECK(is_aligned, "the memory must be aligned");
+            TANN_DISTANCE_CHECK(is_aligned, "the memory must be aligned");
             static_assert(sizeof(T) >= 4, "sizeof(T) >= 4");
             std::size_t inc = b_type::size;
             std::size_t size = a.size();
@@ -457,7 +532,12 @@ namespace tann {
                 sum_a += a[i] * a[i];
                 sum_b += b[i] * b[i];
             }
-            return std::acosh(1 + 2.0 * sum / (1.0 - sum_a) / (1.0 - sum_b));
+            return 2.0 * sum / (1.0 - sum_a) / (1.0 - sum_b);
+        }
+
+        template<typename T>
+        inline static double compare_poincare(const turbo::Span<T> &a, const turbo::Span<T> &b) {
+            return std::acosh(1 + compare_poincare_rank(a, b));
         }
 
         template<typename T>
@@ -469,261 +549,265 @@ namespace tann {
             return std::acosh(sum);
         }
 
+        // a0 * b0 - a1 * b1 - ... - an * bn by the simd inner product, the
+        // lorentz distance is acosh(rank) and grows with it.
         template<typename T>
-        inline static double compare_lorentz(const turbo::Span<T> &a, const turbo::Span<T> &b) {
+        inline static double compare_lorentz_rank(const turbo::Span<T> &a, const turbo::Span<T> &b) {
             double sum = static_cast<double>(a[0]) * static_cast<double>(b[0]);
-            auto ip = compare_inner_product(a, b);
-            sum = sum * 2 - ip;
-            return std::acosh(sum);
+            return sum * 2 - compare_inner_product(a, b);
+        }
+
+        template<typename T>
+        inline static double compare_lorentz(const turbo::Span<T> &a, const turbo::Span<T> &b) {
+            return std::acosh(compare_lorentz_rank(a, b));
         }
     };
 
+    ////////////////////////////////////////////////////////////////////////////////////
+    // 8 bit integer kernels
+    namespace kernels {
+        enum class Int8Op {
+            L2,
+            IP
+        };
+
+#if TURBO_WITH_AVX512BW
+        inline bool has_avx512vnni() {
+#if defined(__AVX512VNNI__)
+            return true;
+#else
+            static const bool has = cpu_features().avx512vnni;
+            return has;
+#endif
+        }
+
+        // 32 lanes of a and b widened to int16, x * y is the term to sum
+        template<Int8Op op, typename T>
+        inline void int8_widen512(const T *pa, const T *pb, __m512i &x, __m512i &y) {
+            __m256i ra = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pa));
+            __m256i rb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pb));
+            if constexpr (std::is_signed_v<T>) {
+                x = _mm512_cvtepi8_epi16(ra);
+                y = _mm512_cvtepi8_epi16(rb);
+            } else {
+                x = _mm512_cvtepu8_epi16(ra);
+                y = _mm512_cvtepu8_epi16(rb);
+            }
+            if constexpr (op == Int8Op::L2) {
+                x = _mm512_sub_epi16(x, y);
+                y = x;
+            }
+        }
+
+        template<Int8Op op, typename T>
+        inline int64_t int8_reduce512(const T *pa, const T *pb, std::size_t n, std::size_t &i) {
+            __m512i acc = _mm512_setzero_si512();
+            for (; i + 32 <= n; i += 32) {
+                __m512i x, y;
+                int8_widen512<op>(pa + i, pb + i, x, y);
+                acc = _mm512_add_epi32(acc, _mm512_madd_epi16(x, y));
+            }
+            return _mm512_reduce_add_epi32(acc);
+        }
+
+        // vpdpwssd folds the products in one instruction
+        template<Int8Op op, typename T>
+        TANN_VNNI_TARGET inline int64_t int8_reduce512_vnni(const T *pa, const T *pb, std::size_t n, std::size_t &i) {
+            __m512i acc = _mm512_setzero_si512();
+            for (; i + 32 <= n; i += 32) {
+                __m512i x, y;
+                int8_widen512<op>(pa + i, pb + i, x, y);
+                acc = _mm512_dpwssd_epi32(acc, x, y);
+            }
+            return _mm512_reduce_add_epi32(acc);
+        }
+#endif
+
+        // sum of (a - b)^2 or a * b over uint8_t or int8_t vectors. The lanes are
+        // widened to int16 and folded into int32 accumulators by pmaddwd, or by
+        // vpdpwssd on avx512 cpus with vnni. The int32 lanes hold at least
+        // 16k folds, far more than any dimension we index.
+        template<Int8Op op, typename T>
+        inline int64_t int8_reduce(const T *pa, const T *pb, std::size_t n) {
+            static_assert(sizeof(T) == 1, "8 bit integer only");
+            constexpr bool is_signed = std::is_signed_v<T>;
+            std::size_t i = 0;
+            int64_t sum = 0;
+#if TURBO_WITH_AVX512BW
+            sum += has_avx512vnni() ? int8_reduce512_vnni<op>(pa, pb, n, i) : int8_reduce512<op>(pa, pb, n, i);
+#endif
+#if TURBO_WITH_AVX2
+            __m256i acc256 = _mm256_setzero_si256();
+            for (; i + 16 <= n; i += 16) {
+                __m128i ra = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pa + i));
+                __m128i rb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pb + i));
+                __m256i x, y;
+                if constexpr (is_signed) {
+                    x = _mm256_cvtepi8_epi16(ra);
+                    y = _mm256_cvtepi8_epi16(rb);
+                } else {
+                    x = _mm256_cvtepu8_epi16(ra);
+                    y = _mm256_cvtepu8_epi16(rb);
+                }
+                if constexpr (op == Int8Op::L2) {
+                    x = _mm256_sub_epi16(x, y);
+                    y = x;
+                }
+                acc256 = _mm256_add_epi32(acc256, _mm256_madd_epi16(x, y));
+            }
+            __m128i acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc256), _mm256_extracti128_si256(acc256, 1));
+#else
+            __m128i acc128 = _mm_setzero_si128();
+#endif
+            for (; i + 8 <= n; i += 8) {
+                __m128i ra = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pa + i));
+                __m128i rb = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pb + i));
+                // widened with sse2 unpacks, the baseline unit has no sse4.1
+                __m128i x, y;
+                if constexpr (is_signed) {
+                    x = _mm_srai_epi16(_mm_unpacklo_epi8(ra, ra), 8);
+                    y = _mm_srai_epi16(_mm_unpacklo_epi8(rb, rb), 8);
+                } else {
+                    x = _mm_unpacklo_epi8(ra, _mm_setzero_si128());
+                    y = _mm_unpacklo_epi8(rb, _mm_setzero_si128());
+                }
+                if constexpr (op == Int8Op::L2) {
+                    x = _mm_sub_epi16(x, y);
+                    y = x;
+                }
+                acc128 = _mm_add_epi32(acc128, _mm_madd_epi16(x, y));
+            }
+            __attribute__((aligned(16))) int32_t f[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(f), acc128);
+            sum += static_cast<int64_t>(f[0]) + f[1] + f[2] + f[3];
+            for (; i < n; ++i) {
+                int32_t x = pa[i];
+                int32_t y = pb[i];
+                if constexpr (op == Int8Op::L2) {
+                    sum += (x - y) * (x - y);
+                } else {
+                    sum += x * y;
+                }
+            }
+            return sum;
+        }
+
+        // sum of |a - b| with psadbw, int8_t is moved to the unsigned
+        // range by flipping the sign bit, which keeps the differences.
+        template<typename T>
+        inline int64_t int8_l1(const T *pa, const T *pb, std::size_t n) {
+            static_assert(sizeof(T) == 1, "8 bit integer only");
+            constexpr bool is_signed = std::is_signed_v<T>;
+            std::size_t i = 0;
+            int64_t sum = 0;
+#if TURBO_WITH_AVX512BW
+            const __m512i flip512 = _mm512_set1_epi8(is_signed ? static_cast<char>(0x80) : 0);
+            __m512i acc512 = _mm512_setzero_si512();
+            for (; i + 64 <= n; i += 64) {
+                __m512i x = _mm512_xor_si512(_mm512_loadu_si512(pa + i), flip512);
+                __m512i y = _mm512_xor_si512(_mm512_loadu_si512(pb + i), flip512);
+                acc512 = _mm512_add_epi64(acc512, _mm512_sad_epu8(x, y));
+            }
+            sum += _mm512_reduce_add_epi64(acc512);
+#endif
+#if TURBO_WITH_AVX2
+            const __m256i flip256 = _mm256_set1_epi8(is_signed ? static_cast<char>(0x80) : 0);
+            __m256i acc256 = _mm256_setzero_si256();
+            for (; i + 32 <= n; i += 32) {
+                __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pa + i)), flip256);
+                __m256i y = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pb + i)), flip256);
+                acc256 = _mm256_add_epi64(acc256, _mm256_sad_epu8(x, y));
+            }
+            __m128i acc128 = _mm_add_epi64(_mm256_castsi256_si128(acc256), _mm256_extracti128_si256(acc256, 1));
+#else
+            __m128i acc128 = _mm_setzero_si128();
+#endif
+            const __m128i flip128 = _mm_set1_epi8(is_signed ? static_cast<char>(0x80) : 0);
+            for (; i + 16 <= n; i += 16) {
+                __m128i x = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pa + i)), flip128);
+                __m128i y = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pb + i)), flip128);
+                acc128 = _mm_add_epi64(acc128, _mm_sad_epu8(x, y));
+            }
+            __attribute__((aligned(16))) int64_t f[2];
+            _mm_store_si128(reinterpret_cast<__m128i *>(f), acc128);
+            sum += f[0] + f[1];
+            for (; i < n; ++i) {
+                int32_t d = static_cast<int32_t>(pa[i]) - static_cast<int32_t>(pb[i]);
+                sum += d < 0 ? -d : d;
+            }
+            return sum;
+        }
+    }  // namespace kernels
+
     ////////////////////////////////////////////////////////////////////////////////////
     // specializations
     /// l1 comparator
     template<>
     inline double
     PrimComparator::compare_l1<float16>(const turbo::Span<float16> &a, const turbo::Span<float16> &b) {
-        __m256 sum = _mm256_setzero_ps();
-        const float16 *last = a.data() + a.size();
-        const float16 *pa = a.data();
-        const float16 *pb = b.data();
-        const float16 *lastgroup = last - 7;
-        while (pa < lastgroup) {
-            __m256 x1 = _mm256_sub_ps(_mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pa))),
-                                      _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pb))));
-            const __m256 mask = _mm256_set1_ps(-0.0f);
-            __m256 v = _mm256_andnot_ps(mask, x1);
-            sum = _mm256_add_ps(sum, v);
-            pa += 8;
-            pb += 8;
-        }
-        __attribute__((aligned(32))) float f[8];
-        _mm256_store_ps(f, sum);
-        double s = f[0] + f[1] + f[2] + f[3] + f[4] + f[5] + f[6] + f[7];
-        while (pa < last) {
-            double d = fabs(*pa++ - *pb++);
-            s += d;
-        }
-        return s;
+        return kernels::half_reduce<kernels::kHalfL1>(a.data(), b.data(), a.size()).l1;
+    }
+
+    template<>
+    inline double
+    PrimComparator::compare_l1<bfloat16>(const turbo::Span<bfloat16> &a, const turbo::Span<bfloat16> &b) {
+        return kernels::half_reduce<kernels::kHalfL1>(a.data(), b.data(), a.size()).l1;
     }
 
     template<>
     inline double PrimComparator::compare_l1<unsigned char>(const turbo::Span<unsigned char> &a,
                                                             const turbo::Span<unsigned char> &b) {
-        __m128 sum = _mm_setzero_ps();
-        const unsigned char *pa = a.data();
-        const unsigned char *pb = b.data();
-        const unsigned char *last = pa + a.size();
-        const unsigned char *lastgroup = last - 7;
-        const __m128i zero = _mm_setzero_si128();
-        while (pa < lastgroup) {
-            __m128i x1 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const *) pa));
-            __m128i x2 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const *) pb));
-            x1 = _mm_subs_epi16(x1, x2);
-            x1 = _mm_sign_epi16(x1, x1);
-            sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpacklo_epi16(x1, zero)));
-            sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpackhi_epi16(x1, zero)));
-            pa += 8;
-            pb += 8;
-        }
-        __attribute__((aligned(32))) float f[4];
-        _mm_store_ps(f, sum);
-        double s = f[0] + f[1] + f[2] + f[3];
-        while (pa < last) {
-            double d = fabs(static_cast<double>(*pa++) - static_cast<double>(*pb++));
-            s += d;
-        }
-        return s;
+        return static_cast<double>(kernels::int8_l1(a.data(), b.data(), a.size()));
     }
 
-    // l2 comparator
     template<>
-    inline double
-    PrimComparator::compare_l2<float16>(const turbo::Span<float16> &a, const turbo::Span<float16> &b) {
-        const float16 *pa = a.data();
-        const float16 *pb = b.data();
-        const float16 *last = pa + a.size();
-#if TURBO_WITH_AVX512F
-        __m512 sum512 = _mm512_setzero_ps();
-            while (pa < last) {
-          __m512 v = _mm512_sub_ps(_mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pa))),
-                       _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pb))));
-          sum512 = _mm512_add_ps(sum512, _mm512_mul_ps(v, v));
-          pa += 16;
-          pb += 16;
-            }
-
-            __m256 sum256 = _mm256_add_ps(_mm512_extractf32x8_ps(sum512, 0), _mm512_extractf32x8_ps(sum512, 1));
-            __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
-#elif TURBO_WITH_AVX2
-        __m256 sum256 = _mm256_setzero_ps();
-        __m256 v;
-        while (pa < last) {
-            v = _mm256_sub_ps(_mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pa))),
-                              _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pb))));
-            sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(v, v));
-            pa += 8;
-            pb += 8;
-            v = _mm256_sub_ps(_mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pa))),
-                              _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pb))));
-            sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(v, v));
-            pa += 8;
-            pb += 8;
-        }
-        __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
-#else
-        __m128 sum128 = _mm_setzero_ps();
-            __m128 v;
-            while (pa < last) {
-          __m128i va = _mm_load_si128(reinterpret_cast<const __m128i*>(pa));
-          __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i*>(pb));
-          v = _mm_sub_ps(_mm_cvtph_ps(va), _mm_cvtph_ps(vb));
-          sum128 = _mm_add_ps(sum128, _mm_mul_ps(v, v));
-          va = _mm_srli_si128(va, 8);
-          vb = _mm_srli_si128(vb, 8);
-          v = _mm_sub_ps(_mm_cvtph_ps(va), _mm_cvtph_ps(vb));
-          sum128 = _mm_add_ps(sum128, _mm_mul_ps(v, v));
-              pa += 8;
-              pb += 8;
-            }
-#endif
+    inline double PrimComparator::compare_l1<int8_t>(const turbo::Span<int8_t> &a,
+                                                     const turbo::Span<int8_t> &b) {
+        return static_cast<double>(kernels::int8_l1(a.data(), b.data(), a.size()));
+    }
 
-        __attribute__((aligned(32))) float f[4];
-        _mm_store_ps(f, sum128);
-        double s = f[0] + f[1] + f[2] + f[3];
-        return sqrt(s);
+    // l2 comparator
+    template<>
+    inline float
+    PrimComparator::compare_l2_sqr<float16>(const turbo::Span<float16> &a, const turbo::Span<float16> &b) {
+        return kernels::half_reduce<kernels::kHalfL2>(a.data(), b.data(), a.size()).l2;
     }
 
     template<>
-    inline double PrimComparator::compare_l2<unsigned char>(const turbo::Span<unsigned char> &a,
-                                                            const turbo::Span<unsigned char> &b) {
-        __m128 sum = _mm_setzero_ps();
-        const unsigned char *pa = a.data();
-        const unsigned char *pb = b.data();
-        const unsigned char *last = pa + a.size();
-        const unsigned char *lastgroup = last - 7;
-        const __m128i zero = _mm_setzero_si128();
-        while (pa < lastgroup) {
-            __m128i x1 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const *) pa));
-            __m128i x2 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const *) pb));
-            x1 = _mm_subs_epi16(x1, x2);
-            __m128i v = _mm_mullo_epi16(x1, x1);
-            sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)));
-            sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)));
-            pa += 8;
-            pb += 8;
-        }
-        __attribute__((aligned(32))) float f[4];
-        _mm_store_ps(f, sum);
-        double s = f[0] + f[1] + f[2] + f[3];
-        while (pa < last) {
-            int d = (int) *pa++ - (int) *pb++;
-            s += d * d;
-        }
-        return sqrt(s);
+    inline float
+    PrimComparator::compare_l2_sqr<bfloat16>(const turbo::Span<bfloat16> &a, const turbo::Span<bfloat16> &b) {
+        return kernels::half_reduce<kernels::kHalfL2>(a.data(), b.data(), a.size()).l2;
     }
 
-    ////////////////////////
-    /// popcount
-    // avx2
     template<>
-    inline double PrimComparator::popcount<4>(const turbo::simd::batch<uint64_t, turbo::simd::default_arch> &a) {
-        return turbo::popcount(a.get(0)) + turbo::popcount(a.get(1)) + turbo::popcount(a.get(2)) +
-               turbo::popcount(a.get(3));
+    inline float PrimComparator::compare_l2_sqr<unsigned char>(const turbo::Span<unsigned char> &a,
+                                                               const turbo::Span<unsigned char> &b) {
+        return static_cast<float>(kernels::int8_reduce<kernels::Int8Op::L2>(a.data(), b.data(), a.size()));
     }
 
-    //////
-    // avx512
     template<>
-    inline double PrimComparator::popcount<8>(const turbo::simd::batch<uint64_t, turbo::simd::default_arch> &a) {
-        return turbo::popcount(a.get(0)) + turbo::popcount(a.get(1)) + turbo::popcount(a.get(2)) +
-               turbo::popcount(a.get(3)) + turbo::popcount(a.get(4)) + turbo::popcount(a.get(5)) +
-               turbo::popcount(a.get(7)) + turbo::popcount(a.get(7));
+    inline float PrimComparator::compare_l2_sqr<int8_t>(const turbo::Span<int8_t> &a,
+                                                        const turbo::Span<int8_t> &b) {
+        return static_cast<float>(kernels::int8_reduce<kernels::Int8Op::L2>(a.data(), b.data(), a.size()));
     }
 
     ////////////////////////
-    /// comparator cosine for float16
+    /// comparator cosine for float16 and bfloat16
 
     template<>
     inline double PrimComparator::compare_cosine<float16>(const turbo::Span<float16> &a,
                                                           const turbo::Span<float16> &b) {
+        auto r = kernels::half_reduce<kernels::kHalfDot | kernels::kHalfNormA | kernels::kHalfNormB>(
+                a.data(), b.data(), a.size());
+        return r.dot / sqrt(static_cast<double>(r.norm_a) * r.norm_b);
+    }
 
-        const float16 *last = a.data() + a.size();
-        const float16 *pa = a.data();
-        const float16 *pb = b.data();
-#if TURBO_WITH_AVX512F
-        __m512 normA = _mm512_setzero_ps();
-            __m512 normB = _mm512_setzero_ps();
-            __m512 sum = _mm512_setzero_ps();
-            while (pa < last) {
-          __m512 am = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pa)));
-          __m512 bm = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pb)));
-          normA = _mm512_add_ps(normA, _mm512_mul_ps(am, am));
-          normB = _mm512_add_ps(normB, _mm512_mul_ps(bm, bm));
-          sum = _mm512_add_ps(sum, _mm512_mul_ps(am, bm));
-          pa += 16;
-          pb += 16;
-            }
-            __m256 am256 = _mm256_add_ps(_mm512_extractf32x8_ps(normA, 0), _mm512_extractf32x8_ps(normA, 1));
-            __m256 bm256 = _mm256_add_ps(_mm512_extractf32x8_ps(normB, 0), _mm512_extractf32x8_ps(normB, 1));
-            __m256 s256 = _mm256_add_ps(_mm512_extractf32x8_ps(sum, 0), _mm512_extractf32x8_ps(sum, 1));
-            __m128 am128 = _mm_add_ps(_mm256_extractf128_ps(am256, 0), _mm256_extractf128_ps(am256, 1));
-            __m128 bm128 = _mm_add_ps(_mm256_extractf128_ps(bm256, 0), _mm256_extractf128_ps(bm256, 1));
-            __m128 s128 = _mm_add_ps(_mm256_extractf128_ps(s256, 0), _mm256_extractf128_ps(s256, 1));
-#elif TURBO_WITH_AVX2
-        __m256 normA = _mm256_setzero_ps();
-        __m256 normB = _mm256_setzero_ps();
-        __m256 sum = _mm256_setzero_ps();
-        __m256 am, bm;
-        while (pa < last) {
-            am = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pa)));
-            bm = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pb)));
-            normA = _mm256_add_ps(normA, _mm256_mul_ps(am, am));
-            normB = _mm256_add_ps(normB, _mm256_mul_ps(bm, bm));
-            sum = _mm256_add_ps(sum, _mm256_mul_ps(am, bm));
-            pa += 8;
-            pb += 8;
-        }
-        __m128 am128 = _mm_add_ps(_mm256_extractf128_ps(normA, 0), _mm256_extractf128_ps(normA, 1));
-        __m128 bm128 = _mm_add_ps(_mm256_extractf128_ps(normB, 0), _mm256_extractf128_ps(normB, 1));
-        __m128 s128 = _mm_add_ps(_mm256_extractf128_ps(sum, 0), _mm256_extractf128_ps(sum, 1));
-#else
-        __m128 am128 = _mm_setzero_ps();
-        __m128 bm128 = _mm_setzero_ps();
-        __m128 s128 = _mm_setzero_ps();
-        __m128 am, bm;
-        while (pa < last) {
-            __m128i va = _mm_load_si128(reinterpret_cast<const __m128i *>(pa));
-            __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i *>(pb));
-            am = _mm_cvtph_ps(va);
-            bm = _mm_cvtph_ps(vb);
-            am128 = _mm_add_ps(am128, _mm_mul_ps(am, am));
-            bm128 = _mm_add_ps(bm128, _mm_mul_ps(bm, bm));
-            s128 = _mm_add_ps(s128, _mm_mul_ps(am, bm));
-            va = _mm_srli_si128(va, 8);
-            vb = _mm_srli_si128(vb, 8);
-            am = _mm_cvtph_ps(va);
-            bm = _mm_cvtph_ps(vb);
-            am128 = _mm_add_ps(am128, _mm_mul_ps(am, am));
-            bm128 = _mm_add_ps(bm128, _mm_mul_ps(bm, bm));
-            s128 = _mm_add_ps(s128, _mm_mul_ps(am, bm));
-            pa += 8;
-            pb += 8;
-        }
-
-#endif
-
-        __attribute__((aligned(32))) float f[4];
-        _mm_store_ps(f, am128);
-        double na = f[0] + f[1] + f[2] + f[3];
-        _mm_store_ps(f, bm128);
-        double nb = f[0] + f[1] + f[2] + f[3];
-        _mm_store_ps(f, s128);
-        double s = f[0] + f[1] + f[2] + f[3];
-
-        double cosine = s / sqrt(na * nb);
-        return cosine;
+    template<>
+    inline double PrimComparator::compare_cosine<bfloat16>(const turbo::Span<bfloat16> &a,
+                                                           const turbo::Span<bfloat16> &b) {
+        auto r = kernels::half_reduce<kernels::kHalfDot | kernels::kHalfNormA | kernels::kHalfNormB>(
+                a.data(), b.data(), a.size());
+        return r.dot / sqrt(static_cast<double>(r.norm_a) * r.norm_b);
     }
 
     template<>
@@ -732,6 +816,12 @@ namespace tann {
         return simple_compare_cosine(a, b);
     }
 
+    template<>
+    inline double PrimComparator::compare_cosine<int8_t>(const turbo::Span<int8_t> &a,
+                                                         const turbo::Span<int8_t> &b) {
+        return simple_compare_cosine(a, b);
+    }
+
     template<>
     inline double PrimComparator::compare_cosine<int16_t>(const turbo::Span<int16_t> &a,
                                                           const turbo::Span<int16_t> &b) {
@@ -749,54 +839,25 @@ namespace tann {
     template<>
     inline double PrimComparator::compare_inner_product<float16>(const turbo::Span<float16> &a,
                                                                  const turbo::Span<float16> &b) {
-        const float16 *pa = a.data();
-        const float16 *pb = b.data();
-        const float16 *last = pa + a.size();
-#if TURBO_WITH_AVX512F
-        __m512 sum512 = _mm512_setzero_ps();
-            while (pa < last) {
-          sum512 = _mm512_add_ps(sum512, _mm512_mul_ps(_mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pa))),
-                                   _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pb)))));
-
-          pa += 16;
-          pb += 16;
-            }
-            __m256 sum256 = _mm256_add_ps(_mm512_extractf32x8_ps(sum512, 0), _mm512_extractf32x8_ps(sum512, 1));
-            __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
-#elif TURBO_WITH_AVX2
-        __m256 sum256 = _mm256_setzero_ps();
-        while (pa < last) {
-            sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(
-                    _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pa))),
-                    _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pb)))));
-            pa += 8;
-            pb += 8;
-        }
-        __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
-#else
-        __m128 sum128 = _mm_setzero_ps();
-        while (pa < last) {
-            __m128i va = _mm_load_si128(reinterpret_cast<const __m128i*>(pa));
-            __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i*>(pb));
-            sum128 = _mm_add_ps(sum128, _mm_mul_ps(_mm_cvtph_ps(va), _mm_cvtph_ps(vb)));
-            va = _mm_srli_si128(va, 8);
-            vb = _mm_srli_si128(vb, 8);
-            sum128 = _mm_add_ps(sum128, _mm_mul_ps(_mm_cvtph_ps(va), _mm_cvtph_ps(vb)));
-            pa += 8;
-            pb += 8;
-        }
-#endif
-        __attribute__((aligned(32))) float f[4];
-        _mm_store_ps(f, sum128);
-        double s = static_cast<double>(f[0]) + static_cast<double>(f[1]) + static_cast<double>(f[2]) +
-                   static_cast<double>(f[3]);
-        return s;
+        return kernels::half_reduce<kernels::kHalfDot>(a.data(), b.data(), a.size()).dot;
+    }
+
+    template<>
+    inline double PrimComparator::compare_inner_product<bfloat16>(const turbo::Span<bfloat16> &a,
+                                                                  const turbo::Span<bfloat16> &b) {
+        return kernels::half_reduce<kernels::kHalfDot>(a.data(), b.data(), a.size()).dot;
     }
 
     template<>
     inline double PrimComparator::compare_inner_product<uint8_t>(const turbo::Span<uint8_t> &a,
                                                                  const turbo::Span<uint8_t> &b) {
-        return simple_compare_inner_product(a, b);
+        return static_cast<double>(kernels::int8_reduce<kernels::Int8Op::IP>(a.data(), b.data(), a.size()));
+    }
+
+    template<>
+    inline double PrimComparator::compare_inner_product<int8_t>(const turbo::Span<int8_t> &a,
+                                                                const turbo::Span<int8_t> &b) {
+        return static_cast<double>(kernels::int8_reduce<kernels::Int8Op::IP>(a.data(), b.data(), a.size()));
     }
 
     template<>
@@ -812,85 +873,21 @@ namespace tann {
     }
 
     template<>
-    inline double PrimComparator::compare_poincare<float16>(const turbo::Span<float16> &a,
-                                                            const turbo::Span<float16> &b) {
-        const float16 *last = a.data() + a.size();
-        const float16 *pa = a.data();
-        const float16 *pb = b.data();
-#if TURBO_WITH_AVX512F
-        __m512 normA = _mm512_setzero_ps();
-        __m512 normB = _mm512_setzero_ps();
-        __m512 sum = _mm512_setzero_ps();
-        while (pa < last) {
-            __m512 am = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pa)));
-            __m512 bm = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pb)));
-            normA = _mm512_add_ps(normA, _mm512_mul_ps(am, am));
-            normB = _mm512_add_ps(normB, _mm512_mul_ps(bm, bm));
-            __m512 v = _mm512_sub_ps(am, bm);
-            sum = _mm512_add_ps(sum, _mm512_mul_ps(v, v));
-            pa += 16;
-            pb += 16;
-        }
-        __m256 am256 = _mm256_add_ps(_mm512_extractf32x8_ps(normA, 0), _mm512_extractf32x8_ps(normA, 1));
-        __m256 bm256 = _mm256_add_ps(_mm512_extractf32x8_ps(normB, 0), _mm512_extractf32x8_ps(normB, 1));
-        __m256 s256 = _mm256_add_ps(_mm512_extractf32x8_ps(sum, 0), _mm512_extractf32x8_ps(sum, 1));
-        __m128 am128 = _mm_add_ps(_mm256_extractf128_ps(am256, 0), _mm256_extractf128_ps(am256, 1));
-        __m128 bm128 = _mm_add_ps(_mm256_extractf128_ps(bm256, 0), _mm256_extractf128_ps(bm256, 1));
-        __m128 s128 = _mm_add_ps(_mm256_extractf128_ps(s256, 0), _mm256_extractf128_ps(s256, 1));
-#elif TURBO_WITH_AVX2
-        __m256 normA = _mm256_setzero_ps();
-        __m256 normB = _mm256_setzero_ps();
-        __m256 sum = _mm256_setzero_ps();
-        __m256 am, bm;
-        while (pa < last) {
-            am = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pa)));
-            bm = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pb)));
-            normA = _mm256_add_ps(normA, _mm256_mul_ps(am, am));
-            normB = _mm256_add_ps(normB, _mm256_mul_ps(bm, bm));
-            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_sub_ps(am, bm), _mm256_sub_ps(am, bm)));
-            pa += 8;
-            pb += 8;
-        }
-        __m128 am128 = _mm_add_ps(_mm256_extractf128_ps(normA, 0), _mm256_extractf128_ps(normA, 1));
-        __m128 bm128 = _mm_add_ps(_mm256_extractf128_ps(normB, 0), _mm256_extractf128_ps(normB, 1));
-        __m128 s128 = _mm_add_ps(_mm256_extractf128_ps(sum, 0), _mm256_extractf128_ps(sum, 1));
-#else
-        __m128 am128 = _mm_setzero_ps();
-        __m128 bm128 = _mm_setzero_ps();
-        __m128 s128 = _mm_setzero_ps();
-        __m128 am, bm;
-        while (pa < last) {
-            __m128i va = _mm_load_si128(reinterpret_cast<const __m128i *>(pa));
-            __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i *>(pb));
-            am = _mm_cvtph_ps(va);
-            bm = _mm_cvtph_ps(vb);
-            am128 = _mm_add_ps(am128, _mm_mul_ps(am, am));
-            bm128 = _mm_add_ps(bm128, _mm_mul_ps(bm, bm));
-            __m128 diff = _mm_sub_ps(am, bm);
-            s128 = _mm_add_ps(s128, _mm_mul_ps(diff, diff));
-            va = _mm_srli_si128(va, 8);
-            vb = _mm_srli_si128(vb, 8);
-            am = _mm_cvtph_ps(va);
-            bm = _mm_cvtph_ps(vb);
-            am128 = _mm_add_ps(am128, _mm_mul_ps(am, am));
-            bm128 = _mm_add_ps(bm128, _mm_mul_ps(bm, bm));
-            s128 = _mm_add_ps(s128, _mm_mul_ps(am, bm));
-            pa += 8;
-            pb += 8;
-        }
-
-#endif
-
-        __attribute__((aligned(32))) float f[4];
-        _mm_store_ps(f, am128);
-        double na = f[0] + f[1] + f[2] + f[3];
-        _mm_store_ps(f, bm128);
-        double nb = f[0] + f[1] + f[2] + f[3];
-        _mm_store_ps(f, s128);
-        double s = f[0] + f[1] + f[2] + f[3];
+    inline double PrimComparator::compare_poincare_rank<float16>(const turbo::Span<float16> &a,
+                                                                 const turbo::Span<float16> &b) {
+        auto r = kernels::half_reduce<kernels::kHalfL2 | kernels::kHalfNormA | kernels::kHalfNormB>(
+                a.data(), b.data(), a.size());
+        return 2.0 * r.l2 / (1.0 - r.norm_a) / (1.0 - r.norm_b);
+    }
 
-        return std::acosh(1 + 2.0 * s / (1.0 - na) / (1.0 - nb));
+    template<>
+    inline double PrimComparator::compare_poincare_rank<bfloat16>(const turbo::Span<bfloat16> &a,
+                                                                  const turbo::Span<bfloat16> &b) {
+        auto r = kernels::half_reduce<kernels::kHalfL2 | kernels::kHalfNormA | kernels::kHalfNormB>(
+                a.data(), b.data(), a.size());
+        return 2.0 * r.l2 / (1.0 - r.norm_a) / (1.0 - r.norm_b);
     }
+}  // namespace TANN_SIMD_NAMESPACE
 }  // namespace tann
 
 #endif  // TANN_DISTANCE_PRIMITIVE_COMPARATOR_H_
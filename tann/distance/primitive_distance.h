@@ -14,95 +14,86 @@
 #ifndef TANN_DISTANCE_PRIMITIVE_DISTANCE_H_
 #define TANN_DISTANCE_PRIMITIVE_DISTANCE_H_
 
+#include "tann/distance/simd_namespace.h"
+#include "tann/distance/distance_base.h"
 #include "tann/distance/utility.h"
 #include "turbo/simd/arch/generic.h"
 #include "turbo/meta/span.h"
-#include "turbo/log/logging.h"
 #include "tann/distance/primitive_comparator.h"
 #include "tann/core/allocator.h"
 #include "tann/core/types.h"
 
 namespace tann {
-    class DistanceBase {
+inline namespace TANN_SIMD_NAMESPACE {
+    class PrimDistanceL1Uint8 : public DistanceBase {
     public:
-        TURBO_DLL explicit DistanceBase(tann::MetricType dist_metric) : _distance_metric(dist_metric) {
-        }
-
+        PrimDistanceL1Uint8() : DistanceBase(tann::MetricType::METRIC_L1) {}
         // distance comparison function
-        TURBO_DLL [[nodiscard]] virtual double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const = 0;
-
-        // For MIPS, normalization adds an extra dimension to the vectors.
-        // This function lets callers know if the normalization process
-        // changes the dimension.
-        TURBO_DLL [[nodiscard]] virtual uint32_t post_normalization_dimension(uint32_t orig_dimension) const {
-            return orig_dimension;
-        }
-
-        TURBO_DLL [[nodiscard]] virtual tann::MetricType get_metric() const {
-            return _distance_metric;
+        TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_l1(a, b);
         }
 
-        // This is for efficiency. If no normalization is required, the callers
-        // can simply ignore the normalize_data_for_build() function.
-        TURBO_DLL [[nodiscard]] virtual bool preprocessing_required() const {
-            return false;
+        TURBO_DLL [[nodiscard]] double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const override {
+            return PrimComparator::compare_l1_bounded(a, b, upper_bound);
         }
+        // Providing a default implementation for the virtual destructor because we
+        // don't expect most metric implementations to need it.
+        TURBO_DLL ~PrimDistanceL1Uint8() override = default;
 
-        // Check the preprocessing_required() function before calling this.
-        // Clients can call the function like this:
-        //
-        //  if (metric->preprocessing_required()){
-        //     T* normalized_data_batch;
-        //      Split data into batches of batch_size and for each, call:
-        //       metric->preprocess_base_points(data_batch, batch_size);
-        //
-        //  TODO: This does not take into account the case for SSD inner product
-        //  where the dimensions change after normalization.
-        TURBO_DLL virtual void preprocess_base_points(turbo::Span<uint8_t> original_data, size_t dim) {
+    };
 
+    class PrimDistanceL1Int8 : public DistanceBase {
+    public:
+        PrimDistanceL1Int8() : DistanceBase(tann::MetricType::METRIC_L1) {}
+        // distance comparison function
+        TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_l1(to_span<int8_t>(a), to_span<int8_t>(b));
         }
 
-        // Invokes normalization for a single vector during search. The scratch space
-        // has to be created by the caller keeping track of the fact that
-        // normalization might change the dimension of the query vector.
-        TURBO_DLL virtual void
-        preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query) {
-            TLOG_CHECK_LE(query_vec.size(), scratch_query.size(),
-                          "input query vector size must little equal than des vector size.");
-            std::memcpy(scratch_query.data(), query_vec.data(), query_vec.size() * sizeof(uint8_t));
+        TURBO_DLL [[nodiscard]] double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const override {
+            return PrimComparator::compare_l1_bounded(to_span<int8_t>(a), to_span<int8_t>(b), upper_bound);
         }
-
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
-        TURBO_DLL virtual ~DistanceBase() = default;
+        TURBO_DLL ~PrimDistanceL1Int8() override = default;
 
-    protected:
-        tann::MetricType _distance_metric;
     };
 
-    class PrimDistanceL1Uint8 : public DistanceBase {
+    class PrimDistanceL1Float16 : public DistanceBase {
     public:
-        PrimDistanceL1Uint8() : DistanceBase(tann::MetricType::METRIC_L1) {}
+        PrimDistanceL1Float16() : DistanceBase(tann::MetricType::METRIC_L1) {}
         // distance comparison function
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_l1(a, b);
+            return PrimComparator::compare_l1(to_span<tann::float16>(a), to_span<float16>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const override {
+            return PrimComparator::compare_l1_bounded(to_span<tann::float16>(a), to_span<float16>(b), upper_bound);
         }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceL1Uint8() override = default;
+        TURBO_DLL ~PrimDistanceL1Float16() override = default;
 
     };
 
-    class PrimDistanceL1Float16 : public DistanceBase {
+    class PrimDistanceL1BFloat16 : public DistanceBase {
     public:
-        PrimDistanceL1Float16() : DistanceBase(tann::MetricType::METRIC_L1) {}
+        PrimDistanceL1BFloat16() : DistanceBase(tann::MetricType::METRIC_L1) {}
         // distance comparison function
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_l1(to_span<tann::float16>(a), to_span<float16>(b));
+            return PrimComparator::compare_l1(to_span<bfloat16>(a), to_span<bfloat16>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const override {
+            return PrimComparator::compare_l1_bounded(to_span<bfloat16>(a), to_span<bfloat16>(b), upper_bound);
         }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceL1Float16() override = default;
+        TURBO_DLL ~PrimDistanceL1BFloat16() override = default;
 
     };
 
@@ -113,6 +104,11 @@ namespace tann {
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
             return PrimComparator::compare_l1(to_span<float>(a), to_span<float>(b));
         }
+
+        TURBO_DLL [[nodiscard]] double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const override {
+            return PrimComparator::compare_l1_bounded(to_span<float>(a), to_span<float>(b), upper_bound);
+        }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
         TURBO_DLL ~PrimDistanceL1Float() override = default;
@@ -139,11 +135,49 @@ namespace tann {
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
             return PrimComparator::compare_l2(a, b);
         }
+
+        TURBO_DLL [[nodiscard]] double compare_rank(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_l2_sqr(a, b);
+        }
+
+        TURBO_DLL [[nodiscard]] double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const override {
+            return PrimComparator::compare_l2_sqr_bounded(a, b, upper_bound);
+        }
+
+        TURBO_DLL [[nodiscard]] double rank_to_distance(double d) const override {
+            return sqrt(d);
+        }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
         TURBO_DLL ~PrimDistanceL2Uint8() override = default;
     };
 
+    class PrimDistanceL2Int8 : public DistanceBase {
+    public:
+        PrimDistanceL2Int8() : DistanceBase(tann::MetricType::METRIC_L2) {}
+        // distance comparison function
+        TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_l2(to_span<int8_t>(a), to_span<int8_t>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double compare_rank(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_l2_sqr(to_span<int8_t>(a), to_span<int8_t>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const override {
+            return PrimComparator::compare_l2_sqr_bounded(to_span<int8_t>(a), to_span<int8_t>(b), upper_bound);
+        }
+
+        TURBO_DLL [[nodiscard]] double rank_to_distance(double d) const override {
+            return sqrt(d);
+        }
+        // Providing a default implementation for the virtual destructor because we
+        // don't expect most metric implementations to need it.
+        TURBO_DLL ~PrimDistanceL2Int8() override = default;
+    };
+
     class PrimDistanceL2Float16 : public DistanceBase {
     public:
         PrimDistanceL2Float16() : DistanceBase(tann::MetricType::METRIC_L2) {}
@@ -151,11 +185,49 @@ namespace tann {
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
             return PrimComparator::compare_l2(to_span<float16>(a), to_span<float16>(b));
         }
+
+        TURBO_DLL [[nodiscard]] double compare_rank(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_l2_sqr(to_span<float16>(a), to_span<float16>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const override {
+            return PrimComparator::compare_l2_sqr_bounded(to_span<float16>(a), to_span<float16>(b), upper_bound);
+        }
+
+        TURBO_DLL [[nodiscard]] double rank_to_distance(double d) const override {
+            return sqrt(d);
+        }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
         TURBO_DLL ~PrimDistanceL2Float16() override = default;
     };
 
+    class PrimDistanceL2BFloat16 : public DistanceBase {
+    public:
+        PrimDistanceL2BFloat16() : DistanceBase(tann::MetricType::METRIC_L2) {}
+        // distance comparison function
+        TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_l2(to_span<bfloat16>(a), to_span<bfloat16>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double compare_rank(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_l2_sqr(to_span<bfloat16>(a), to_span<bfloat16>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const override {
+            return PrimComparator::compare_l2_sqr_bounded(to_span<bfloat16>(a), to_span<bfloat16>(b), upper_bound);
+        }
+
+        TURBO_DLL [[nodiscard]] double rank_to_distance(double d) const override {
+            return sqrt(d);
+        }
+        // Providing a default implementation for the virtual destructor because we
+        // don't expect most metric implementations to need it.
+        TURBO_DLL ~PrimDistanceL2BFloat16() override = default;
+    };
+
     class PrimDistanceL2Float : public DistanceBase {
     public:
         PrimDistanceL2Float() : DistanceBase(tann::MetricType::METRIC_L2) {}
@@ -163,11 +235,54 @@ namespace tann {
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
             return PrimComparator::compare_l2(to_span<float>(a), to_span<float>(b));
         }
+
+        TURBO_DLL [[nodiscard]] double compare_rank(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_l2_sqr(to_span<float>(a), to_span<float>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const override {
+            return PrimComparator::compare_l2_sqr_bounded(to_span<float>(a), to_span<float>(b), upper_bound);
+        }
+
+        TURBO_DLL [[nodiscard]] double rank_to_distance(double d) const override {
+            return sqrt(d);
+        }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
         TURBO_DLL ~PrimDistanceL2Float() override = default;
     };
 
+    // l2 of float vectors with Dim elements, chosen by the factory
+    // for the common embedding sizes.
+    template<std::size_t Dim>
+    class PrimDistanceL2FloatDim : public DistanceBase {
+    public:
+        PrimDistanceL2FloatDim() : DistanceBase(tann::MetricType::METRIC_L2) {}
+        // distance comparison function
+        TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return sqrt(static_cast<double>(compare_rank(a, b)));
+        }
+
+        TURBO_DLL [[nodiscard]] double compare_rank(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_l2_sqr_fixed<Dim>(reinterpret_cast<const float *>(a.data()),
+                                                             reinterpret_cast<const float *>(b.data()));
+        }
+
+        TURBO_DLL [[nodiscard]] double
+        compare_bounded(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double upper_bound) const override {
+            return PrimComparator::compare_l2_sqr_fixed_bounded<Dim>(reinterpret_cast<const float *>(a.data()),
+                                                                     reinterpret_cast<const float *>(b.data()),
+                                                                     upper_bound);
+        }
+
+        TURBO_DLL [[nodiscard]] double rank_to_distance(double d) const override {
+            return sqrt(d);
+        }
+
+        TURBO_DLL ~PrimDistanceL2FloatDim() override = default;
+    };
+
     class PrimDistanceHammingUint8 : public DistanceBase {
     public:
         PrimDistanceHammingUint8() : DistanceBase(tann::MetricType::METRIC_HAMMING) {}
@@ -175,6 +290,11 @@ namespace tann {
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
             return PrimComparator::compare_hamming(a, b);
         }
+
+        TURBO_DLL void compare_rank_batch(turbo::Span<uint8_t> a, const uint8_t *bs, std::size_t stride,
+                                          turbo::Span<double> out) const override {
+            PrimComparator::compare_hamming_batch(a, bs, stride, out);
+        }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
         TURBO_DLL ~PrimDistanceHammingUint8() override = default;
@@ -194,104 +314,123 @@ namespace tann {
 
     };
 
-    class PrimDistanceCosineUint8 : public DistanceBase {
+    // PrimNormDistance holds the norm hooks of the metrics that keep a
+    // norm per vector, Derived ranks the vectors of element type T with
+    //   static double norm_of(turbo::Span<T> a);
+    //   static double rank_of(turbo::Span<T> a, turbo::Span<T> b, double norm_a, double norm_b);
+    template<typename Derived, typename T>
+    class PrimNormDistance : public DistanceBase {
     public:
-        PrimDistanceCosineUint8() : DistanceBase(tann::MetricType::METRIC_COSINE) {}
-        // distance comparison function
-        TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_cosine(a, b);
-        }
-        // Providing a default implementation for the virtual destructor because we
-        // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceCosineUint8() override = default;
+        explicit PrimNormDistance(tann::MetricType dist_metric) : DistanceBase(dist_metric) {}
 
-    };
+        TURBO_DLL [[nodiscard]] bool use_norm() const override {
+            return true;
+        }
 
-    class PrimDistanceCosineFloat16 : public DistanceBase {
-    public:
-        PrimDistanceCosineFloat16() : DistanceBase(tann::MetricType::METRIC_COSINE) {}
-        // distance comparison function
-        TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_cosine(to_span<float16>(a), to_span<float16>(b));
+        TURBO_DLL [[nodiscard]] double norm(turbo::Span<uint8_t> a) const override {
+            return Derived::norm_of(to_span<T>(a));
         }
-        // Providing a default implementation for the virtual destructor because we
-        // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceCosineFloat16() override = default;
 
+        TURBO_DLL [[nodiscard]] double
+        compare_rank_with_norm(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b, double norm_a, double norm_b) const override {
+            return Derived::rank_of(to_span<T>(a), to_span<T>(b), norm_a, norm_b);
+        }
     };
 
-    class PrimDistanceCosineFloat : public DistanceBase {
+    // cosine or angle of vectors of element type T, with the l2 norms
+    // known the rank is one inner product.
+    template<typename T, tann::MetricType Metric>
+    class PrimDistanceCosineAngle : public PrimNormDistance<PrimDistanceCosineAngle<T, Metric>, T> {
     public:
-        PrimDistanceCosineFloat() : DistanceBase(tann::MetricType::METRIC_COSINE) {}
+        static_assert(Metric == tann::MetricType::METRIC_COSINE || Metric == tann::MetricType::METRIC_ANGLE,
+                      "cosine or angle metric");
+
+        PrimDistanceCosineAngle() : PrimNormDistance<PrimDistanceCosineAngle<T, Metric>, T>(Metric) {}
+
         // distance comparison function
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_cosine(to_span<float>(a), to_span<float>(b));
+            if constexpr (Metric == tann::MetricType::METRIC_ANGLE) {
+                return PrimComparator::compare_angle(to_span<T>(a), to_span<T>(b));
+            } else {
+                return PrimComparator::compare_cosine(to_span<T>(a), to_span<T>(b));
+            }
         }
-        // Providing a default implementation for the virtual destructor because we
-        // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceCosineFloat() override = default;
 
-    };
+        static double norm_of(turbo::Span<T> a) {
+            return get_l2_norm(a);
+        }
 
-    class PrimDistanceAngleUint8 : public DistanceBase {
-    public:
-        PrimDistanceAngleUint8() : DistanceBase(tann::MetricType::METRIC_ANGLE) {}
-        // distance comparison function
-        TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_angle(a, b);
+        static double rank_of(turbo::Span<T> a, turbo::Span<T> b, double norm_a, double norm_b) {
+            double cosine = PrimComparator::compare_inner_product(a, b) / (norm_a * norm_b);
+            if constexpr (Metric == tann::MetricType::METRIC_ANGLE) {
+                return PrimComparator::cosine_to_angle(cosine);
+            } else {
+                return cosine;
+            }
         }
-        // Providing a default implementation for the virtual destructor because we
-        // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceAngleUint8() override = default;
     };
 
-    class PrimDistanceAngleFloat16 : public DistanceBase {
+    using PrimDistanceCosineUint8 = PrimDistanceCosineAngle<uint8_t, tann::MetricType::METRIC_COSINE>;
+    using PrimDistanceCosineInt8 = PrimDistanceCosineAngle<int8_t, tann::MetricType::METRIC_COSINE>;
+    using PrimDistanceCosineFloat16 = PrimDistanceCosineAngle<float16, tann::MetricType::METRIC_COSINE>;
+    using PrimDistanceCosineBFloat16 = PrimDistanceCosineAngle<bfloat16, tann::MetricType::METRIC_COSINE>;
+    using PrimDistanceCosineFloat = PrimDistanceCosineAngle<float, tann::MetricType::METRIC_COSINE>;
+
+    using PrimDistanceAngleUint8 = PrimDistanceCosineAngle<uint8_t, tann::MetricType::METRIC_ANGLE>;
+    using PrimDistanceAngleInt8 = PrimDistanceCosineAngle<int8_t, tann::MetricType::METRIC_ANGLE>;
+    using PrimDistanceAngleFloat16 = PrimDistanceCosineAngle<float16, tann::MetricType::METRIC_ANGLE>;
+    using PrimDistanceAngleBFloat16 = PrimDistanceCosineAngle<bfloat16, tann::MetricType::METRIC_ANGLE>;
+    using PrimDistanceAngleFloat = PrimDistanceCosineAngle<float, tann::MetricType::METRIC_ANGLE>;
+
+    class PrimDistanceIPUint8 : public DistanceBase {
     public:
-        PrimDistanceAngleFloat16() : DistanceBase(tann::MetricType::METRIC_ANGLE) {}
+        PrimDistanceIPUint8() : DistanceBase(tann::MetricType::METRIC_IP) {}
         // distance comparison function
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_angle(to_span<float16>(a), to_span<float16>(b));
+            return PrimComparator::compare_inner_product(a, b);
         }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceAngleFloat16() override = default;
+        TURBO_DLL ~PrimDistanceIPUint8() override = default;
+
     };
 
-    class PrimDistanceAngleFloat : public DistanceBase {
+    class PrimDistanceIPInt8 : public DistanceBase {
     public:
-        PrimDistanceAngleFloat() : DistanceBase(tann::MetricType::METRIC_ANGLE) {}
+        PrimDistanceIPInt8() : DistanceBase(tann::MetricType::METRIC_IP) {}
         // distance comparison function
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_angle(to_span<float>(a), to_span<float>(b));
+            return PrimComparator::compare_inner_product(to_span<int8_t>(a), to_span<int8_t>(b));
         }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceAngleFloat() override = default;
+        TURBO_DLL ~PrimDistanceIPInt8() override = default;
+
     };
 
-    class PrimDistanceIPUint8 : public DistanceBase {
+    class PrimDistanceIPFloat16 : public DistanceBase {
     public:
-        PrimDistanceIPUint8() : DistanceBase(tann::MetricType::METRIC_IP) {}
+        PrimDistanceIPFloat16() : DistanceBase(tann::MetricType::METRIC_IP) {}
         // distance comparison function
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_inner_product(a, b);
+            return PrimComparator::compare_inner_product(to_span<float16>(a), to_span<float16>(b));
         }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceIPUint8() override = default;
+        TURBO_DLL ~PrimDistanceIPFloat16() override = default;
 
     };
 
-    class PrimDistanceIPFloat16 : public DistanceBase {
+    class PrimDistanceIPBFloat16 : public DistanceBase {
     public:
-        PrimDistanceIPFloat16() : DistanceBase(tann::MetricType::METRIC_IP) {}
+        PrimDistanceIPBFloat16() : DistanceBase(tann::MetricType::METRIC_IP) {}
         // distance comparison function
         TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_inner_product(to_span<float16>(a), to_span<float16>(b));
+            return PrimComparator::compare_inner_product(to_span<bfloat16>(a), to_span<bfloat16>(b));
         }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceIPFloat16() override = default;
+        TURBO_DLL ~PrimDistanceIPBFloat16() override = default;
 
     };
 
@@ -308,6 +447,19 @@ namespace tann {
 
     };
 
+    template<std::size_t Dim>
+    class PrimDistanceIPFloatDim : public DistanceBase {
+    public:
+        PrimDistanceIPFloatDim() : DistanceBase(tann::MetricType::METRIC_IP) {}
+        // distance comparison function
+        TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_inner_product_fixed<Dim>(reinterpret_cast<const float *>(a.data()),
+                                                                    reinterpret_cast<const float *>(b.data()));
+        }
+
+        TURBO_DLL ~PrimDistanceIPFloatDim() override = default;
+    };
+
     class PrimDistanceNormalizedCosineFloat16 : public DistanceBase {
     public:
         PrimDistanceNormalizedCosineFloat16() : DistanceBase(tann::MetricType::METRIC_NORMALIZED_COSINE) {}
@@ -348,12 +500,60 @@ namespace tann {
         // normalization might change the dimension of the query vector.
         TURBO_DLL void
         preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query) override {
-            TLOG_CHECK_LE(query_vec.size(), scratch_query.size(),
-                          "input query vector size must little equal than des vector size.");
+            TANN_DISTANCE_CHECK(query_vec.size() <= scratch_query.size(),
+                                "input query vector size must little equal than des vector size.");
             l2_norm(to_span<float16>(query_vec), to_span<float16>(scratch_query));
         }
 
 
+    };
+
+    class PrimDistanceNormalizedCosineBFloat16 : public DistanceBase {
+    public:
+        PrimDistanceNormalizedCosineBFloat16() : DistanceBase(tann::MetricType::METRIC_NORMALIZED_COSINE) {}
+        // distance comparison function
+        TURBO_DLL [[nodiscard]] double compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_normalized_cosine(to_span<bfloat16>(a), to_span<bfloat16>(b));
+        }
+        // Providing a default implementation for the virtual destructor because we
+        // don't expect most metric implementations to need it.
+        TURBO_DLL ~PrimDistanceNormalizedCosineBFloat16() override = default;
+
+        // This is for efficiency. If no normalization is required, the callers
+        // can simply ignore the normalize_data_for_build() function.
+        [[nodiscard]] TURBO_DLL bool preprocessing_required() const override {
+            return true;
+        }
+
+        // Check the preprocessing_required() function before calling this.
+        // Clients can call the function like this:
+        //
+        //  if (metric->preprocessing_required()){
+        //     T* normalized_data_batch;
+        //      Split data into batches of batch_size and for each, call:
+        //       metric->preprocess_base_points(data_batch, batch_size);
+        //
+        //  TODO: This does not take into account the case for SSD inner product
+        //  where the dimensions change after normalization.
+        TURBO_DLL void preprocess_base_points(turbo::Span<uint8_t> arr, size_t dim) override {
+            size_t nvec = arr.size() / (dim * sizeof(bfloat16));
+            for (size_t i = 0; i < nvec; ++i) {
+                auto one_v = to_span<bfloat16>(arr);
+                l2_norm(one_v);
+            }
+        }
+
+        // Invokes normalization for a single vector during search. The scratch space
+        // has to be created by the caller keeping track of the fact that
+        // normalization might change the dimension of the query vector.
+        TURBO_DLL void
+        preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query) override {
+            TANN_DISTANCE_CHECK(query_vec.size() <= scratch_query.size(),
+                                "input query vector size must little equal than des vector size.");
+            l2_norm(to_span<bfloat16>(query_vec), to_span<bfloat16>(scratch_query));
+        }
+
+
     };
 
     class PrimDistanceNormalizedCosineFloat : public DistanceBase {
@@ -396,8 +596,8 @@ namespace tann {
         // normalization might change the dimension of the query vector.
         TURBO_DLL void
         preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query) override {
-            TLOG_CHECK_LE(query_vec.size(), scratch_query.size(),
-                          "input query vector size must little equal than des vector size.");
+            TANN_DISTANCE_CHECK(query_vec.size() <= scratch_query.size(),
+                                "input query vector size must little equal than des vector size.");
             auto ad = to_span<float>(scratch_query);
             l2_norm(to_span<float>(query_vec), ad);
         }
@@ -433,13 +633,48 @@ namespace tann {
 
         TURBO_DLL void
         preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query) override {
-            TLOG_CHECK_LE(query_vec.size(), scratch_query.size(),
-                          "input query vector size must little equal than des vector size.");
+            TANN_DISTANCE_CHECK(query_vec.size() <= scratch_query.size(),
+                                "input query vector size must little equal than des vector size.");
             l2_norm(to_span<float16>(query_vec), to_span<float16>(scratch_query));
         }
 
     };
 
+    class PrimDistanceNormalizedAngleBFloat16 : public DistanceBase {
+    public:
+        PrimDistanceNormalizedAngleBFloat16() : DistanceBase(tann::MetricType::METRIC_NORMALIZED_ANGLE) {}
+        // distance comparison function
+        TURBO_DLL [[nodiscard]] double
+        compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_normalized_angle(to_span<bfloat16>(a), to_span<bfloat16>(b));
+        }
+        // Providing a default implementation for the virtual destructor because we
+        // don't expect most metric implementations to need it.
+        TURBO_DLL ~PrimDistanceNormalizedAngleBFloat16() override = default;
+
+        // This is for efficiency. If no normalization is required, the callers
+        // can simply ignore the normalize_data_for_build() function.
+        TURBO_DLL [[nodiscard]] bool preprocessing_required() const override {
+            return true;
+        }
+
+        TURBO_DLL void preprocess_base_points(turbo::Span<uint8_t> arr, size_t dim) override {
+            size_t nvec = arr.size() / (dim * sizeof(bfloat16));
+            for (size_t i = 0; i < nvec; ++i) {
+                auto one_v = to_span<bfloat16>(arr);
+                l2_norm(one_v);
+            }
+        }
+
+        TURBO_DLL void
+        preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query) override {
+            TANN_DISTANCE_CHECK(query_vec.size() <= scratch_query.size(),
+                                "input query vector size must little equal than des vector size.");
+            l2_norm(to_span<bfloat16>(query_vec), to_span<bfloat16>(scratch_query));
+        }
+
+    };
+
     class PrimDistanceNormalizedAngleFloat : public DistanceBase {
     public:
         PrimDistanceNormalizedAngleFloat() : DistanceBase(tann::MetricType::METRIC_NORMALIZED_ANGLE) {}
@@ -468,8 +703,8 @@ namespace tann {
 
         TURBO_DLL void
         preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query) override {
-            TLOG_CHECK_LE(query_vec.size(), scratch_query.size(),
-                          "input query vector size must little equal than des vector size.");
+            TANN_DISTANCE_CHECK(query_vec.size() <= scratch_query.size(),
+                                "input query vector size must little equal than des vector size.");
             l2_norm(to_span<float>(query_vec), to_span<float>(scratch_query));
         }
 
@@ -504,24 +739,24 @@ namespace tann {
 
         TURBO_DLL void
         preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query) override {
-            TLOG_CHECK_LE(query_vec.size(), scratch_query.size(),
-                          "input query vector size must little equal than des vector size.");
+            TANN_DISTANCE_CHECK(query_vec.size() <= scratch_query.size(),
+                                "input query vector size must little equal than des vector size.");
             l2_norm(to_span<float16>(query_vec), to_span<float16>(scratch_query));
         }
 
     };
 
-    class PrimDistanceNormalizedL2Float : public DistanceBase {
+    class PrimDistanceNormalizedL2BFloat16 : public DistanceBase {
     public:
-        PrimDistanceNormalizedL2Float() : DistanceBase(tann::MetricType::METRIC_NORMALIZED_L2) {}
+        PrimDistanceNormalizedL2BFloat16() : DistanceBase(tann::MetricType::METRIC_NORMALIZED_L2) {}
         // distance comparison function
         TURBO_DLL [[nodiscard]] double
         compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_normalized_l2(to_span<float>(a), to_span<float>(b));
+            return PrimComparator::compare_normalized_l2(to_span<bfloat16>(a), to_span<bfloat16>(b));
         }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceNormalizedL2Float() override = default;
+        TURBO_DLL ~PrimDistanceNormalizedL2BFloat16() override = default;
 
         // This is for efficiency. If no normalization is required, the callers
         // can simply ignore the normalize_data_for_build() function.
@@ -530,73 +765,117 @@ namespace tann {
         }
 
         TURBO_DLL void preprocess_base_points(turbo::Span<uint8_t> arr, size_t dim) override {
-            size_t nvec = arr.size() / (dim * sizeof(float));
+            size_t nvec = arr.size() / (dim * sizeof(bfloat16));
             for (size_t i = 0; i < nvec; ++i) {
-                auto one_v = to_span<float>(arr);
+                auto one_v = to_span<bfloat16>(arr);
                 l2_norm(one_v);
             }
         }
 
         TURBO_DLL void
         preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query) override {
-            TLOG_CHECK_LE(query_vec.size(), scratch_query.size(),
-                          "input query vector size must little equal than des vector size.");
-            l2_norm(to_span<float>(query_vec), to_span<float>(scratch_query));
+            TANN_DISTANCE_CHECK(query_vec.size() <= scratch_query.size(),
+                                "input query vector size must little equal than des vector size.");
+            l2_norm(to_span<bfloat16>(query_vec), to_span<bfloat16>(scratch_query));
         }
 
     };
 
-    class PrimDistancePoincareFloat16 : public DistanceBase {
+    class PrimDistanceNormalizedL2Float : public DistanceBase {
     public:
-        PrimDistancePoincareFloat16() : DistanceBase(tann::MetricType::METRIC_POINCARE) {}
+        PrimDistanceNormalizedL2Float() : DistanceBase(tann::MetricType::METRIC_NORMALIZED_L2) {}
         // distance comparison function
         TURBO_DLL [[nodiscard]] double
         compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_poincare(to_span<float16>(a), to_span<float16>(b));
+            return PrimComparator::compare_normalized_l2(to_span<float>(a), to_span<float>(b));
         }
         // Providing a default implementation for the virtual destructor because we
         // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistancePoincareFloat16() override = default;
-    };
+        TURBO_DLL ~PrimDistanceNormalizedL2Float() override = default;
 
-    class PrimDistancePoincareFloat : public DistanceBase {
-    public:
-        PrimDistancePoincareFloat() : DistanceBase(tann::MetricType::METRIC_POINCARE) {}
-        // distance comparison function
-        TURBO_DLL [[nodiscard]] double
-        compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_poincare(to_span<float>(a), to_span<float>(b));
+        // This is for efficiency. If no normalization is required, the callers
+        // can simply ignore the normalize_data_for_build() function.
+        TURBO_DLL [[nodiscard]] bool preprocessing_required() const override {
+            return true;
         }
-        // Providing a default implementation for the virtual destructor because we
-        // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistancePoincareFloat() override = default;
+
+        TURBO_DLL void preprocess_base_points(turbo::Span<uint8_t> arr, size_t dim) override {
+            size_t nvec = arr.size() / (dim * sizeof(float));
+            for (size_t i = 0; i < nvec; ++i) {
+                auto one_v = to_span<float>(arr);
+                l2_norm(one_v);
+            }
+        }
+
+        TURBO_DLL void
+        preprocess_query(turbo::Span<uint8_t> query_vec, turbo::Span<uint8_t> scratch_query) override {
+            TANN_DISTANCE_CHECK(query_vec.size() <= scratch_query.size(),
+                                "input query vector size must little equal than des vector size.");
+            l2_norm(to_span<float>(query_vec), to_span<float>(scratch_query));
+        }
+
     };
 
-    class PrimDistanceLorentzFloat16 : public DistanceBase {
+    // poincare ball distance of vectors of element type T, the norm is
+    // 1 - |a|^2, with it kept the rank is one l2 pass.
+    template<typename T>
+    class PrimDistancePoincare : public PrimNormDistance<PrimDistancePoincare<T>, T> {
     public:
-        PrimDistanceLorentzFloat16() : DistanceBase(tann::MetricType::METRIC_LORENTZ) {}
+        PrimDistancePoincare() : PrimNormDistance<PrimDistancePoincare<T>, T>(tann::MetricType::METRIC_POINCARE) {}
+
         // distance comparison function
         TURBO_DLL [[nodiscard]] double
         compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_lorentz(to_span<float16>(a), to_span<float16>(b));
+            return PrimComparator::compare_poincare(to_span<T>(a), to_span<T>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double compare_rank(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_poincare_rank(to_span<T>(a), to_span<T>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double rank_to_distance(double d) const override {
+            return std::acosh(1 + d);
+        }
+
+        static double norm_of(turbo::Span<T> a) {
+            return 1.0 - PrimComparator::compare_inner_product(a, a);
+        }
+
+        static double rank_of(turbo::Span<T> a, turbo::Span<T> b, double norm_a, double norm_b) {
+            return 2.0 * PrimComparator::compare_l2_sqr(a, b) / (norm_a * norm_b);
         }
-        // Providing a default implementation for the virtual destructor because we
-        // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceLorentzFloat16() override = default;
     };
 
-    class PrimDistanceLorentzFloat : public DistanceBase {
+    // lorentz model distance of vectors of element type T, the rank is
+    // the lorentz product a0 * b0 - a1 * b1 - ... - an * bn.
+    template<typename T>
+    class PrimDistanceLorentz : public DistanceBase {
     public:
-        PrimDistanceLorentzFloat() : DistanceBase(tann::MetricType::METRIC_LORENTZ) {}
+        PrimDistanceLorentz() : DistanceBase(tann::MetricType::METRIC_LORENTZ) {}
+
         // distance comparison function
         TURBO_DLL [[nodiscard]] double
         compare(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
-            return PrimComparator::compare_lorentz(to_span<float>(a), to_span<float>(b));
+            return PrimComparator::compare_lorentz(to_span<T>(a), to_span<T>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double compare_rank(turbo::Span<uint8_t> a, turbo::Span<uint8_t> b) const override {
+            return PrimComparator::compare_lorentz_rank(to_span<T>(a), to_span<T>(b));
+        }
+
+        TURBO_DLL [[nodiscard]] double rank_to_distance(double d) const override {
+            return std::acosh(d);
         }
-        // Providing a default implementation for the virtual destructor because we
-        // don't expect most metric implementations to need it.
-        TURBO_DLL ~PrimDistanceLorentzFloat() override = default;
     };
 
-}
+    using PrimDistancePoincareFloat16 = PrimDistancePoincare<float16>;
+    using PrimDistancePoincareBFloat16 = PrimDistancePoincare<bfloat16>;
+    using PrimDistancePoincareFloat = PrimDistancePoincare<float>;
+
+    using PrimDistanceLorentzFloat16 = PrimDistanceLorentz<float16>;
+    using PrimDistanceLorentzBFloat16 = PrimDistanceLorentz<bfloat16>;
+    using PrimDistanceLorentzFloat = PrimDistanceLorentz<float>;
+
+}  // namespace TANN_SIMD_NAMESPACE
+}  // namespace tann
 #endif // TANN_DISTANCE_PRIMITIVE_DISTANCE_H_
@@ -0,0 +1,38 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_DISTANCE_SIMD_NAMESPACE_H_
+#define TANN_DISTANCE_SIMD_NAMESPACE_H_
+
+///////////////////////////////////////////////////////////
+// The kernels bind to turbo::simd::default_arch, which is
+// picked by the compile flags. They are built once with the
+// library flags and once more per simd tier, see
+// distance_factory_*.cc. Each build lives in its own inline
+// namespace so the inline functions of different tiers are
+// never merged by the linker. A tier translation unit defines
+// TANN_SIMD_NAMESPACE before any include.
+//
+// Inline code outside the namespace, e.g. DistanceBase or
+// turbo, may be merged with a copy built by a baseline unit,
+// so the tiers must not emit it: DistanceBase is defined in
+// distance_base.cc, failed checks go through the out of line
+// distance_check_failed, the tiers return plain pointers and
+// leave status and log code to distance_factory.cc, and the
+// f16c tiers build half.hpp without its intrinsics.
+#ifndef TANN_SIMD_NAMESPACE
+#define TANN_SIMD_NAMESPACE simd_native
+#endif
+
+#endif  // TANN_DISTANCE_SIMD_NAMESPACE_H_
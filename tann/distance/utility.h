@@ -14,12 +14,15 @@
 #ifndef TANN_DISTANCE_UTILITY_H_
 #define TANN_DISTANCE_UTILITY_H_
 
+#include "tann/distance/simd_namespace.h"
+#include "tann/distance/half_kernels.h"
 #include "turbo/meta/span.h"
 #include "turbo/simd/simd.h"
 #include "tann/common/config.h"
 #include "turbo/format/print.h"
 
 namespace tann {
+inline namespace TANN_SIMD_NAMESPACE {
 
     // When the type is less than 4 bytes, numerical overflow often occurs. In this case,
     // use the general method to do norm, and the simd method is not applicable
@@ -55,33 +58,12 @@ namespace tann {
 
     template<>
     inline float get_l2_norm<float16>(turbo::Span<float16> arr) {
+        return sqrt(kernels::half_reduce<kernels::kHalfNormA>(arr.data(), arr.data(), arr.size()).norm_a);
+    }
 
-        const float16 *last = arr.data() + arr.size();
-        const float16 *pa = arr.data();
-#if TURBO_WITH_AVX512F
-        __m512 normA = _mm512_setzero_ps();
-        while (pa < last) {
-            __m512 am = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pa)));
-            normA = _mm512_add_ps(normA, _mm512_mul_ps(am, am));
-            pa += 16;
-        }
-        __m256 am256 = _mm256_add_ps(_mm512_extractf32x8_ps(normA, 0), _mm512_extractf32x8_ps(normA, 1));
-        __m128 am128 = _mm_add_ps(_mm256_extractf128_ps(am256, 0), _mm256_extractf128_ps(am256, 1));
-#elif TURBO_WITH_AVX2
-        __m256 normA = _mm256_setzero_ps();
-        __m256 am;
-        while (pa < last) {
-            am = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pa)));
-            normA = _mm256_add_ps(normA, _mm256_mul_ps(am, am));
-            pa += 8;
-        }
-        __m128 am128 = _mm_add_ps(_mm256_extractf128_ps(normA, 0), _mm256_extractf128_ps(normA, 1));
-#endif
-
-        __attribute__((aligned(32))) float f[4];
-        _mm_store_ps(f, am128);
-        double na = f[0] + f[1] + f[2] + f[3];
-        return sqrt(na);
+    template<>
+    inline float get_l2_norm<bfloat16>(turbo::Span<bfloat16> arr) {
+        return sqrt(kernels::half_reduce<kernels::kHalfNormA>(arr.data(), arr.data(), arr.size()).norm_a);
     }
 
     template<>
@@ -152,7 +134,22 @@ namespace tann {
         }
     }
 
+    inline void l2_norm(turbo::Span<bfloat16> arr) {
+        auto norm = get_l2_norm(arr);
+        for (std::size_t i = 0; i < arr.size(); ++i) {
+            arr[i] = bfloat16(arr[i] / norm);
+        }
+    }
+
+    inline void l2_norm(turbo::Span<bfloat16> arr, turbo::Span<bfloat16> dst) {
+        auto norm = get_l2_norm(arr);
+        for (std::size_t i = 0; i < arr.size(); ++i) {
+            dst[i] = bfloat16(arr[i] / norm);
+        }
+    }
+
 
+}  // namespace TANN_SIMD_NAMESPACE
 }  // namespace tann
 
 #endif  // TANN_DISTANCE_UTILITY_H_
@@ -12,9 +12,23 @@
 // limitations under the License.
 //
 #include "tann/flat/flat_engine.h"
+#include "tann/core/search_trace.h"
+#include <array>
 
 namespace tann {
 
+    namespace {
+        // the search budget is charged once per stride of scanned vectors
+        constexpr std::size_t kBudgetStride = 64;
+
+        // locations per call of the one vs many distance
+        constexpr std::size_t kDistanceBatch = 64;
+
+        inline bool over_budget(WorkSpace *ws, std::size_t i) {
+            return i != 0 && i % kBudgetStride == 0 && ws->over_budget(0, kBudgetStride);
+        }
+    }  // namespace
+
     turbo::Status FlatEngine::initialize(const IndexOption & base_option,const std::any &option, MemVectorStore *store) {
         _base_option = base_option;
         _data_store = store;
@@ -27,49 +41,108 @@ namespace tann {
         return turbo::OkStatus();
     }
 
+    turbo::Status FlatEngine::add_vectors(turbo::Span<location_t> lids) {
+        return turbo::OkStatus();
+    }
+
     turbo::Status FlatEngine::remove_vector(location_t lid) {
         return turbo::OkStatus();
     }
 
+    turbo::Status FlatEngine::reset_max_elements(std::size_t max_elements) {
+        _base_option.max_elements = max_elements;
+        return turbo::OkStatus();
+    }
+
     turbo::Status FlatEngine::search_vector(WorkSpace *ws) {
         //// check ok, start to do search work
-        auto query = to_span<uint8_t>(ws->query_view);
         auto data_size = _data_store->current_index();
-        auto k = ws->search_context->k;
+        auto k = ws->k;
         auto is_allow_func = ws->search_context->is_allowed;
+        auto *trace = ws->search_context->trace;
         auto first_travel_size = std::min(data_size, k);
         label_type label;
         auto &topk_results = ws->best_l_nodes;
 
         for (location_t i = 0; i < first_travel_size; i++) {
+            if(over_budget(ws, i)) {
+                ws->distance_computations = i;
+                ws->mark(LatencyPhase::kSearchBase);
+                return turbo::OkStatus();
+            }
             if(_data_store->is_deleted(i)) {
+                if(trace) {
+                    ++trace->deleted_skips;
+                }
                 continue;
             }
             label = _data_store->get_label(i).value();
             if(is_allow_func && !(*is_allow_func)(label)) {
+                if(trace) {
+                    ++trace->filter_rejections;
+                }
                 continue;
             }
-            auto d = _data_store->get_distance(query,i);
+            auto d = _data_store->get_query_distance(ws, i);
+            if(trace) {
+                trace->add_visit(i, 0, d, true);
+            }
             topk_results.insert({d, label, i});
         }
 
-        distance_type lastdist = topk_results.empty() ? std::numeric_limits<distance_type>::max() : topk_results.top().distance;
-        for (size_t i = k; i < data_size; i++) {
+        distance_type lastdist = topk_results.empty() ? std::numeric_limits<rank_distance_type>::max() : topk_results.top().distance;
+        // without a bounded distance the scan goes a batch at a time
+        bool batched = _data_store->has_batch_distance(ws);
+        std::array<double, kDistanceBatch> batch_ds;
+        size_t batch_first = 0;
+        size_t batch_end = 0;
+        size_t i = k;
+        for (; i < data_size; i++) {
+            if(over_budget(ws, i)) {
+                break;
+            }
             if(_data_store->is_deleted(i)) {
+                if(trace) {
+                    ++trace->deleted_skips;
+                }
                 continue;
             }
             label = _data_store->get_label(i).value();
             if(is_allow_func && !(*is_allow_func)(label)) {
+                if(trace) {
+                    ++trace->filter_rejections;
+                }
                 continue;
             }
-            auto d = _data_store->get_distance(query,i);
-            if(d < lastdist) {
+            // once k results are kept only a closer vector matters, the
+            // distance may stop early past lastdist.
+            bool full = topk_results.size() >= k;
+            double d;
+            if(batched) {
+                if(i >= batch_end) {
+                    batch_first = i;
+                    batch_end = std::min(i + kDistanceBatch, data_size);
+                    _data_store->get_query_distance(ws, batch_first,
+                                                    turbo::Span<double>(batch_ds.data(), batch_end - batch_first));
+                }
+                d = batch_ds[i - batch_first];
+            } else {
+                d = full ? _data_store->get_query_distance_bounded(ws, i, lastdist)
+                         : _data_store->get_query_distance(ws, i);
+            }
+            if(trace) {
+                trace->add_visit(i, 0, d, !full || d < lastdist, full && !batched);
+            }
+            if(!full || d < lastdist) {
                 topk_results.insert({d, label, static_cast<location_t>(i)});
                 if(!topk_results.empty()) {
                     lastdist = topk_results.top().distance;
                 }
             }
         }
+        // the budget is charged by strides, count the exact scan
+        ws->distance_computations = std::min(i, data_size);
+        ws->mark(LatencyPhase::kSearchBase);
         return turbo::OkStatus();
     }
 
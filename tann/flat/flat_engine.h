@@ -35,6 +35,8 @@ namespace tann {
 
         turbo::Status add_vector(WorkSpace*ws, location_t lid) override;
 
+        turbo::Status add_vectors(turbo::Span<location_t> lids) override;
+
         WorkSpace* make_workspace() override;
 
         void setup_workspace(WorkSpace*ws) override {
@@ -43,6 +45,12 @@ namespace tann {
 
         turbo::Status remove_vector(location_t lid) override;
 
+        turbo::Status reset_max_elements(std::size_t max_elements) override;
+
+        turbo::Status freeze() override {
+            return turbo::OkStatus();
+        }
+
         turbo::Status search_vector(WorkSpace *ws) override;
 
         turbo::Status save(turbo::SequentialWriteFile *file) override;
@@ -0,0 +1,130 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tann/hnsw/compressed_links.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "turbo/simd/simd.h"
+#include "turbo/log/logging.h"
+
+namespace tann {
+
+    namespace {
+        // inclusive prefix sum in place
+        inline void prefix_sum(location_t *data, uint32_t n) {
+            uint32_t i = 0;
+#if TURBO_WITH_SSE2
+            __m128i prev = _mm_setzero_si128();
+            for (; i + 4 <= n; i += 4) {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+                x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+                x = _mm_add_epi32(x, prev);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), x);
+                prev = _mm_shuffle_epi32(x, 0xFF);
+            }
+#endif
+            for (; i < n; ++i) {
+                if (i > 0) {
+                    data[i] += data[i - 1];
+                }
+            }
+        }
+
+        inline uint8_t bits_of(uint32_t v) {
+            uint8_t bits = 0;
+            while (v) {
+                ++bits;
+                v >>= 1;
+            }
+            return bits;
+        }
+    }  // namespace
+
+    void CompressedLinks::clear() {
+        _offsets.clear();
+        _data.clear();
+        _max_links = 0;
+    }
+
+    void CompressedLinks::reserve(std::size_t n) {
+        _offsets.reserve(n + 1);
+    }
+
+    void CompressedLinks::append(turbo::Span<const location_t> links) {
+        TLOG_CHECK(links.size() <= std::numeric_limits<uint16_t>::max(), "too many links {}", links.size());
+        if (_offsets.empty()) {
+            _offsets.push_back(0);
+            _data.resize(kPadding, 0);
+        }
+        auto count = static_cast<uint16_t>(links.size());
+        _max_links = std::max<uint32_t>(_max_links, count);
+        _sort_buffer.assign(links.begin(), links.end());
+        std::sort(_sort_buffer.begin(), _sort_buffer.end());
+        uint32_t max_delta = 0;
+        for (size_t i = 1; i < _sort_buffer.size(); ++i) {
+            max_delta = std::max(max_delta, _sort_buffer[i] - _sort_buffer[i - 1]);
+        }
+        uint8_t bits = bits_of(max_delta);
+        size_t body = count == 0 ? 0 : sizeof(location_t) + ((count - 1) * bits + 7) / 8;
+
+        // drop the padding, write the list and put the padding back
+        size_t start = _offsets.back();
+        _data.resize(start + kHeaderSize + body + kPadding, 0);
+        uint8_t *p = _data.data() + start;
+        std::memcpy(p, &count, sizeof(count));
+        p[2] = bits;
+        if (count > 0) {
+            std::memcpy(p + kHeaderSize, &_sort_buffer[0], sizeof(location_t));
+            uint8_t *packed = p + kHeaderSize + sizeof(location_t);
+            for (size_t i = 1; i < count; ++i) {
+                uint64_t delta = _sort_buffer[i] - _sort_buffer[i - 1];
+                size_t bitpos = (i - 1) * bits;
+                uint64_t w;
+                std::memcpy(&w, packed + (bitpos >> 3), sizeof(w));
+                w |= delta << (bitpos & 7);
+                std::memcpy(packed + (bitpos >> 3), &w, sizeof(w));
+            }
+        }
+        _offsets.push_back(start + kHeaderSize + body);
+    }
+
+    uint32_t CompressedLinks::count(location_t lid) const {
+        uint16_t count;
+        std::memcpy(&count, _data.data() + _offsets[lid], sizeof(count));
+        return count;
+    }
+
+    uint32_t CompressedLinks::decode(location_t lid, location_t *out) const {
+        const uint8_t *p = _data.data() + _offsets[lid];
+        uint16_t count;
+        std::memcpy(&count, p, sizeof(count));
+        if (count == 0) {
+            return 0;
+        }
+        uint8_t bits = p[2];
+        std::memcpy(out, p + kHeaderSize, sizeof(location_t));
+        const uint8_t *packed = p + kHeaderSize + sizeof(location_t);
+        const uint64_t mask = (uint64_t(1) << bits) - 1;
+        for (uint32_t i = 1; i < count; ++i) {
+            size_t bitpos = (i - 1) * bits;
+            uint64_t w;
+            std::memcpy(&w, packed + (bitpos >> 3), sizeof(w));
+            out[i] = static_cast<location_t>((w >> (bitpos & 7)) & mask);
+        }
+        prefix_sum(out, count);
+        return count;
+    }
+}  // namespace tann
@@ -0,0 +1,73 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_HNSW_COMPRESSED_LINKS_H_
+#define TANN_HNSW_COMPRESSED_LINKS_H_
+
+#include <cstdint>
+#include <vector>
+#include "tann/core/types.h"
+#include "turbo/meta/span.h"
+
+namespace tann {
+
+    ///////////////////////////////////////////////////////////
+    // CompressedLinks holds one read only neighbor list per
+    // location, lists are appended in location order.
+    // A list is sorted and stored as
+    //   uint16 count | uint8 bits | uint32 first | (count - 1) deltas of `bits` bits
+    // the deltas are decoded with an unaligned 64 bit load each
+    // and a SIMD prefix sum.
+    class CompressedLinks {
+    public:
+        CompressedLinks() = default;
+
+        void clear();
+
+        void reserve(std::size_t n);
+
+        // append the list of the next location, the input is not modified.
+        void append(turbo::Span<const location_t> links);
+
+        // decode the list of lid into out, out must hold max_links()
+        // elements. returns the list size.
+        uint32_t decode(location_t lid, location_t *out) const;
+
+        [[nodiscard]] uint32_t count(location_t lid) const;
+
+        [[nodiscard]] std::size_t size() const {
+            return _offsets.empty() ? 0 : _offsets.size() - 1;
+        }
+
+        [[nodiscard]] uint32_t max_links() const {
+            return _max_links;
+        }
+
+        [[nodiscard]] std::size_t memory_size() const {
+            return _offsets.capacity() * sizeof(uint64_t) + _data.capacity();
+        }
+
+    private:
+        // every unaligned 64 bit load stays in the buffer
+        static constexpr std::size_t kPadding = 8;
+        static constexpr std::size_t kHeaderSize = 3;
+
+        std::vector<uint64_t> _offsets;
+        std::vector<uint8_t> _data;
+        std::vector<location_t> _sort_buffer;
+        uint32_t _max_links{0};
+    };
+}  // namespace tann
+
+#endif  // TANN_HNSW_COMPRESSED_LINKS_H_
@@ -14,23 +14,37 @@
 
 #include "tann/hnsw/hnsw_engine.h"
 #include "tann/common/utility.h"
+#include "tann/core/search_trace.h"
 
 namespace tann {
+
+    namespace {
+        // a visited node kept out of the results, deleted or filtered
+        template<bool has_deletions>
+        inline void trace_rejection(SearchTrace *trace, const MemVectorStore *store, location_t lid) {
+            if (has_deletions && store->is_deleted(lid)) {
+                ++trace->deleted_skips;
+            } else {
+                ++trace->filter_rejections;
+            }
+        }
+    }  // namespace
     turbo::Status HnswEngine::initialize(const IndexOption& base_option, const std::any &option, MemVectorStore *store) {
         _data_store = store;
         _base_option = base_option;
         _option = std::any_cast<HnswIndexOption>(option);
-        _level_generator.seed(_option.random_seed);
         _maxM = _option.m;
 
         _final_graph.initialize(_base_option.max_elements, _maxM);
         _visited_list_pool = std::make_unique<VisitedListPool>(1, _base_option.max_elements);
-        std::vector<std::mutex> temp(_base_option.max_elements);
-        _link_list_locks = std::move(temp);
+        _link_list_locks.resize(_base_option.max_elements);
         _mult = 1 / log(1.0 * static_cast<double >(_option.m));
         return turbo::OkStatus();
     }
     turbo::Status HnswEngine::add_vector(WorkSpace*ws, location_t lid) {
+        if (_final_graph.is_compressed()) {
+            return turbo::FailedPreconditionError("graph is frozen");
+        }
         auto hws = reinterpret_cast<HnswWorkSpace*>(ws);
 
         if(ws->is_update) {
@@ -40,42 +54,221 @@ namespace tann {
         }
     }
 
+    turbo::Status HnswEngine::add_vectors(turbo::Span<location_t> lids) {
+        if (lids.empty()) {
+            return turbo::OkStatus();
+        }
+        if (_final_graph.is_compressed()) {
+            return turbo::FailedPreconditionError("graph is frozen");
+        }
+        auto executor = _data_store->executor();
+        size_t batch_size = std::max<size_t>(1, _option.build_batch_size);
+        // one workspace per thread a batch loop runs on
+        std::vector<std::unique_ptr<HnswWorkSpace>> wss(
+                executor->loop_concurrency(std::min(batch_size, lids.size()), _option.build_threads));
+        for (auto &ws: wss) {
+            ws = std::make_unique<HnswWorkSpace>();
+        }
+        size_t start = 0;
+        // the first node has nothing to link to
+        if (_enterpoint_node == constants::kUnknownLocation) {
+            auto r = add_vector_internal(wss[0].get(), lids[0]);
+            if (!r.ok()) {
+                return r;
+            }
+            start = 1;
+        }
+        std::vector<BuildCandidates> build(batch_size);
+        for (size_t b = start; b < lids.size(); b += batch_size) {
+            auto batch = lids.subspan(b, std::min(batch_size, lids.size() - b));
+            location_t ep_id = _enterpoint_node;
+            int max_level = _max_level;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                build[i].level = get_random_level(batch[i], _mult);
+            }
+            // 1. search every node of the batch against the frozen graph,
+            //    nothing is written to the graph in this phase.
+            executor->parallel_for(0, batch.size(), [&](size_t i, size_t tid) {
+                search_build_candidates(wss[tid].get(), batch, i, ep_id, max_level, build);
+            }, _option.build_threads);
+            // 2. commit in input order, so the graph does not depend on
+            //    thread interleaving.
+            for (size_t i = 0; i < batch.size(); ++i) {
+                auto r = commit_build_candidates(wss[0].get(), batch[i], build[i]);
+                if (!r.ok()) {
+                    return r;
+                }
+            }
+        }
+        return turbo::OkStatus();
+    }
+
+    void HnswEngine::search_build_candidates(HnswWorkSpace *hws, turbo::Span<location_t> batch, size_t idx,
+                                             location_t ep_id, int max_level, std::vector<BuildCandidates> &build) {
+        auto lid = batch[idx];
+        auto &bc = build[idx];
+        bc.levels.resize(bc.level + 1);
+        for (auto &l: bc.levels) {
+            l.clear();
+        }
+        location_t currObj = ep_id;
+        if (bc.level < max_level) {
+            distance_type curdist = _data_store->get_distance(lid, currObj);
+            for (int l_level = max_level; l_level > bc.level; l_level--) {
+                bool changed = true;
+                while (changed) {
+                    changed = false;
+                    auto node = _final_graph.const_node(currObj, l_level);
+                    size_t size = node.size();
+                    for (size_t i = 0; i < size; i++) {
+                        location_t cand = node[i];
+                        auto d = _data_store->get_distance(lid, cand);
+                        if (d < curdist) {
+                            curdist = d;
+                            currObj = cand;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+        }
+        bool epDeleted = _data_store->is_deleted(ep_id);
+        for (int l_level = std::min(bc.level, max_level); l_level >= 0; l_level--) {
+            auto &top_candidates = hws->top_candidates;
+            auto &candidate_set = hws->candidate_set;
+            candidate_set.clear();
+            candidate_set.reserve(_option.ef_construction + 1);
+            top_candidates.clear();
+            top_candidates.reserve(_option.ef_construction + 1);
+            search_base_layer(hws, currObj, lid, l_level);
+            if (epDeleted) {
+                top_candidates.insert(_data_store->get_distance(lid, ep_id), ep_id);
+            }
+            auto &out = bc.levels[l_level];
+            for (size_t i = 0; i < top_candidates.size(); ++i) {
+                out.emplace_back(top_candidates[i].distance, top_candidates[i].lid);
+            }
+            if (!top_candidates.empty()) {
+                currObj = top_candidates[0].lid;
+            }
+        }
+        // nodes before this one in the batch are not in the graph yet
+        for (size_t j = 0; j < idx; ++j) {
+            int shared_level = std::min(bc.level, build[j].level);
+            auto d = _data_store->get_distance(lid, batch[j]);
+            for (int l_level = 0; l_level <= shared_level; ++l_level) {
+                bc.levels[l_level].emplace_back(d, batch[j]);
+            }
+        }
+    }
+
+    turbo::Status HnswEngine::commit_build_candidates(HnswWorkSpace *hws, location_t lid, BuildCandidates &bc) {
+        auto r = _final_graph.setup_location(lid, bc.level);
+        if (!r.ok()) {
+            return r;
+        }
+        for (int l_level = std::min(bc.level, _max_level); l_level >= 0; l_level--) {
+            auto &cands = bc.levels[l_level];
+            if (cands.empty()) {
+                continue;
+            }
+            auto &top_candidates = hws->top_candidates;
+            top_candidates.clear();
+            top_candidates.reserve(cands.size());
+            for (auto &c: cands) {
+                top_candidates.insert(c.first, c.second);
+            }
+            auto rs = mutually_connect_new_element(hws, lid, l_level, false);
+            if (!rs.ok()) {
+                return rs.status();
+            }
+        }
+        if (bc.level > _max_level) {
+            _enterpoint_node = lid;
+            _max_level = bc.level;
+        }
+        return turbo::OkStatus();
+    }
+
     WorkSpace* HnswEngine::make_workspace() {
         return new HnswWorkSpace();
     }
 
     void HnswEngine::setup_workspace(WorkSpace*ws)  {
         auto *hnsw_ws = reinterpret_cast<HnswWorkSpace *>(ws);
-        hnsw_ws->search_l = std::max(_option.ef, hnsw_ws->search_context->k);
+        hnsw_ws->search_l = std::max(hnsw_ws->search_list ? hnsw_ws->search_list : _option.ef,
+                                     hnsw_ws->k);
+        if (_final_graph.is_compressed()) {
+            hnsw_ws->links.resize(_final_graph.capacity_for_level(0));
+        }
+        hnsw_ws->early_stop_hops = hnsw_ws->search_context->early_stop_hops ? hnsw_ws->search_context->early_stop_hops
+                                                                           : _option.early_stop_hops;
     }
 
     turbo::Status HnswEngine::remove_vector(location_t lid) {
         return turbo::OkStatus();
     }
 
+    turbo::Status HnswEngine::reset_max_elements(std::size_t max_elements) {
+        if (max_elements <= _base_option.max_elements) {
+            return turbo::OkStatus();
+        }
+        // a frozen graph only syncs with what it has loaded
+        if (_final_graph.is_compressed() && max_elements > _final_graph.max_elements()) {
+            return turbo::FailedPreconditionError("graph is frozen");
+        }
+        TLOG_INFO("hnsw grow capacity from {} to {}", _base_option.max_elements, max_elements);
+        // graph nodes and locks are chunk allocated, links that
+        // already exist are not moved.
+        _final_graph.reserve(max_elements);
+        _link_list_locks.resize(max_elements);
+        _visited_list_pool->reset_num_elements(max_elements);
+        _base_option.max_elements = max_elements;
+        return turbo::OkStatus();
+    }
+
+    turbo::Status HnswEngine::freeze() {
+        auto before = _final_graph.memory_size();
+        _final_graph.compress();
+        TLOG_INFO("hnsw graph compressed from {} to {} bytes", before, _final_graph.memory_size());
+        return turbo::OkStatus();
+    }
+
     turbo::Status HnswEngine::search_vector(WorkSpace *base_ws) {
         if (_data_store->size() == 0) {
             return turbo::OkStatus();
         }
         auto *hnsw_ws = reinterpret_cast<HnswWorkSpace *>(base_ws);
         location_t currObj = _enterpoint_node;
-        auto query_data = to_span<uint8_t>(hnsw_ws->query_view);
-        distance_type curdist = _data_store->get_distance(query_data, _enterpoint_node);
+        distance_type curdist = _data_store->get_query_distance(hnsw_ws, _enterpoint_node);
+        auto *trace = hnsw_ws->search_context->trace;
+        if (trace) {
+            trace->entry_point = _enterpoint_node;
+            // level 0 records it again when the descent does not move
+            if (_max_level > 0) {
+                trace->add_visit(_enterpoint_node, _max_level, curdist, true);
+            }
+        }
         // travel all level > 0 (only 1 level) and find nearest ep
-        for (int level = _max_level; level > 0; level--) {
+        // a spent budget goes down to level 0 from the current node
+        for (int level = _max_level; level > 0 && !hnsw_ws->truncated; level--) {
             bool changed = true;
             while (changed) {
                 changed = false;
                 auto node = _final_graph.mutable_node(currObj, level);
                 size_t size = node.size();
-                metric_hops++;
-                metric_distance_computations += size;
+                if (trace) {
+                    trace->add_hop(level);
+                }
 
                 for (int i = 0; i < size; i++) {
                     location_t cand = node[i];
                     if (cand > _base_option.max_elements)
                         return turbo::InternalError("cand error");
-                    auto d = _data_store->get_distance(query_data, cand);
+                    auto d = _data_store->get_query_distance(hnsw_ws, cand);
+                    if (trace) {
+                        trace->add_visit(cand, level, d, d < curdist);
+                    }
 
                     if (d < curdist) {
                         curdist = d;
@@ -83,16 +276,25 @@ namespace tann {
                         changed = true;
                     }
                 }
+                if (hnsw_ws->over_budget(1, size)) {
+                    break;
+                }
             }
         }
+        hnsw_ws->mark(LatencyPhase::kSearchDescent);
         hnsw_ws->top_candidates.clear();
         hnsw_ws->top_candidates.reserve(hnsw_ws->search_l);
         hnsw_ws->candidate_set.clear();
         hnsw_ws->candidate_set.reserve(2 * hnsw_ws->search_l);
-        if (_data_store->deleted_size()) {
+        bool has_deletions = _data_store->deleted_size() != 0;
+        if (has_deletions && trace) {
             search_base_layer_st<true, true>(currObj, hnsw_ws);
-        } else {
+        } else if (has_deletions) {
+            search_base_layer_st<true, false>(currObj, hnsw_ws);
+        } else if (trace) {
             search_base_layer_st<false, true>(currObj, hnsw_ws);
+        } else {
+            search_base_layer_st<false, false>(currObj, hnsw_ws);
         }
         auto &top_candidates = hnsw_ws->top_candidates;
         while (top_candidates.size() > hnsw_ws->search_l) {
@@ -104,10 +306,11 @@ namespace tann {
             hnsw_ws->best_l_nodes.insert(rez);
             top_candidates.pop();
         }
+        hnsw_ws->mark(LatencyPhase::kSearchBase);
         return turbo::OkStatus();
     }
 
-    template<bool has_deletions, bool collect_metrics>
+    template<bool has_deletions, bool traced>
     void HnswEngine::search_base_layer_st(location_t ep_id, HnswWorkSpace *hws) const {
         VisitedList *vl = _visited_list_pool->getFreeVisitedList();
         vl_type *visited_array = vl->mass;
@@ -117,16 +320,27 @@ namespace tann {
         auto &candidate_set = hws->candidate_set;
 
         auto isIdAllowed = hws->search_context->is_allowed;
+        auto *trace = hws->search_context->trace;
+        // convergence check, count the expanded nodes since the k-th best
+        // result was last improved.
+        auto early_stop_hops = hws->early_stop_hops;
+        size_t k = std::min<size_t>(hws->k ? hws->k : ef, ef);
+        size_t stale_hops = 0;
         distance_type lowerBound;
         if ((!has_deletions || !_data_store->is_deleted(ep_id)) &&
             ((!isIdAllowed) || (*isIdAllowed)(_data_store->get_label(ep_id).value()))) {
-            auto data_point = to_span<uint8_t>(hws->query_view);
-            distance_type dist = _data_store->get_distance(data_point, ep_id);
+            distance_type dist = _data_store->get_query_distance(hws, ep_id);
             lowerBound = dist;
             top_candidates.insert(dist, ep_id);
             candidate_set.insert(-dist, ep_id);
+            if (traced) {
+                trace->add_visit(ep_id, 0, dist, true);
+            }
         } else {
-            lowerBound = std::numeric_limits<distance_type>::max();
+            if (traced) {
+                trace_rejection<has_deletions>(trace, _data_store, ep_id);
+            }
+            lowerBound = std::numeric_limits<rank_distance_type>::max();
             candidate_set.insert(-lowerBound, ep_id);
         }
 
@@ -144,32 +358,64 @@ namespace tann {
             candidate_set.pop();
 
             location_t current_node_id = current_node_pair.lid;
-            auto data = _final_graph.const_node(current_node_id, 0);
-            size_t size = data.size();
+            const location_t *data;
+            size_t size;
+            if (_final_graph.is_compressed()) {
+                size = _final_graph.level0_links(current_node_id, hws->links.data());
+                data = hws->links.data();
+            } else {
+                auto node = _final_graph.const_node(current_node_id, 0);
+                size = node.size();
+                data = &node[0];
+            }
             //bool cur_node_deleted = isMarkedDeleted(current_node_id);
-            if (collect_metrics) {
-                metric_hops++;
-                metric_distance_computations += size;
+            if (traced) {
+                trace->add_hop(0);
             }
-            for (size_t j = 1; j < size; j++) {
+            bool improved = false;
+            for (size_t j = 0; j < size; j++) {
                 location_t candidate_id = data[j];
                 if (visited_array[candidate_id] != visited_array_tag) {
                     visited_array[candidate_id] = visited_array_tag;
-                    auto data_point = to_span<uint8_t>(hws->query_view);
-                    distance_type dist = _data_store->get_distance(data_point, candidate_id);
+                    // with ef results kept a candidate past lowerBound is dropped,
+                    // its distance may stop early.
+                    bool bounded = top_candidates.size() >= ef;
+                    distance_type dist = bounded
+                                         ? _data_store->get_query_distance_bounded(hws, candidate_id, lowerBound)
+                                         : _data_store->get_query_distance(hws, candidate_id);
+                    bool queued = !bounded || lowerBound > dist;
+                    if (traced) {
+                        trace->add_visit(candidate_id, 0, dist, queued, bounded);
+                    }
 
-                    if (top_candidates.size() < ef || lowerBound > dist) {
+                    if (queued) {
                         candidate_set.insert(-dist, candidate_id);
 
                         if ((!has_deletions || !_data_store->is_deleted(candidate_id)) &&
-                            ((!isIdAllowed) || (*isIdAllowed)(_data_store->get_label(candidate_id).value())))
+                            ((!isIdAllowed) || (*isIdAllowed)(_data_store->get_label(candidate_id).value()))) {
+                            if (top_candidates.size() < k || dist < top_candidates[k - 1].distance) {
+                                improved = true;
+                            }
                             top_candidates.insert(dist, candidate_id);
+                        } else if (traced) {
+                            trace_rejection<has_deletions>(trace, _data_store, candidate_id);
+                        }
 
                         if (!top_candidates.empty())
                             lowerBound = top_candidates.top().distance;
                     }
                 }
             }
+            if (hws->over_budget(1, size)) {
+                break;
+            }
+            if (early_stop_hops) {
+                if (improved) {
+                    stale_hops = 0;
+                } else if (top_candidates.size() >= k && ++stale_hops >= early_stop_hops) {
+                    break;
+                }
+            }
         }
 
         _visited_list_pool->releaseVisitedList(vl);
@@ -178,7 +424,7 @@ namespace tann {
     turbo::Status HnswEngine::add_vector_internal(HnswWorkSpace *hws,location_t lid) {
 
         std::unique_lock<std::mutex> lock_el(_link_list_locks[lid]);
-        int cur_level = get_random_level(_mult);
+        int cur_level = get_random_level(lid, _mult);
 
         //_element_levels[cur_c] = cur_level;
         std::unique_lock<std::mutex> templock(_global_lock);
@@ -254,9 +500,16 @@ namespace tann {
         return turbo::OkStatus();
     }
 
-    int HnswEngine::get_random_level(double reverse_size) {
-        std::uniform_real_distribution<double> distribution(0.0, 1.0);
-        double r = -log(distribution(_level_generator)) * reverse_size;
+    int HnswEngine::get_random_level(location_t lid, double reverse_size) const {
+        // one random stream per location (splitmix64 of seed and lid), the
+        // level of a node does not depend on which thread inserts it or when.
+        uint64_t z = static_cast<uint64_t>(_option.random_seed) + 0x9E3779B97F4A7C15ULL * (lid + 1);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z = z ^ (z >> 31);
+        // uniform in (0, 1]
+        double u = static_cast<double>((z >> 11) + 1) * 0x1.0p-53;
+        double r = -log(u) * reverse_size;
         return (int) r;
     }
 
@@ -405,7 +658,7 @@ namespace tann {
             lowerBound = dist;
             candidateSet.insert(-dist, ep_id);
         } else {
-            lowerBound = std::numeric_limits<distance_type>::max();
+            lowerBound = std::numeric_limits<rank_distance_type>::max();
             candidateSet.insert(-lowerBound, ep_id);
         }
         visited_array[ep_id] = visited_array_tag;
@@ -643,19 +896,31 @@ namespace tann {
             return r;
         }
         // graph
-        r = _final_graph.load(*file);
+        r = _final_graph.load(*file, _option.compress_graph);
         if (!r.ok()) {
             return r;
         }
+        // the capacity is the loaded graph, larger or smaller than before
+        auto loaded = _final_graph.max_elements();
+        if (loaded > _base_option.max_elements) {
+            return reset_max_elements(loaded);
+        }
+        _base_option.max_elements = loaded;
         return turbo::OkStatus();
     }
 
     template void
     HnswEngine::search_base_layer_st<true, true>(location_t ep_id, HnswWorkSpace *qctx) const;
 
+    template void
+    HnswEngine::search_base_layer_st<true, false>(location_t ep_id, HnswWorkSpace *qctx) const;
+
     template void
     HnswEngine::search_base_layer_st<false, true>(location_t ep_id, HnswWorkSpace *qctx) const;
 
+    template void
+    HnswEngine::search_base_layer_st<false, false>(location_t ep_id, HnswWorkSpace *qctx) const;
+
 }  // namespace tann
 
 tann::Engine* HnswIndexCreator(const std::any &option) {
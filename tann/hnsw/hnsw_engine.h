@@ -21,6 +21,7 @@
 #include "tann/hnsw/leveled_graph.h"
 #include "tann/hnsw/visited_list_pool.h"
 #include "tann/hnsw/hnsw_work_space.h"
+#include "tann/common/chunked_array.h"
 
 namespace tann {
 
@@ -33,12 +34,19 @@ namespace tann {
 
         turbo::Status add_vector(WorkSpace*ws, location_t lid) override;
 
+        turbo::Status add_vectors(turbo::Span<location_t> lids) override;
+
         WorkSpace* make_workspace() override;
 
         void setup_workspace(WorkSpace*ws) override;
 
         turbo::Status remove_vector(location_t lid) override;
 
+        turbo::Status reset_max_elements(std::size_t max_elements) override;
+
+        // compress the level 0 links, the graph is read only after it.
+        turbo::Status freeze() override;
+
         turbo::Status search_vector(WorkSpace *ws) override;
 
         turbo::Status save(turbo::SequentialWriteFile *file) override;
@@ -46,7 +54,7 @@ namespace tann {
         turbo::Status load(turbo::SequentialReadFile *file) override;
 
         bool support_dynamic() const override {
-            return true;
+            return !_final_graph.is_compressed();
         }
 
         bool need_model() const override {
@@ -54,6 +62,19 @@ namespace tann {
         }
 
     private:
+        // candidates of one node of a build batch, searched in parallel
+        // against the graph frozen at the start of the batch.
+        struct BuildCandidates {
+            int level{-1};
+            // index is the graph level
+            std::vector<std::vector<std::pair<distance_type, location_t>>> levels;
+        };
+
+        void search_build_candidates(HnswWorkSpace *ws, turbo::Span<location_t> batch, size_t idx,
+                                     location_t ep_id, int max_level, std::vector<BuildCandidates> &build);
+
+        turbo::Status commit_build_candidates(HnswWorkSpace *ws, location_t lid, BuildCandidates &bc);
+
         turbo::Status add_vector_internal(HnswWorkSpace *ws, location_t lid);
 
         turbo::Status update_vector_internal(HnswWorkSpace *ws, location_t lid);
@@ -71,9 +92,10 @@ namespace tann {
         mutually_connect_new_element(HnswWorkSpace *ws,location_t cur_c, int level,
                                      bool isUpdate);
 
-        int get_random_level(double reverse_size);
+        [[nodiscard]] int get_random_level(location_t lid, double reverse_size) const;
 
-        template<bool has_deletions, bool collect_metrics>
+        // traced records the search in SearchContext::trace
+        template<bool has_deletions, bool traced>
         void search_base_layer_st(location_t ep_id, HnswWorkSpace *hws) const;
     private:
         IndexOption _base_option;
@@ -89,12 +111,9 @@ namespace tann {
         LeveledGraph _final_graph;
 
         std::mutex _global_lock;
-        std::vector<std::mutex> _link_list_locks;
+        ChunkedArray<std::mutex> _link_list_locks;
         std::unique_ptr<VisitedListPool> _visited_list_pool;
-        std::default_random_engine _level_generator;
 
-        mutable std::atomic<size_t> metric_distance_computations{0};
-        mutable std::atomic<size_t> metric_hops{0};
     };
 }  // namespace tann
 
@@ -26,6 +26,9 @@ namespace tann {
         NeighborQueue candidate_set;
         std::vector<std::pair<distance_type, location_t>> return_list;
         uint32_t search_l{0};
+        size_t early_stop_hops{0};
+        // level 0 links decoded from a compressed graph
+        std::vector<location_t> links;
 
         void clear_sub() override {
             top_candidates.clear();
@@ -28,13 +28,24 @@ namespace tann {
             return r;
         }
 
+        // a compressed graph is saved in the plain layout
+        std::vector<location_t> links;
         for (size_t i = 0; i < nsize; ++i) {
             auto &ref  = _nodes[i];
             r = write_binary_pod(file, ref.level);
             if(!r.ok()) {
                 return r;
             }
-            r = write_binary_vector<location_t>(file, ref.links);
+            if (_compressed && ref.level >= 0) {
+                links = ref.links;
+                if (links.empty()) {
+                    links.resize(_max_nbor * 2 + 1, 0);
+                }
+                links[0] = _level0.decode(i, links.data() + 1);
+                r = write_binary_vector<location_t>(file, links);
+            } else {
+                r = write_binary_vector<location_t>(file, ref.links);
+            }
             if(!r.ok()) {
                 return r;
             }
@@ -42,7 +53,41 @@ namespace tann {
         return turbo::OkStatus();
     }
 
-    [[nodiscard]] turbo::Status LeveledGraph::load(turbo::SequentialReadFile &file) {
+    void LeveledGraph::compress_node(LeveledNode &n) {
+        if (n.level < 0) {
+            _level0.append({});
+            return;
+        }
+        _level0.append(turbo::Span<const location_t>(n.links.data() + 1, n.links[0]));
+        if (n.level == 0) {
+            std::vector<location_t>().swap(n.links);
+        }
+    }
+
+    void LeveledGraph::compress() {
+        if (_compressed) {
+            return;
+        }
+        _level0.clear();
+        _level0.reserve(_nodes.size());
+        for (size_t i = 0; i < _nodes.size(); ++i) {
+            compress_node(_nodes[i]);
+        }
+        _compressed = true;
+    }
+
+    std::size_t LeveledGraph::memory_size() const {
+        std::size_t total = _nodes.capacity() * sizeof(LeveledNode);
+        for (size_t i = 0; i < _nodes.size(); ++i) {
+            total += _nodes[i].links.capacity() * sizeof(location_t);
+        }
+        if (_compressed) {
+            total += _level0.memory_size();
+        }
+        return total;
+    }
+
+    [[nodiscard]] turbo::Status LeveledGraph::load(turbo::SequentialReadFile &file, bool compress) {
         auto r = read_binary_pod(file, _max_nbor);
         if(!r.ok()) {
             return r;
@@ -52,7 +97,13 @@ namespace tann {
         if(!r.ok()) {
             return r;
         }
+        _nodes.clear();
         _nodes.resize(nsize);
+        _compressed = compress;
+        _level0.clear();
+        if (compress) {
+            _level0.reserve(nsize);
+        }
 
         for (size_t i = 0; i < _nodes.size(); ++i) {
             auto &ref  = _nodes[i];
@@ -60,13 +111,14 @@ namespace tann {
             if(!r.ok()) {
                 return r;
             }
-            if(ref.level == -1) {
-                continue;
-            }
+            // save writes the links of unused locations too
             r = read_binary_vector(file, ref.links);
             if(!r.ok()) {
                 return r;
             }
+            if (compress) {
+                compress_node(ref);
+            }
         }
         return turbo::OkStatus();
     }
@@ -16,12 +16,15 @@
 #ifndef TANN_HNSW_LEVELED_GRAPH_H_
 #define TANN_HNSW_LEVELED_GRAPH_H_
 
+#include <cstring>
 #include <vector>
 #include "turbo/base/status.h"
 #include "tann/core/types.h"
 #include "turbo/meta/span.h"
 #include "turbo/files/sequential_write_file.h"
 #include "turbo/files/sequential_read_file.h"
+#include "tann/common/chunked_array.h"
+#include "tann/hnsw/compressed_links.h"
 
 namespace tann {
 
@@ -108,6 +111,18 @@ namespace tann {
 
         }
 
+        // grow the node table, nodes are chunk allocated, so the
+        // nodes and links already set up keep their address.
+        void reserve(location_t max_elements) {
+            if (max_elements > _nodes.size()) {
+                _nodes.resize(max_elements);
+            }
+        }
+
+        [[nodiscard]] std::size_t max_elements() const {
+            return _nodes.size();
+        }
+
         LeveledNode &at(location_t n) {
             return _nodes[n];
         }
@@ -169,13 +184,45 @@ namespace tann {
             }
         }
 
+        //////////////////////////////////////////
+        // move level 0 links into a CompressedLinks and release the
+        // links of nodes living only on level 0. After it level 0 is
+        // read only and must be read by level0_links, mutable_node and
+        // const_node can only be used on the upper levels.
+        void compress();
+
+        [[nodiscard]] bool is_compressed() const {
+            return _compressed;
+        }
+
+        // the level 0 links of lid, out must hold capacity_for_level(0)
+        // elements, it works on both layouts.
+        uint32_t level0_links(location_t lid, location_t *out) const {
+            if (_compressed) {
+                return _level0.decode(lid, out);
+            }
+            auto &n = _nodes[lid];
+            uint32_t size = n.links[0];
+            std::memcpy(out, n.links.data() + 1, size * sizeof(location_t));
+            return size;
+        }
+
+        [[nodiscard]] std::size_t memory_size() const;
+
         [[nodiscard]] turbo::Status save(turbo::SequentialWriteFile &file);
 
-        [[nodiscard]] turbo::Status load(turbo::SequentialReadFile &file);
+        // compress the graph while loading, peak memory stays near the compressed size.
+        [[nodiscard]] turbo::Status load(turbo::SequentialReadFile &file, bool compress = false);
+
+    private:
+        // append the level 0 links of node n to _level0, release them if n lives only on level 0
+        void compress_node(LeveledNode &n);
 
     private:
         location_t _max_nbor{0};
-        std::vector<LeveledNode> _nodes;
+        ChunkedArray<LeveledNode> _nodes;
+        bool _compressed{false};
+        CompressedLinks _level0;
     };
 }  // namespace tann
 #endif  // TANN_HNSW_LEVELED_GRAPH_H_
@@ -79,9 +79,26 @@ namespace tann {
 
         void releaseVisitedList(VisitedList *vl) {
             std::unique_lock<std::mutex> lock(poolguard);
+            // list was taken before the pool grown, drop it
+            if (vl->numelements != static_cast<unsigned int>(numelements)) {
+                delete vl;
+                return;
+            }
             pool.push_front(vl);
         }
 
+        // called when the index capacity grows. free lists are
+        // dropped and reallocated lazily with the new size.
+        void reset_num_elements(int numelements1) {
+            std::unique_lock<std::mutex> lock(poolguard);
+            numelements = numelements1;
+            while (pool.size()) {
+                VisitedList *rez = pool.front();
+                pool.pop_front();
+                delete rez;
+            }
+        }
+
         ~VisitedListPool() {
             while (pool.size()) {
                 VisitedList *rez = pool.front();
@@ -0,0 +1,62 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TANN_STORE_LABEL_MAP_H_
+#define TANN_STORE_LABEL_MAP_H_
+
+#include <memory>
+#include <shared_mutex>
+#include "tann/core/types.h"
+#include "turbo/container/flat_hash_map.h"
+
+namespace tann {
+
+    ///////////////////////////////////////////////////////////
+    // label to location map split into kLabelMapShards shards by
+    // the label hash, each behind its own lock, so writers of
+    // different labels do not serialize on one lock. Hold the
+    // shard mutex across a find and the insert depending on it.
+    class LabelMap {
+    public:
+        static constexpr std::size_t kShards = constants::kLabelMapShards;
+
+        struct alignas(64) Shard {
+            mutable std::shared_mutex mutex;
+            turbo::flat_hash_map<label_type, location_t> map;
+        };
+
+        LabelMap() : _shards(new Shard[kShards]) {}
+
+        Shard &shard(label_type label) {
+            return _shards[shard_index(label)];
+        }
+
+        const Shard &shard(label_type label) const {
+            return _shards[shard_index(label)];
+        }
+
+    private:
+        static_assert((kShards & (kShards - 1)) == 0, "shards must be a power of 2");
+
+        // fibonacci hashing, labels in strides still spread over the shards
+        static std::size_t shard_index(label_type label) {
+            return static_cast<std::size_t>((static_cast<uint64_t>(label) * 0x9E3779B97F4A7C15ULL) >> 32) &
+                   (kShards - 1);
+        }
+
+        std::unique_ptr<Shard[]> _shards;
+    };
+}  // namespace tann
+
+#endif  // TANN_STORE_LABEL_MAP_H_
@@ -16,14 +16,38 @@
 #include "turbo/log/logging.h"
 #include "tann/datasets/bin_vector_io.h"
 #include "tann/common/utility.h"
+#include "tann/distance/popcount_kernels.h"
 #include "turbo/times/stop_watcher.h"
 
 namespace tann {
 
+    namespace {
+        void free_aligned(void *ptr) {
+#ifndef _WINDOWS
+            ::free(ptr);
+#else
+            ::_aligned_free(ptr);
+#endif
+        }
+    }  // namespace
+
+    MemVectorStore::~MemVectorStore() {
+        for (size_t i = 0; i < _replaced.size(); ++i) {
+            free_aligned(_replaced[i].load(std::memory_order_relaxed));
+        }
+    }
+
     turbo::Status MemVectorStore::initialize(VectorSpace *vp, VectorStoreOption op) {
         _vs = vp;
         _option = op;
-        _lid_to_label.resize(_option.max_elements, constants::kUnknownLabel);
+        grow_labels(_option.max_elements);
+        if (_vs->distance_factor->use_norm()) {
+            _norms.resize(_option.max_elements, 0.0f);
+        }
+        if (_option.binary_quantization) {
+            _code_size = (_vs->dimension + 7) / 8;
+            _codes.resize(_option.max_elements * _code_size, 0);
+        }
         reserve_impl(_option.max_elements);
         _is_available = true;
         return turbo::OkStatus();
@@ -31,12 +55,43 @@ namespace tann {
 
     void MemVectorStore::reset_max_elements(uint32_t max_size) {
         TLOG_CHECK(_is_available, "should init be using");
-        std::unique_lock<std::shared_mutex> lm(_meta_lock);
+        std::scoped_lock lm(_append_lock, _vacant_lock);
         TLOG_CHECK(_option.max_elements < max_size);
-        _lid_to_label.resize(max_size, constants::kUnknownLabel);
+        grow_labels(max_size);
+        if (use_norm()) {
+            _norms.resize(max_size, 0.0f);
+        }
+        if (has_codes()) {
+            _codes.resize(max_size * _code_size, 0);
+        }
         _option.max_elements = max_size;
     }
 
+    void MemVectorStore::grow_labels(std::size_t n) {
+        auto old = _lid_to_label.size();
+        if (n <= old) {
+            return;
+        }
+        _lid_to_label.resize(n);
+        for (auto i = old; i < n; ++i) {
+            _lid_to_label[i].store(constants::kUnknownLabel, std::memory_order_relaxed);
+        }
+        _deleted_bits.resize(n);
+        _replaced.resize(n);
+    }
+
+    void MemVectorStore::clear_replaced(location_t i) {
+        auto old = _replaced[i].exchange(nullptr, std::memory_order_acq_rel);
+        if (old) {
+            _replaced_size.fetch_sub(1, std::memory_order_release);
+            _epoch.retire(old, free_aligned);
+        }
+    }
+
+    std::size_t MemVectorStore::max_elements() const {
+        return _option.max_elements;
+    }
+
     const VectorSpace *MemVectorStore::get_vector_space() const {
         TLOG_CHECK(_is_available, "should init be using");
         return _vs;
@@ -60,9 +115,92 @@ namespace tann {
         //std::unique_lock<std::shared_mutex> l(_data_lock);
         TLOG_CHECK(_is_available, "should init be using");
         TLOG_CHECK(i < _current_idx.load(), "vector set size {}, but set the vector {}, overflow!", _current_idx.load(), i);
+        if (_replaced_size.load(std::memory_order_acquire) != 0) {
+            clear_replaced(i);
+        }
         auto bi = i / _option.batch_size;
         auto si = i % _option.batch_size;
         _data[bi].set_vector(si, vector);
+        if (use_norm()) {
+            _norms[i] = _vs->distance_factor->norm(_data[bi].at(si));
+        }
+        if (has_codes()) {
+            encode(_data[bi].at(si), _codes.data() + i * _code_size);
+        }
+    }
+
+    void MemVectorStore::replace_vector(location_t i, turbo::Span<uint8_t> vector) {
+        TLOG_CHECK(_is_available, "should init be using");
+        TLOG_CHECK(i < _current_idx.load(), "vector set size {}, but set the vector {}, overflow!", _current_idx.load(), i);
+        TLOG_CHECK(vector.size() == _vs->vector_byte_size);
+        auto align = Allocator::alignment_bytes;
+        auto tail = replaced_norm_offset();
+        auto bytes = tail + sizeof(float) + _code_size;
+        void *buffer;
+        Allocator::alloc_aligned(&buffer, (bytes + align - 1) / align * align, align);
+        auto p = static_cast<uint8_t *>(buffer);
+        std::memcpy(p, vector.data(), vector.size());
+        turbo::Span<uint8_t> fresh(p, vector.size());
+        // norm and code go with the vector, one exchange publishes all three
+        float norm = use_norm() ? static_cast<float>(_vs->distance_factor->norm(fresh)) : 0.0f;
+        std::memcpy(p + tail, &norm, sizeof(float));
+        if (has_codes()) {
+            encode(fresh, p + tail + sizeof(float));
+        }
+        auto old = _replaced[i].exchange(p, std::memory_order_acq_rel);
+        if (old) {
+            _epoch.retire(old, free_aligned);
+        } else {
+            _replaced_size.fetch_add(1, std::memory_order_release);
+            std::lock_guard<std::mutex> lock(_replaced_lock);
+            _replaced_lids.push_back(i);
+        }
+    }
+
+    void MemVectorStore::fold_replaced() {
+        std::vector<location_t> lids;
+        {
+            std::lock_guard<std::mutex> lock(_replaced_lock);
+            lids.swap(_replaced_lids);
+        }
+        for (auto i: lids) {
+            if (_replaced[i].load(std::memory_order_acquire)) {
+                put_in_place(i, get_ref(i));
+                clear_replaced(i);
+            }
+        }
+        // no reader is left, two rounds pass the epoch of the last retire
+        if (_epoch.pending() != 0) {
+            _epoch.reclaim();
+            _epoch.reclaim();
+        }
+    }
+
+    void MemVectorStore::encode(turbo::Span<uint8_t> vector, uint8_t *code) const {
+        std::memset(code, 0, _code_size);
+        auto set_bits = [&](auto *v) {
+            for (size_t i = 0; i < _vs->dimension; ++i) {
+                if (static_cast<float>(v[i]) > 0.0f) {
+                    code[i >> 3] |= static_cast<uint8_t>(1u << (i & 7));
+                }
+            }
+        };
+        switch (_vs->data_type) {
+            case DataType::DT_FLOAT:
+                set_bits(reinterpret_cast<const float *>(vector.data()));
+                break;
+            case DataType::DT_FLOAT16:
+                set_bits(reinterpret_cast<const float16 *>(vector.data()));
+                break;
+            case DataType::DT_BFLOAT16:
+                set_bits(reinterpret_cast<const bfloat16 *>(vector.data()));
+                break;
+            case DataType::DT_INT8:
+                set_bits(reinterpret_cast<const int8_t *>(vector.data()));
+                break;
+            default:
+                TLOG_CHECK(false, "no sign code for the data type");
+        }
     }
 
 
@@ -74,9 +212,35 @@ namespace tann {
     }
 
     turbo::Span<uint8_t> MemVectorStore::get_vector_internal(location_t i) const {
+        return get_ref(i).vector;
+    }
+
+    MemVectorStore::VectorRef MemVectorStore::get_ref(location_t i) const {
+        if (_replaced_size.load(std::memory_order_acquire) != 0) {
+            auto p = _replaced[i].load(std::memory_order_acquire);
+            if (p) {
+                auto tail = p + replaced_norm_offset();
+                VectorRef ref{turbo::Span<uint8_t>(p, _vs->vector_byte_size), 0.0f, tail + sizeof(float)};
+                std::memcpy(&ref.norm, tail, sizeof(float));
+                return ref;
+            }
+        }
+        auto bi = i / _option.batch_size;
+        auto si = i % _option.batch_size;
+        return VectorRef{_data[bi].at(si), use_norm() ? _norms[i] : 0.0f,
+                         has_codes() ? _codes.data() + i * _code_size : nullptr};
+    }
+
+    void MemVectorStore::put_in_place(location_t i, const VectorRef &ref) {
         auto bi = i / _option.batch_size;
         auto si = i % _option.batch_size;
-        return _data[bi].at(si);
+        _data[bi].set_vector(si, ref.vector);
+        if (use_norm()) {
+            _norms[i] = ref.norm;
+        }
+        if (has_codes()) {
+            std::memcpy(_codes.data() + i * _code_size, ref.code, _code_size);
+        }
     }
 
     void MemVectorStore::copy_vector(location_t i, turbo::Span<uint8_t> &des) const {
@@ -93,9 +257,12 @@ namespace tann {
         TLOG_CHECK(l1 < _current_idx, "overflow");
         TLOG_CHECK(l2 < _current_idx, "overflow");
         //TLOG_INFO("compare {} {}", l1, l2);
-        auto v1 = get_vector_internal(l1);
-        auto v2 = get_vector_internal(l2);
-        return _vs->distance_factor->compare(v1, v2);
+        auto r1 = get_ref(l1);
+        auto r2 = get_ref(l2);
+        if (use_norm()) {
+            return _vs->distance_factor->compare_rank_with_norm(r1.vector, r2.vector, r1.norm, r2.norm);
+        }
+        return _vs->distance_factor->compare_rank(r1.vector, r2.vector);
     }
 
     double MemVectorStore::get_distance(turbo::Span<uint8_t> query, location_t l1) const {
@@ -103,7 +270,28 @@ namespace tann {
         TLOG_CHECK(_is_available, "should init be using");
         TLOG_CHECK(l1 < _current_idx, "should init be using");
         auto v1 = get_vector_internal(l1);
-        return _vs->distance_factor->compare(v1, query);
+        return _vs->distance_factor->compare_rank(v1, query);
+    }
+
+    double MemVectorStore::get_distance(turbo::Span<uint8_t> query, double query_norm, location_t l1) const {
+        TLOG_CHECK(_is_available, "should init be using");
+        TLOG_CHECK(l1 < _current_idx, "should init be using");
+        auto r1 = get_ref(l1);
+        if (use_norm()) {
+            return _vs->distance_factor->compare_rank_with_norm(r1.vector, query, r1.norm, query_norm);
+        }
+        return _vs->distance_factor->compare_rank(r1.vector, query);
+    }
+
+    double MemVectorStore::get_distance_bounded(turbo::Span<uint8_t> query, double query_norm, location_t l1,
+                                                double upper_bound) const {
+        TLOG_CHECK(_is_available, "should init be using");
+        TLOG_CHECK(l1 < _current_idx, "should init be using");
+        auto r1 = get_ref(l1);
+        if (use_norm()) {
+            return _vs->distance_factor->compare_rank_with_norm(r1.vector, query, r1.norm, query_norm);
+        }
+        return _vs->distance_factor->compare_bounded(r1.vector, query, upper_bound);
     }
 
     void MemVectorStore::get_distance(turbo::Span<uint8_t> query, turbo::Span<std::size_t> ls,
@@ -115,14 +303,74 @@ namespace tann {
         }
     }
 
+    double MemVectorStore::get_code_distance(turbo::Span<uint8_t> query_code, location_t l1) const {
+        TLOG_CHECK(l1 < _current_idx, "overflow");
+        return static_cast<double>(kernels::bit_count<kernels::kBitXor>(query_code.data(), get_ref(l1).code,
+                                                                        _code_size));
+    }
+
+    double MemVectorStore::get_query_distance(const WorkSpace *ws, location_t l1) const {
+        if (!ws->query_code.empty()) {
+            return get_code_distance(to_span<uint8_t>(ws->query_code), l1);
+        }
+        return get_distance(ws->query_view, ws->query_norm, l1);
+    }
+
+    double MemVectorStore::get_query_distance_bounded(const WorkSpace *ws, location_t l1, double upper_bound) const {
+        if (!ws->query_code.empty()) {
+            return get_code_distance(to_span<uint8_t>(ws->query_code), l1);
+        }
+        return get_distance_bounded(ws->query_view, ws->query_norm, l1, upper_bound);
+    }
+
+    void MemVectorStore::get_distance(turbo::Span<uint8_t> query, double query_norm, location_t first,
+                                      turbo::Span<double> ds) const {
+        TLOG_CHECK(_is_available, "should init be using");
+        TLOG_CHECK(first + ds.size() <= _current_idx, "overflow");
+        if (use_norm() || _replaced_size.load(std::memory_order_acquire) != 0) {
+            for (size_t i = 0; i < ds.size(); ++i) {
+                ds[i] = get_distance(query, query_norm, first + i);
+            }
+            return;
+        }
+        // the vectors of a batch are back to back
+        size_t done = 0;
+        while (done < ds.size()) {
+            location_t lid = first + done;
+            auto n = std::min<size_t>(ds.size() - done, _option.batch_size - lid % _option.batch_size);
+            auto v = get_vector_internal(lid);
+            _vs->distance_factor->compare_rank_batch(query, v.data(), v.size(), ds.subspan(done, n));
+            done += n;
+        }
+    }
+
+    void MemVectorStore::get_query_distance(const WorkSpace *ws, location_t first, turbo::Span<double> ds) const {
+        if (ws->query_code.empty()) {
+            get_distance(ws->query_view, ws->query_norm, first, ds);
+            return;
+        }
+        TLOG_CHECK(first + ds.size() <= _current_idx, "overflow");
+        // a replaced slot keeps its code in its buffer
+        if (_replaced_size.load(std::memory_order_acquire) != 0) {
+            auto code = to_span<uint8_t>(ws->query_code);
+            for (size_t i = 0; i < ds.size(); ++i) {
+                ds[i] = get_code_distance(code, first + i);
+            }
+            return;
+        }
+        kernels::bit_count_many<kernels::kBitXor>(ws->query_code.data(), _codes.data() + first * _code_size,
+                                                  _code_size, _code_size, ds.size(), ds.data());
+    }
+
     void MemVectorStore::move_vector(location_t from, location_t to) {
         //std::unique_lock<std::shared_mutex> l(_data_lock);
         TLOG_CHECK(_is_available, "should init be using");
         TLOG_CHECK(from < _current_idx, "overflow");
         TLOG_CHECK(to < _current_idx, "overflow");
-        auto vf = get_vector_internal(from);
-        auto vt = get_vector_internal(to);
-        std::memcpy(vt.data(), vf.data(), vf.size());
+        if (_replaced_size.load(std::memory_order_acquire) != 0) {
+            clear_replaced(to);
+        }
+        put_in_place(to, get_ref(from));
     }
 
 
@@ -151,21 +399,20 @@ namespace tann {
     }
 
     turbo::ResultStatus<location_t> MemVectorStore::prefer_add_vector(label_type label) {
-        std::unique_lock<std::shared_mutex> lock(_label_map_lock);
+        auto &shard = _label_map.shard(label);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if (shard.map.find(label) != shard.map.end()) {
+            return turbo::AlreadyExistsError("");
+        }
         //std::unique_lock<std::shared_mutex> ld(_data_lock);
-        std::unique_lock<std::shared_mutex> lm(_meta_lock);
+        std::lock_guard<std::mutex> lm(_append_lock);
         TLOG_CHECK(_is_available, "should init be using");
         if (_current_idx >= _option.max_elements) {
             return turbo::ResourceExhaustedError("no space");
         }
-
-        auto itr = _label_map.find(label);
-        if (itr != _label_map.end()) {
-            return turbo::AlreadyExistsError("");
-        }
         auto lid = _current_idx.load();
-        _label_map[label] = lid;
-        _lid_to_label[lid] = label;
+        shard.map[label] = lid;
+        _lid_to_label[lid].store(label, std::memory_order_release);
         auto new_size = _current_idx + 1;
         resize_impl(new_size);
         _current_idx = new_size;
@@ -173,20 +420,71 @@ namespace tann {
     }
 
     turbo::ResultStatus<location_t> MemVectorStore::remove_vector(label_type label) {
-        std::unique_lock<std::shared_mutex> lock(_meta_lock);
-        std::unique_lock<std::shared_mutex> label_lock(_label_map_lock);
+        auto &shard = _label_map.shard(label);
+        std::unique_lock<std::shared_mutex> label_lock(shard.mutex);
         TLOG_CHECK(_is_available, "should init be using");
-        auto itr = _label_map.find(label);
-        if (itr == _label_map.end()) {
+        auto itr = shard.map.find(label);
+        if (itr == shard.map.end()) {
             return turbo::NotFoundError("delete label not found");
         }
         auto lid = itr->second;
-        _lid_to_label[lid] = constants::kUnknownLabel;
+        // remove takes no update lock, _vacant_lock keeps the label and the
+        // bit away from a grow in reset_max_elements and a save sees them
+        // with the map.
+        std::lock_guard<std::mutex> lock(_vacant_lock);
+        _lid_to_label[lid].store(constants::kUnknownLabel, std::memory_order_release);
+        _deleted_bits.set(lid);
         _deleted_map.add(lid);
-        ++_deleted_size;
+        _deleted_size.fetch_add(1, std::memory_order_release);
         return lid;
     }
 
+    void MemVectorStore::return_vacant(location_t lid, label_type label) {
+        TLOG_CHECK(_is_available, "should init be using");
+        auto &shard = _label_map.shard(label);
+        std::unique_lock<std::shared_mutex> label_lock(shard.mutex);
+        auto itr = shard.map.find(label);
+        if (itr != shard.map.end() && itr->second == lid) {
+            shard.map.erase(itr);
+        }
+        if (_replaced_size.load(std::memory_order_acquire) != 0) {
+            clear_replaced(lid);
+        }
+        std::lock_guard<std::mutex> lock(_vacant_lock);
+        _lid_to_label[lid].store(constants::kUnknownLabel, std::memory_order_release);
+        _deleted_bits.set(lid);
+        _deleted_map.add(lid);
+        _deleted_size.fetch_add(1, std::memory_order_release);
+    }
+
+    void MemVectorStore::drop_appended(location_t first, bool linked) {
+        TLOG_CHECK(_is_available, "should init be using");
+        TLOG_CHECK(first <= _current_idx, "overflow");
+        for (location_t lid = first; lid < _current_idx; ++lid) {
+            auto label = _lid_to_label[lid].load(std::memory_order_acquire);
+            auto &shard = _label_map.shard(label);
+            {
+                std::unique_lock<std::shared_mutex> label_lock(shard.mutex);
+                auto itr = shard.map.find(label);
+                if (itr != shard.map.end() && itr->second == lid) {
+                    shard.map.erase(itr);
+                }
+            }
+            std::lock_guard<std::mutex> lock(_vacant_lock);
+            _lid_to_label[lid].store(constants::kUnknownLabel, std::memory_order_release);
+            if (linked) {
+                // not in _deleted_map, the engine may not have set it up
+                _deleted_bits.set(lid);
+                _deleted_size.fetch_add(1, std::memory_order_release);
+            }
+        }
+        if (!linked) {
+            std::lock_guard<std::mutex> lm(_append_lock);
+            resize_impl(first);
+            _current_idx = first;
+        }
+    }
+
     std::size_t MemVectorStore::size() const {
         TLOG_CHECK(_is_available, "should init be using");
         return _current_idx - _deleted_size;
@@ -315,11 +613,18 @@ namespace tann {
 
     turbo::Status MemVectorStore::load(turbo::SequentialReadFile *file) {
         //std::unique_lock<std::shared_mutex> ld(_data_lock);
-        std::unique_lock<std::shared_mutex> lm(_meta_lock);
+        std::scoped_lock lm(_append_lock, _vacant_lock);
         turbo::StopWatcher watcher("vector set deserialize");
         TLOG_CHECK(_is_available, "should init be using");
         _is_available = false;
         TLOG_INFO("deserialize vector set start");
+        for (size_t i = 0; i < _replaced.size(); ++i) {
+            clear_replaced(i);
+        }
+        {
+            std::lock_guard<std::mutex> lock(_replaced_lock);
+            _replaced_lids.clear();
+        }
         auto r = read_binary_pod(*file, _current_idx);
         if (!r.ok()) {
             return r;
@@ -337,10 +642,30 @@ namespace tann {
         }
         _deleted_map = bluebird::Bitmap::read(bs.data());
         TLOG_INFO("deserialize vector deleted map, size: {}", bs.size());
-        r = read_binary_vector(*file, _lid_to_label);
+        std::vector<label_type> labels;
+        r = read_binary_vector(*file, labels);
         if (!r.ok()) {
             return r;
         }
+        if (labels.size() > _option.max_elements) {
+            _option.max_elements = labels.size();
+        }
+        grow_labels(_option.max_elements);
+        for (size_t i = 0; i < _lid_to_label.size(); ++i) {
+            auto lb = i < labels.size() ? labels[i] : constants::kUnknownLabel;
+            _lid_to_label[i].store(lb, std::memory_order_relaxed);
+            if (i < _current_idx && lb == constants::kUnknownLabel) {
+                _deleted_bits.set(i);
+            } else {
+                _deleted_bits.reset(i);
+            }
+        }
+        if (use_norm()) {
+            _norms.resize(_option.max_elements, 0.0f);
+        }
+        if (has_codes()) {
+            _codes.resize(_option.max_elements * _code_size, 0);
+        }
         tann::SerializeOption rop;
         rop.n_vectors = _current_idx;
         rop.dimension = _vs->dimension;
@@ -362,10 +687,22 @@ namespace tann {
                 return turbo::DataLossError("vector loss");
             }
         }
+        // norms and codes are not saved, the vectors are enough to rebuild them
+        if (use_norm() || has_codes()) {
+            executor()->parallel_for(0, _current_idx, [this](size_t i, size_t) {
+                auto vector = get_vector_internal(i);
+                if (use_norm()) {
+                    _norms[i] = _vs->distance_factor->norm(vector);
+                }
+                if (has_codes()) {
+                    encode(vector, _codes.data() + i * _code_size);
+                }
+            });
+        }
         for (size_t i = 0; i < _current_idx; i++) {
-            auto lb = _lid_to_label[i];
+            auto lb = _lid_to_label[i].load(std::memory_order_relaxed);
             if (lb != constants::kUnknownLabel) {
-                _label_map[lb] = i;
+                _label_map.shard(lb).map[lb] = i;
             }
         }
         _is_available = true;
@@ -375,7 +712,7 @@ namespace tann {
 
     turbo::Status MemVectorStore::save(turbo::SequentialWriteFile *file) {
         //std::unique_lock<std::shared_mutex> ld(_data_lock);
-        std::unique_lock<std::shared_mutex> lm(_meta_lock);
+        std::scoped_lock lm(_append_lock, _vacant_lock);
         turbo::StopWatcher watcher("vector set serialize");
         TLOG_INFO("serialize vector set start");
         auto r = write_binary_pod(*file, _current_idx);
@@ -397,7 +734,11 @@ namespace tann {
             return r;
         }
         TLOG_INFO("serialize location to label");
-        r = write_binary_vector(*file, _lid_to_label);
+        std::vector<label_type> labels(_lid_to_label.size());
+        for (size_t i = 0; i < labels.size(); ++i) {
+            labels[i] = _lid_to_label[i].load(std::memory_order_relaxed);
+        }
+        r = write_binary_vector(*file, labels);
         if (!r.ok()) {
             return r;
         }
@@ -411,8 +752,21 @@ namespace tann {
             return r;
         }
         TLOG_INFO("serialize datasets writer ok");
+        std::vector<uint8_t> patched;
+        auto vsize = _vs->vector_byte_size;
         for (size_t i = 0; i < _data.size(); ++i) {
             auto span = _data[i].to_span();
+            // replaced vectors live out of place, write a patched copy
+            if (_replaced_size.load(std::memory_order_acquire) != 0) {
+                patched.assign(span.begin(), span.end());
+                for (size_t j = 0; j < _data[i].size(); ++j) {
+                    auto p = _replaced[i * _option.batch_size + j].load(std::memory_order_acquire);
+                    if (p) {
+                        std::memcpy(patched.data() + j * vsize, p, vsize);
+                    }
+                }
+                span = turbo::Span<uint8_t>(patched.data(), patched.size());
+            }
             r = writer.write_batch(span, _data[i].size());
             if (!r.ok()) {
                 return r;
@@ -429,28 +783,20 @@ namespace tann {
         TLOG_CHECK(_is_available, "should init be using");
         TLOG_CHECK(loc < _current_idx);
         // this always call after is_deleted, do not need to check
-        //std::shared_lock<std::shared_mutex> lock(_meta_lock);
-        //if(_lid_to_label[loc] == constants::kUnknownLabel) {
-        //    return turbo::NotFoundError("label not exists");
-        //}
-        return _lid_to_label[loc];
+        return _lid_to_label[loc].load(std::memory_order_acquire);
     }
 
     [[nodiscard]] bool MemVectorStore::exists_label(label_type label) const {
         TLOG_CHECK(_is_available, "should init be using");
-        std::shared_lock<std::shared_mutex> lock(_label_map_lock);
-        auto itr = _label_map.find(label);
-        if (itr == _label_map.end()) {
-            return false;
-        }
-        return true;
+        auto &shard = _label_map.shard(label);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        return shard.map.find(label) != shard.map.end();
     }
 
     [[nodiscard]] bool MemVectorStore::is_deleted(location_t loc) const {
-        std::shared_lock<std::shared_mutex> lock(_meta_lock);
         TLOG_CHECK(_is_available, "should init be using");
         TLOG_CHECK(loc < _current_idx, "overflow");
-        return _lid_to_label[loc] == constants::kUnknownLabel;
+        return _deleted_bits.test(loc);
     }
 
 
@@ -459,24 +805,29 @@ namespace tann {
         if (!_option.enable_replace_vacant) {
             return turbo::UnavailableError("config not allow using vacant");
         }
-        location_t lid;
-
-        std::unique_lock<std::shared_mutex> lock(_meta_lock);
-        std::unique_lock<std::shared_mutex> label_lock(_label_map_lock);
-
-        if (_deleted_map.isEmpty()) {
+        // most adds find no vacant, they skip both locks
+        if (_deleted_size.load(std::memory_order_acquire) == 0) {
             return turbo::ResourceExhaustedError("no vacant to use");
         }
-
-        lid = _deleted_map.minimum();
-        auto itr = _label_map.find(label);
-        if (itr != _label_map.end()) {
+        auto &shard = _label_map.shard(label);
+        std::unique_lock<std::shared_mutex> label_lock(shard.mutex);
+        if (shard.map.find(label) != shard.map.end()) {
             return turbo::AlreadyExistsError("label :{} already in store", label);
         }
-        _deleted_map.remove(lid);
-        _lid_to_label[lid] = label;
-        --_deleted_size;
-        _label_map[label] = lid;
+        location_t lid;
+        {
+            std::lock_guard<std::mutex> lock(_vacant_lock);
+            if (_deleted_map.isEmpty()) {
+                return turbo::ResourceExhaustedError("no vacant to use");
+            }
+            lid = _deleted_map.minimum();
+            _deleted_map.remove(lid);
+            _deleted_size.fetch_sub(1, std::memory_order_release);
+            // label first, a reader seeing the bit clear sees the new label
+            _lid_to_label[lid].store(label, std::memory_order_release);
+            _deleted_bits.reset(lid);
+        }
+        shard.map[label] = lid;
         return lid;
     }
 }  // namespace tann
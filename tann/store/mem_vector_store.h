@@ -16,12 +16,18 @@
 #ifndef TANN_MEM_STORE_VECTOR_STORE_H_
 #define TANN_MEM_STORE_VECTOR_STORE_H_
 
+#include <mutex>
 #include <vector>
 #include <string_view>
 #include <shared_mutex>
 #include "tann/core/vector_space.h"
 #include "tann/core/vector_store_option.h"
+#include "tann/core/worker_space.h"
 #include "tann/store/vector_batch.h"
+#include "tann/store/label_map.h"
+#include "tann/common/atomic_bitset.h"
+#include "tann/common/chunked_array.h"
+#include "tann/common/epoch.h"
 #include "turbo/files/sequential_write_file.h"
 #include "turbo/files/sequential_read_file.h"
 #include "bluebird/bits/bitmap.h"
@@ -34,12 +40,17 @@ namespace tann {
     public:
         MemVectorStore() = default;
 
-        ~MemVectorStore() = default;
+        ~MemVectorStore();
 
         turbo::Status initialize(VectorSpace *vp, VectorStoreOption op);
 
         [[nodiscard]] const VectorSpace *get_vector_space() const;
 
+        // the executor of the index, the engines share it
+        [[nodiscard]] Executor *executor() const {
+            return _option.executor ? _option.executor : Executor::default_executor();
+        }
+
         [[nodiscard]] const std::vector<VectorBatch> &vector_batch() const;
 
         [[nodiscard]] std::vector<VectorBatch> &vector_batch();
@@ -48,6 +59,22 @@ namespace tann {
 
         void set_vector(location_t i, turbo::Span<uint8_t> vector);
 
+        //////////////////////////////////////////
+        // write the vector of a reused vacant slot, its norm and code to a
+        // fresh buffer and publish it, readers in an EpochGuard of epoch()
+        // see the old or the new vector with its own norm and code, never
+        // a torn one. the old buffer is freed when they are gone, so it
+        // runs under the shared update lock.
+        void replace_vector(location_t i, turbo::Span<uint8_t> vector);
+
+        // copy the replaced vectors back in place and free the retired
+        // buffers, under the exclusive update lock.
+        void fold_replaced();
+
+        [[nodiscard]] EpochManager *epoch() const {
+            return &_epoch;
+        }
+
         [[nodiscard]] turbo::Span<uint8_t> get_vector(location_t i) const;
 
         void copy_vector(location_t, turbo::Span<uint8_t> &des) const;
@@ -58,13 +85,60 @@ namespace tann {
 
         void reset_max_elements(uint32_t max_size);
 
+        [[nodiscard]] std::size_t max_elements() const;
+
+        // ranking distances, see DistanceBase::compare_rank, the engines compare
+        // them with each other and IndexCore maps them back for the results.
         [[nodiscard]] double get_distance(location_t l1, location_t l2) const;
 
         [[nodiscard]] double get_distance(turbo::Span<uint8_t> vector, location_t l1) const;
 
+        // same as above with the query norm known, see DistanceBase::use_norm.
+        [[nodiscard]] double get_distance(turbo::Span<uint8_t> vector, double vector_norm, location_t l1) const;
+
+        // same as above, may stop early once the distance is greater than
+        // upper_bound, see DistanceBase::compare_bounded.
+        [[nodiscard]] double
+        get_distance_bounded(turbo::Span<uint8_t> vector, double vector_norm, location_t l1, double upper_bound) const;
+
         void get_distance(turbo::Span<uint8_t> vector, turbo::Span<std::size_t> ls,
                           turbo::Span<double> ds) const;
 
+        // the distance the engines search by, the hamming distance of the
+        // codes when ws has a query code, else get_distance above.
+        [[nodiscard]] double get_query_distance(const WorkSpace *ws, location_t l1) const;
+
+        [[nodiscard]] double get_query_distance_bounded(const WorkSpace *ws, location_t l1, double upper_bound) const;
+
+        // sign codes, see IndexOption::binary_quantization.
+        [[nodiscard]] bool has_codes() const {
+            return _code_size != 0;
+        }
+
+        [[nodiscard]] std::size_t code_size() const {
+            return _code_size;
+        }
+
+        // write the code of vector to code, code holds code_size() bytes.
+        void encode(turbo::Span<uint8_t> vector, uint8_t *code) const;
+
+        [[nodiscard]] double get_code_distance(turbo::Span<uint8_t> query_code, location_t l1) const;
+
+        // distances of the vectors first .. first + ds.size() - 1 to the query,
+        // batched by DistanceBase::compare_rank_batch.
+        void get_distance(turbo::Span<uint8_t> vector, double vector_norm, location_t first,
+                          turbo::Span<double> ds) const;
+
+        // get_query_distance of the locations first .. first + ds.size() - 1,
+        // the query stays in registers while the codes or vectors stream.
+        void get_query_distance(const WorkSpace *ws, location_t first, turbo::Span<double> ds) const;
+
+        // the query distance of ws has a one vs many kernel and no bounded
+        // one, a scan over the locations should use the range above.
+        [[nodiscard]] bool has_batch_distance(const WorkSpace *ws) const {
+            return !ws->query_code.empty() || _vs->metric_type == METRIC_HAMMING;
+        }
+
         turbo::ResultStatus<location_t> add_vector(label_type label, const turbo::Span<uint8_t> &vector);
 
         turbo::ResultStatus<location_t> prefer_add_vector(label_type label);
@@ -89,6 +163,16 @@ namespace tann {
 
         [[nodiscard]] turbo::ResultStatus<location_t> get_vacant(label_type label);
 
+        // undo get_vacant, lid is deleted again and label is unknown, under
+        // the label lock and the shared update lock.
+        void return_vacant(location_t lid, label_type label);
+
+        // undo the prefer_add_vector calls that appended from lid first on,
+        // under the exclusive update lock. the labels are released, the
+        // slots are dropped from the tail when nothing links to them, else
+        // they stay deleted and are never handed out as vacant.
+        void drop_appended(location_t first, bool linked);
+
         turbo::Status load(std::string_view path);
 
         turbo::Status save(std::string_view path);
@@ -121,34 +205,90 @@ namespace tann {
 
         void reserve_impl(std::size_t n);
 
+        // grow _lid_to_label, _deleted_bits and _replaced to n locations
+        void grow_labels(std::size_t n);
+
+        // drop the replaced buffer of i, readers in an epoch keep it until
+        // they leave
+        void clear_replaced(location_t i);
+
         turbo::Span<uint8_t> get_vector_internal(location_t i) const;
 
+        // the vector of a location with its norm and code, from one load of
+        // _replaced so the three always belong to the same vector.
+        struct VectorRef {
+            turbo::Span<uint8_t> vector;
+            float norm;
+            const uint8_t *code;
+        };
+
+        [[nodiscard]] VectorRef get_ref(location_t i) const;
+
+        // copy ref to the in place vector, norm and code of i
+        void put_in_place(location_t i, const VectorRef &ref);
+
+        // a replaced buffer is [vector][float norm][code]
+        [[nodiscard]] std::size_t replaced_norm_offset() const {
+            return (_vs->vector_byte_size + alignof(float) - 1) / alignof(float) * alignof(float);
+        }
+
+        [[nodiscard]] bool use_norm() const {
+            return !_norms.empty();
+        }
+
     private:
         VectorSpace *_vs{nullptr};
         bool _is_available{false};
         VectorStoreOption _option;
-        // guard by _data_lock
+        // grows under _append_lock
         std::atomic<std::size_t> _current_idx{0};
-        // guard by _meta_lock
+        // changed with _deleted_map under _vacant_lock, read without
+        // locks, 0 lets an add skip the vacant lookup.
         std::atomic<std::size_t> _deleted_size{0};
 
-        mutable std::shared_mutex _meta_lock;
-        // guard by _meta_lock
+        // the two writers of the locations, each held for a few stores:
+        // _append_lock grows _current_idx and the batches, _vacant_lock
+        // owns _deleted_map. Taken after the label shard mutex, save,
+        // load and reset_max_elements take both.
+        std::mutex _append_lock;
+        std::mutex _vacant_lock;
+        // guard by _vacant_lock, picks the vacant and is saved
         bluebird::Bitmap _deleted_map;
+        // the same bits for is_deleted, written with _deleted_map under
+        // _vacant_lock, read without locks.
+        AtomicBitset _deleted_bits;
 
         // guard for labels option. this may multi
         // function span, so user should use LabelLockGuard/LabelSharedLockGuard
         // lock it outsize this scope
         turbo::HashLock<label_type> _label_op_lock;
-        // guard by _meta_lock
-        std::vector<label_type> _lid_to_label;
-        mutable std::shared_mutex _label_map_lock;  // lock for _label_map_lock
-        // guard by _label_map_lock
-        turbo::flat_hash_map<label_type, location_t> _label_map;
+        // set by an append under _append_lock, by a delete or reuse under
+        // _vacant_lock, read without locks. a grow takes both locks, the
+        // chunk table may move but the chunks do not, so a label load
+        // needs no seqlock. kUnknownLabel is deleted.
+        ChunkedArray<std::atomic<label_type>> _lid_to_label;
+        // guard by the shard mutex of the label
+        LabelMap _label_map;
         //
         mutable std::shared_mutex _data_lock;
         // guard by _data_lock
         std::vector<VectorBatch> _data;
+        // l2 norm of each vector, only for metrics that use_norm, set with
+        // the vector and rebuilt on load. guard by _data_lock
+        std::vector<float> _norms;
+        // sign code of each vector, code_size() bytes each, kept like _norms.
+        std::size_t _code_size{0};
+        std::vector<uint8_t> _codes;
+        // vector, norm and code of a slot set by replace_vector, nullptr is
+        // the ones in _data, _norms and _codes. _replaced_size counts them
+        // so the common case is one load.
+        ChunkedArray<std::atomic<uint8_t *>> _replaced;
+        std::atomic<std::size_t> _replaced_size{0};
+        // the locations replaced since the last fold, fold_replaced only
+        // visits them. a location cleared in between is skipped.
+        std::mutex _replaced_lock;
+        std::vector<location_t> _replaced_lids;
+        mutable EpochManager _epoch;
     };
 
     class UpdateLockGuard {
@@ -0,0 +1,71 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "doctest/doctest.h"
+#include "tann/common/executor.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("executor parallel for") {
+    tann::ExecutorOption option;
+    option.threads = 4;
+    tann::Executor executor(option);
+    CHECK_EQ(executor.size(), 4);
+    CHECK_EQ(executor.current_worker(), 4);
+    std::vector<int> hits(10000, 0);
+    std::atomic<bool> bad_tid{false};
+    executor.parallel_for(0, hits.size(), [&](size_t i, size_t tid) {
+        if (tid >= executor.loop_concurrency(hits.size())) {
+            bad_tid = true;
+        }
+        ++hits[i];
+    });
+    CHECK_FALSE(bad_tid.load());
+    for (auto h: hits) {
+        REQUIRE_EQ(h, 1);
+    }
+}
+
+TEST_CASE("executor nested loops and errors") {
+    tann::ExecutorOption option;
+    option.threads = 3;
+    tann::Executor executor(option);
+    std::atomic<size_t> sum{0};
+    executor.parallel_for(0, 32, [&](size_t, size_t) {
+        executor.parallel_for(0, 100, [&](size_t j, size_t) {
+            sum += j;
+        });
+    });
+    CHECK_EQ(sum.load(), 32 * 4950);
+    CHECK_THROWS_AS(executor.parallel_for(0, 1000, [](size_t i, size_t) {
+        if (i == 500) {
+            throw std::runtime_error("stop");
+        }
+    }), std::runtime_error);
+    std::atomic<size_t> done{0};
+    std::atomic<bool> bad_tid{false};
+    executor.parallel_for(0, 1000, [&](size_t, size_t tid) {
+        if (tid >= 2) {
+            bad_tid = true;
+        }
+        ++done;
+    }, 2);
+    CHECK_EQ(done.load(), 1000);
+    CHECK_FALSE(bad_tid.load());
+    CHECK_EQ(executor.loop_concurrency(1000, 2), 2);
+    CHECK_EQ(executor.loop_concurrency(2), 2);
+    CHECK_EQ(executor.loop_concurrency(0), 1);
+}
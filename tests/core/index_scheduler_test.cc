@@ -0,0 +1,230 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "doctest/doctest.h"
+#include "tann/core/index_scheduler.h"
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr std::size_t kDim = 16;
+
+    struct SchedulerFixture {
+        SchedulerFixture() {
+            std::mt19937 rng(47);
+            std::uniform_real_distribution<float> distrib;
+            data.resize(n * kDim);
+            for (auto &v: data) {
+                v = distrib(rng);
+            }
+            option.data_type = tann::DataType::DT_FLOAT;
+            option.dimension = kDim;
+            option.metric = tann::METRIC_L2;
+            option.engine_type = tann::EngineType::ENGINE_FLAT;
+            REQUIRE(index.initialize(option, {}).ok());
+        }
+
+        turbo::Span<uint8_t> vector(std::size_t i) {
+            return turbo::Span<uint8_t>(reinterpret_cast<uint8_t *>(data.data() + i * kDim), kDim * sizeof(float));
+        }
+
+        std::size_t n{1000};
+        std::vector<float> data;
+        tann::IndexOption option;
+        tann::IndexCore index;
+        tann::WriteOption wop;
+    };
+
+    // holds the search that calls it until released
+    class BlockingFilter : public tann::BaseFilterFunctor {
+    public:
+        bool operator()(tann::label_type) override {
+            entered = true;
+            while (!released) {
+                std::this_thread::yield();
+            }
+            return true;
+        }
+
+        std::atomic<bool> entered{false};
+        std::atomic<bool> released{false};
+    };
+}  // namespace
+
+TEST_CASE_FIXTURE(SchedulerFixture, "scheduler pass through") {
+    tann::IndexScheduler scheduler;
+    REQUIRE(scheduler.initialize(&index, tann::SchedulerOption()).ok());
+    for (std::size_t i = 0; i < n; ++i) {
+        REQUIRE(scheduler.add_vector(wop, vector(i), i).ok());
+    }
+    CHECK_EQ(index.size(), n);
+    tann::SearchContext sc(vector(7));
+    sc.k = 1;
+    tann::SearchResult result;
+    REQUIRE(scheduler.search_vector(&sc, result).ok());
+    REQUIRE_EQ(result.results.size(), 1);
+    CHECK_EQ(result.results[0].second, 7);
+    CHECK(scheduler.remove_vector(7).ok());
+    CHECK_EQ(index.remove_size(), 1);
+}
+
+TEST_CASE_FIXTURE(SchedulerFixture, "scheduler sheds searches") {
+    for (std::size_t i = 0; i < n; ++i) {
+        REQUIRE(index.add_vector(wop, vector(i), i).ok());
+    }
+    tann::SchedulerOption sop;
+    sop.max_searches = 1;
+    sop.max_queued_searches = 1;
+    tann::IndexScheduler scheduler;
+    REQUIRE(scheduler.initialize(&index, sop).ok());
+    std::atomic<std::size_t> done{0};
+    std::atomic<std::size_t> shed{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 50; ++i) {
+                tann::SearchContext sc(vector(t * 50 + i));
+                sc.k = 10;
+                tann::SearchResult result;
+                auto r = scheduler.search_vector(&sc, result);
+                if (r.ok()) {
+                    CHECK_EQ(result.results.size(), 10);
+                    ++done;
+                } else {
+                    CHECK(turbo::IsResourceExhausted(r));
+                    ++shed;
+                }
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    CHECK_EQ(done + shed, 400);
+    CHECK_GT(done, 0);
+    CHECK_EQ(scheduler.shed_searches(), shed);
+}
+
+TEST_CASE_FIXTURE(SchedulerFixture, "scheduler write rate") {
+    // a refill of one vector takes 1000 seconds, the test never sees one
+    tann::SchedulerOption sop;
+    sop.write_rate = 0.001;
+    sop.write_burst = 10;
+    sop.max_queued_writes = 0;
+    tann::IndexScheduler scheduler;
+    REQUIRE(scheduler.initialize(&index, sop).ok());
+    std::vector<tann::label_type> labels(15);
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+        labels[i] = i;
+    }
+    auto batch = [&](std::size_t first, std::size_t count) {
+        auto bytes = kDim * sizeof(float);
+        return scheduler.add_vectors(wop, turbo::Span<uint8_t>(vector(first).data(), count * bytes),
+                                     turbo::Span<tann::label_type>(labels.data() + first, count));
+    };
+    REQUIRE(batch(0, 5).ok());
+    // the bucket is not empty, the batch goes and takes it below zero
+    REQUIRE(batch(5, 10).ok());
+    auto r = scheduler.add_vector(wop, vector(15), 15);
+    CHECK(turbo::IsResourceExhausted(r.status()));
+    CHECK_EQ(scheduler.shed_writes(), 1);
+    CHECK_EQ(index.size(), 15);
+}
+
+TEST_CASE_FIXTURE(SchedulerFixture, "scheduler searches first") {
+    for (std::size_t i = 0; i < n; ++i) {
+        REQUIRE(index.add_vector(wop, vector(i), i).ok());
+    }
+    tann::SchedulerOption sop;
+    sop.max_searches = 2;
+    sop.max_write_delay_ns = 5 * 1000 * 1000;
+    tann::IndexScheduler scheduler;
+    REQUIRE(scheduler.initialize(&index, sop).ok());
+    std::atomic<bool> stop{false};
+    std::atomic<std::size_t> searches{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            while (!stop) {
+                tann::SearchContext sc(vector(t));
+                sc.k = 10;
+                tann::SearchResult result;
+                if (scheduler.search_vector(&sc, result).ok()) {
+                    ++searches;
+                }
+            }
+        });
+    }
+    // writes keep going behind the queued searches, bounded by the delay
+    for (std::size_t i = n; i < n + 20; ++i) {
+        REQUIRE(scheduler.add_vector(wop, vector(i - n), i).ok());
+    }
+    stop = true;
+    for (auto &t: threads) {
+        t.join();
+    }
+    CHECK_EQ(index.size(), n + 20);
+    CHECK_GT(searches, 0);
+}
+
+TEST_CASE_FIXTURE(SchedulerFixture, "scheduler writes first") {
+    for (std::size_t i = 0; i < n; ++i) {
+        REQUIRE(index.add_vector(wop, vector(i), i).ok());
+    }
+    tann::SchedulerOption sop;
+    sop.max_searches = 2;
+    sop.priority = tann::SchedulePriority::kWriteFirst;
+    tann::IndexScheduler scheduler;
+    REQUIRE(scheduler.initialize(&index, sop).ok());
+    // a running search keeps the first write on the update lock, the
+    // second write waits in the queue
+    BlockingFilter blocking;
+    std::thread search([&]() {
+        tann::SearchContext sc(vector(0));
+        sc.k = 1;
+        sc.is_allowed = &blocking;
+        tann::SearchResult result;
+        CHECK(scheduler.search_vector(&sc, result).ok());
+    });
+    while (!blocking.entered) {
+        std::this_thread::yield();
+    }
+    std::vector<std::thread> writes;
+    for (std::size_t i = 0; i < 2; ++i) {
+        writes.emplace_back([&, i]() {
+            CHECK(scheduler.add_vector(wop, vector(i), n + i).ok());
+        });
+    }
+    while (scheduler.queued_writes() != 1) {
+        std::this_thread::yield();
+    }
+    // a search slot is free, the queued write holds it back
+    tann::SearchContext sc(vector(1));
+    sc.k = 1;
+    sc.timeout_ns = 10 * 1000 * 1000;
+    tann::SearchResult result;
+    auto r = scheduler.search_vector(&sc, result);
+    CHECK(turbo::IsDeadlineExceeded(r));
+    CHECK_EQ(scheduler.shed_searches(), 1);
+    blocking.released = true;
+    search.join();
+    for (auto &t: writes) {
+        t.join();
+    }
+    CHECK_EQ(index.size(), n + 2);
+    CHECK_EQ(scheduler.queued_writes(), 0);
+}
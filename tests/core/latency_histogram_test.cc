@@ -0,0 +1,63 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "doctest/doctest.h"
+#include "tann/common/latency_histogram.h"
+#include <thread>
+#include <vector>
+
+using tann::LatencyHistogram;
+
+TEST_CASE("latency histogram buckets") {
+    for (uint64_t v = 0; v < 1000000; v += v < 10000 ? 1 : 97) {
+        auto b = LatencyHistogram::bucket_of(v);
+        CHECK_LE(v, LatencyHistogram::bucket_upper(b));
+        if (b > 0) {
+            CHECK_GT(v, LatencyHistogram::bucket_upper(b - 1));
+        }
+    }
+    // within 1/16 of the value
+    for (uint64_t v = 16; v < (uint64_t(1) << 40); v = v * 3 + 1) {
+        auto upper = LatencyHistogram::bucket_upper(LatencyHistogram::bucket_of(v));
+        CHECK_LE(upper - v, v / 16);
+    }
+    CHECK_EQ(LatencyHistogram::bucket_of(UINT64_MAX), LatencyHistogram::kBuckets - 1);
+}
+
+TEST_CASE("latency histogram percentile") {
+    static LatencyHistogram h;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([]() {
+            for (int i = 1; i <= 1000; ++i) {
+                h.record(i * 1000);
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    auto snap = h.snapshot();
+    CHECK_EQ(snap.count, 8000);
+    CHECK_EQ(snap.max, 1000000);
+    CHECK_EQ(snap.mean(), doctest::Approx(500500));
+    CHECK_GE(snap.percentile(0.5), 500000);
+    CHECK_LE(snap.percentile(0.5), 500000 + 500000 / 16);
+    CHECK_EQ(snap.percentile(1.0), 1000000);
+    h.reset();
+    snap = h.snapshot();
+    CHECK_EQ(snap.count, 0);
+    CHECK_EQ(snap.percentile(0.99), 0);
+}
@@ -0,0 +1,136 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "doctest/doctest.h"
+#include "../hnsw/hnsw_test_fixture.h"
+#include <vector>
+
+// statistics, latency and trace of the searches, on the hnsw and the
+// flat index of the filter fixture.
+namespace {
+
+    class EvenLabels : public tann::BaseFilterFunctor {
+    public:
+        bool operator()(tann::label_type label) override {
+            return label % 2 == 0;
+        }
+    };
+
+    TEST_CASE_FIXTURE(HnswIndexFilterFixture, "search statistics") {
+        fill(findex);
+        fill(hindex);
+        CHECK_EQ(hindex.remove_vector(0).ok(), true);
+
+        for (size_t j = 0; j < nq; ++j) {
+            auto *p = reinterpret_cast<uint8_t *>(query.data() + j * d);
+            tann::SearchContext query_h(turbo::Span<uint8_t>(p, d * sizeof(float)));
+            query_h.k = k;
+            tann::SearchContext query_f(turbo::Span<uint8_t>(p, d * sizeof(float)));
+            query_f.k = k;
+            tann::SearchResult result_h;
+            tann::SearchResult result_f;
+            CHECK_EQ(hindex.search_vector(&query_h, result_h).ok(), true);
+            CHECK_EQ(findex.search_vector(&query_f, result_f).ok(), true);
+        }
+
+        auto hs = hindex.statistics();
+        CHECK_EQ(hs.inserts, n);
+        CHECK_EQ(hs.deletes, 1);
+        CHECK_EQ(hs.searches, nq);
+        CHECK_EQ(hs.truncated_searches, 0);
+        CHECK_GE(hs.hops, nq);
+        CHECK_GE(hs.distance_computations, hs.hops);
+        // the flat engine scans every vector
+        auto fs = findex.statistics();
+        CHECK_EQ(fs.inserts, n);
+        CHECK_EQ(fs.searches, nq);
+        CHECK_EQ(fs.hops, 0);
+        CHECK_EQ(fs.distance_computations, n * nq);
+
+        // the phases add up to the whole search
+        auto total = hindex.latency(tann::LatencyPhase::kSearch);
+        CHECK_EQ(total.count, nq);
+        uint64_t phases = 0;
+        for (auto phase: {tann::LatencyPhase::kSearchPreprocess, tann::LatencyPhase::kSearchLockWait,
+                          tann::LatencyPhase::kSearchDescent, tann::LatencyPhase::kSearchBase,
+                          tann::LatencyPhase::kSearchMaterialize}) {
+            auto snap = hindex.latency(phase);
+            CHECK_EQ(snap.count, nq);
+            phases += snap.sum;
+        }
+        CHECK_EQ(phases, total.sum);
+        CHECK_GT(hindex.latency(tann::LatencyPhase::kSearchBase).sum, 0);
+        CHECK_EQ(hindex.latency(tann::LatencyPhase::kInsert).count, n);
+        hindex.reset_latency();
+        CHECK_EQ(hindex.latency(tann::LatencyPhase::kSearch).count, 0);
+    }
+
+    TEST_CASE_FIXTURE(HnswIndexFilterFixture, "search trace") {
+        fill(findex);
+        fill(hindex);
+        CHECK_EQ(hindex.remove_vector(0).ok(), true);
+        CHECK_EQ(findex.remove_vector(0).ok(), true);
+
+        EvenLabels even;
+        tann::SearchTrace trace;
+        for (size_t j = 0; j < nq; ++j) {
+            auto *p = reinterpret_cast<uint8_t *>(query.data() + j * d);
+            tann::SearchContext query_h(turbo::Span<uint8_t>(p, d * sizeof(float)));
+            query_h.k = k;
+            query_h.is_allowed = &even;
+            query_h.trace = &trace;
+            tann::SearchResult result_h;
+            CHECK_EQ(hindex.search_vector(&query_h, result_h).ok(), true);
+            CHECK_NE(trace.entry_point, tann::constants::kUnknownLocation);
+            REQUIRE_GE(trace.hops.size(), 1);
+            CHECK_GT(trace.hops[0], 0);
+            CHECK_GT(trace.filter_rejections, 0);
+            CHECK_FALSE(trace.visits.empty());
+            // the results are visited with the same distance
+            for (auto &r: result_h.results) {
+                bool seen = false;
+                for (auto &v: trace.visits) {
+                    if (v.level == 0 && v.queued && v.distance == doctest::Approx(r.first)) {
+                        seen = true;
+                        break;
+                    }
+                }
+                CHECK(seen);
+            }
+            auto total = trace.phase_ns[static_cast<size_t>(tann::LatencyPhase::kSearch)];
+            CHECK_EQ(total, result_h.cost_ns);
+            auto json = trace.to_json();
+            CHECK_EQ(json.front(), '{');
+            CHECK_NE(json.find("\"lock_wait\":"), std::string::npos);
+            CHECK_NE(json.find("\"bounded\":"), std::string::npos);
+            auto chrome = trace.to_chrome_trace();
+            CHECK_NE(chrome.find("traceEvents"), std::string::npos);
+            CHECK_NE(chrome.find("\"name\":\"descent\""), std::string::npos);
+
+            // the flat scan visits every vector
+            tann::SearchContext query_f(turbo::Span<uint8_t>(p, d * sizeof(float)));
+            query_f.k = k;
+            query_f.is_allowed = &even;
+            query_f.trace = &trace;
+            tann::SearchResult result_f;
+            CHECK_EQ(findex.search_vector(&query_f, result_f).ok(), true);
+            CHECK_EQ(trace.deleted_skips, 1);
+            CHECK_EQ(trace.filter_rejections, n / 2);
+            CHECK_EQ(trace.visits.size(), n / 2 - 1);
+            CHECK(trace.hops.empty());
+        }
+    }
+
+}  // namespace
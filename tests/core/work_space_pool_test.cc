@@ -0,0 +1,71 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "doctest/doctest.h"
+#include "tann/core/work_space_pool.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct TestWorkSpace : public tann::WorkSpace {
+        int users{0};
+    protected:
+        void clear_sub() override {}
+    };
+}  // namespace
+
+TEST_CASE("work space pool grows to max size") {
+    tann::WorkSpacePool pool;
+    REQUIRE(pool.initialize([]() { return new TestWorkSpace(); }, 1, 3).ok());
+    CHECK_EQ(pool.size(), 1);
+    auto a = pool.acquire();
+    auto b = pool.acquire();
+    auto c = pool.acquire();
+    CHECK_EQ(pool.size(), 3);
+    CHECK_NE(a, b);
+    CHECK_NE(b, c);
+    CHECK_NE(a, c);
+    pool.release(b);
+    CHECK_EQ(pool.acquire(), b);
+    pool.release(a);
+    pool.release(b);
+    pool.release(c);
+    CHECK_EQ(pool.size(), 3);
+}
+
+TEST_CASE("work space pool waiters") {
+    tann::WorkSpacePool pool;
+    REQUIRE(pool.initialize([]() { return new TestWorkSpace(); }, 1, 4).ok());
+    std::atomic<bool> shared{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 32; ++t) {
+        threads.emplace_back([&pool, &shared]() {
+            for (int i = 0; i < 1000; ++i) {
+                tann::WorkSpaceGuard guard(pool);
+                auto ws = static_cast<TestWorkSpace *>(guard.work_space());
+                if (++ws->users != 1) {
+                    shared = true;
+                }
+                --ws->users;
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    CHECK_FALSE(shared.load());
+    CHECK_LE(pool.size(), 4);
+}
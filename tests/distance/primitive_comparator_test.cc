@@ -19,6 +19,10 @@
 #include "doctest/doctest.h"
 #include "tann/distance/utility.h"
 #include "tann/distance/primitive_distance.h"
+#include "tann/distance/distance_factory.h"
+#include <cmath>
+#include <memory>
+#include <numeric>
 #include <vector>
 #include "turbo/format/print.h"
 #include "test_util.h"
@@ -78,6 +82,193 @@ TEST_CASE_TEMPLATE("l2 distance", T, TEST_TYPES) {
 
 }
 
+TEST_CASE_TEMPLATE("l2 squared distance", T, TEST_TYPES) {
+    tann::AlignedQuery<T> a;
+    tann::AlignedQuery<T> b;
+    a.reserve(128);
+    b.reserve(128);
+    for (int i = 0; i < 128; i++) {
+        a.emplace_back(i % 20);
+        b.emplace_back((128 - i) % 10);
+    }
+    auto ax = tann::to_span<T>(a);
+    auto bx = tann::to_span<T>(b);
+    float n1 = tann::PrimComparator::compare_l2_sqr(ax, bx);
+    auto n2 = tann::PrimComparator::compare_l2(ax, bx);
+    // 95.163^2, exact for these small integers
+    CHECK_EQ(n1, 9056.0f);
+    CHECK_LT(fabs(sqrt(n1) - n2), 0.001);
+}
+
+TEST_CASE_TEMPLATE("8 bit integer kernels", T, uint8_t, int8_t) {
+    for (int n: {7, 16, 33, 100, 960}) {
+        tann::AlignedQuery<T> a;
+        tann::AlignedQuery<T> b;
+        for (int i = 0; i < n; i++) {
+            a.emplace_back(static_cast<T>(i * 37 + 11));
+            b.emplace_back(static_cast<T>(i * 91 + 5));
+        }
+        int64_t l1 = 0;
+        int64_t l2 = 0;
+        int64_t ip = 0;
+        for (int i = 0; i < n; i++) {
+            int x = a[i];
+            int y = b[i];
+            l1 += std::abs(x - y);
+            l2 += (x - y) * (x - y);
+            ip += x * y;
+        }
+        auto ax = tann::to_span<T>(a);
+        auto bx = tann::to_span<T>(b);
+        CHECK_EQ(tann::PrimComparator::compare_l1(ax, bx), static_cast<double>(l1));
+        CHECK_EQ(tann::PrimComparator::compare_l2_sqr(ax, bx), static_cast<float>(l2));
+        CHECK_EQ(tann::PrimComparator::compare_inner_product(ax, bx), static_cast<double>(ip));
+    }
+}
+
+TEST_CASE_TEMPLATE("16 bit float kernels", T, tann::float16, tann::bfloat16) {
+    for (int n: {3, 16, 33, 100}) {
+        tann::AlignedQuery<T> a;
+        tann::AlignedQuery<T> b;
+        for (int i = 0; i < n; i++) {
+            a.emplace_back(static_cast<float>(i % 20) / 8);
+            b.emplace_back(static_cast<float>((128 - i) % 10) / 8);
+        }
+        auto ax = tann::to_span<T>(a);
+        auto bx = tann::to_span<T>(b);
+        auto l2 = tann::PrimComparator::simple_compare_l2<T, double>(ax, bx);
+        CHECK_LT(fabs(sqrt(tann::PrimComparator::compare_l2_sqr(ax, bx)) - l2), 0.001);
+        CHECK_LT(fabs(tann::PrimComparator::compare_l1(ax, bx) -
+                      tann::PrimComparator::simple_compare_l1<T, double>(ax, bx)), 0.001);
+        CHECK_LT(fabs(tann::PrimComparator::compare_inner_product(ax, bx) -
+                      tann::PrimComparator::simple_compare_inner_product(ax, bx)), 0.001);
+        CHECK_LT(fabs(tann::PrimComparator::compare_cosine(ax, bx) -
+                      tann::PrimComparator::simple_compare_cosine(ax, bx)), 0.001);
+    }
+}
+
+TEST_CASE("fixed dimension kernels") {
+    for (size_t dim: {96, 128, 768, 960}) {
+        tann::AlignedQuery<float> a;
+        tann::AlignedQuery<float> b;
+        for (size_t i = 0; i < dim; i++) {
+            a.emplace_back(static_cast<float>(i % 20) / 16);
+            b.emplace_back(static_cast<float>((128 - i) % 10) / 16);
+        }
+        turbo::Span<uint8_t> au(reinterpret_cast<uint8_t *>(a.data()), dim * sizeof(float));
+        turbo::Span<uint8_t> bu(reinterpret_cast<uint8_t *>(b.data()), dim * sizeof(float));
+        for (auto m: {tann::METRIC_L2, tann::METRIC_IP}) {
+            std::unique_ptr<tann::DistanceBase> generic(tann::create_distance_native(m, tann::DataType::DT_FLOAT).value());
+            std::unique_ptr<tann::DistanceBase> fixed(tann::create_distance_native(m, tann::DataType::DT_FLOAT, dim).value());
+            CHECK_LT(fabs(generic->compare(au, bu) - fixed->compare(au, bu)), 0.001);
+            CHECK_LT(fabs(generic->compare_rank(au, bu) - fixed->compare_rank(au, bu)), 0.01);
+        }
+    }
+}
+
+TEST_CASE("bounded distance") {
+    for (size_t dim: {100, 960}) {
+        tann::AlignedQuery<float> a;
+        tann::AlignedQuery<float> b;
+        for (size_t i = 0; i < dim; i++) {
+            a.emplace_back(static_cast<float>(i % 20) / 16);
+            b.emplace_back(static_cast<float>((128 - i) % 10) / 16);
+        }
+        turbo::Span<uint8_t> au(reinterpret_cast<uint8_t *>(a.data()), dim * sizeof(float));
+        turbo::Span<uint8_t> bu(reinterpret_cast<uint8_t *>(b.data()), dim * sizeof(float));
+        for (auto m: {tann::METRIC_L1, tann::METRIC_L2}) {
+            for (size_t fixed_dim: {size_t(0), dim}) {
+                std::unique_ptr<tann::DistanceBase> d(
+                        tann::create_distance_native(m, tann::DataType::DT_FLOAT, fixed_dim).value());
+                auto exact = d->compare_rank(au, bu);
+                // a bound above the distance gives the exact value
+                CHECK_LT(fabs(d->compare_bounded(au, bu, exact * 2) - exact), 0.01);
+                // a bound below it gives any value past the bound
+                CHECK_GT(d->compare_bounded(au, bu, exact / 4), exact / 4);
+            }
+        }
+    }
+}
+
+TEST_CASE("hyperbolic ranks") {
+    const size_t dim = 100;
+    tann::AlignedQuery<float> a;
+    tann::AlignedQuery<float> b;
+    for (size_t i = 0; i < dim; i++) {
+        a.emplace_back(static_cast<float>(i % 20) / 400);
+        b.emplace_back(static_cast<float>((128 - i) % 10) / 300);
+    }
+    turbo::Span<uint8_t> au(reinterpret_cast<uint8_t *>(a.data()), dim * sizeof(float));
+    turbo::Span<uint8_t> bu(reinterpret_cast<uint8_t *>(b.data()), dim * sizeof(float));
+    std::unique_ptr<tann::DistanceBase> poincare(
+            tann::create_distance_native(tann::METRIC_POINCARE, tann::DataType::DT_FLOAT).value());
+    auto rank = poincare->compare_rank(au, bu);
+    CHECK_LT(fabs(poincare->rank_to_distance(rank) - poincare->compare(au, bu)), 0.0001);
+    REQUIRE(poincare->use_norm());
+    auto with_norm = poincare->compare_rank_with_norm(au, bu, poincare->norm(au), poincare->norm(bu));
+    CHECK_LT(fabs(with_norm - rank), 0.0001);
+
+    // points on the hyperboloid, x0 = sqrt(1 + |x|^2)
+    a[0] = 0.0f;
+    b[0] = 0.0f;
+    a[0] = std::sqrt(1.0f + std::inner_product(a.begin(), a.end(), a.begin(), 0.0f));
+    b[0] = std::sqrt(1.0f + std::inner_product(b.begin(), b.end(), b.begin(), 0.0f));
+    std::unique_ptr<tann::DistanceBase> lorentz(
+            tann::create_distance_native(tann::METRIC_LORENTZ, tann::DataType::DT_FLOAT).value());
+    rank = lorentz->compare_rank(au, bu);
+    CHECK_GE(rank, 1.0);
+    CHECK_LT(fabs(lorentz->rank_to_distance(rank) - lorentz->compare(au, bu)), 0.0001);
+}
+
+TEST_CASE("cosine with norms") {
+    tann::AlignedQuery<float> a;
+    tann::AlignedQuery<float> b;
+    for (int i = 0; i < 100; i++) {
+        a.emplace_back(i % 20 + 1);
+        b.emplace_back((128 - i) % 10 + 1);
+    }
+    turbo::Span<uint8_t> au(reinterpret_cast<uint8_t *>(a.data()), a.size() * sizeof(float));
+    turbo::Span<uint8_t> bu(reinterpret_cast<uint8_t *>(b.data()), b.size() * sizeof(float));
+    for (auto m: {tann::METRIC_COSINE, tann::METRIC_ANGLE}) {
+        std::unique_ptr<tann::DistanceBase> d(tann::create_distance_native(m, tann::DataType::DT_FLOAT).value());
+        REQUIRE(d->use_norm());
+        auto with_norm = d->compare_rank_with_norm(au, bu, d->norm(au), d->norm(bu));
+        CHECK_LT(fabs(with_norm - d->compare(au, bu)), 0.0001);
+    }
+}
+
+TEST_CASE("dispatch tiers agree") {
+    tann::AlignedQuery<float> a;
+    tann::AlignedQuery<float> b;
+    for (int i = 0; i < 100; i++) {
+        a.emplace_back(i % 20);
+        b.emplace_back((128 - i) % 10);
+    }
+    auto ax = tann::to_span<float>(a);
+    auto bx = tann::to_span<float>(b);
+    auto expect = tann::PrimComparator::simple_compare_l2<float, double>(ax, bx);
+    turbo::Span<uint8_t> au(reinterpret_cast<uint8_t *>(a.data()), a.size() * sizeof(float));
+    turbo::Span<uint8_t> bu(reinterpret_cast<uint8_t *>(b.data()), b.size() * sizeof(float));
+    std::vector<tann::DistanceBase *> distances{tann::create_distance_native(tann::METRIC_L2, tann::DataType::DT_FLOAT).value()};
+#if defined(TANN_WITH_SIMD_DISPATCH)
+    auto level = tann::detect_simd_level();
+    if (level >= tann::SimdLevel::SIMD_SSE4) {
+        distances.push_back(tann::create_distance_sse4(tann::METRIC_L2, tann::DataType::DT_FLOAT).value());
+    }
+    if (level >= tann::SimdLevel::SIMD_AVX2) {
+        distances.push_back(tann::create_distance_avx2(tann::METRIC_L2, tann::DataType::DT_FLOAT).value());
+    }
+    if (level >= tann::SimdLevel::SIMD_AVX512) {
+        distances.push_back(tann::create_distance_avx512(tann::METRIC_L2, tann::DataType::DT_FLOAT).value());
+    }
+#endif
+    turbo::Println("dispatch arch: {}", tann::DistanceFactory::arch_name());
+    for (auto d: distances) {
+        std::unique_ptr<tann::DistanceBase> guard(d);
+        CHECK_LT(fabs(d->compare(au, bu) - expect), 0.001);
+    }
+}
+
 TEST_CASE_TEMPLATE("hamming distance", T, TEST_HM_TYPES) {
     tann::AlignedQuery<T> a;
     tann::AlignedQuery<T> b;
@@ -97,6 +288,32 @@ TEST_CASE_TEMPLATE("hamming distance", T, TEST_HM_TYPES) {
 
 }
 
+TEST_CASE("binary code kernels") {
+    // sizes below, at and above a Harley-Seal block of 512 bytes
+    for (size_t size: {8, 32, 64, 100, 600, 1024}) {
+        const size_t n = 10;
+        tann::AlignedQuery<uint8_t> q;
+        tann::AlignedQuery<uint8_t> codes;
+        for (size_t i = 0; i < size; i++) {
+            q.emplace_back(static_cast<uint8_t>(i * 7 + 3));
+        }
+        for (size_t i = 0; i < size * n; i++) {
+            codes.emplace_back(static_cast<uint8_t>(i * 13 + i / 5));
+        }
+        turbo::Span<uint8_t> qx(q.data(), size);
+        std::vector<double> batch(n);
+        tann::PrimComparator::compare_hamming_batch(qx, codes.data(), size, turbo::Span<double>(batch));
+        for (size_t j = 0; j < n; j++) {
+            turbo::Span<uint8_t> cx(codes.data() + j * size, size);
+            auto expect = tann::PrimComparator::simple_compare_hamming<uint8_t>(qx, cx);
+            CHECK_EQ(tann::PrimComparator::compare_hamming<uint8_t>(qx, cx), expect);
+            CHECK_EQ(batch[j], expect);
+            CHECK_LT(fabs(tann::PrimComparator::compare_jaccard<uint8_t>(qx, cx) -
+                          tann::PrimComparator::simple_compare_jaccard<uint8_t>(qx, cx)), 0.0001);
+        }
+    }
+}
+
 TEST_CASE_TEMPLATE("jaccard distance", T, TEST_HM_TYPES) {
     tann::AlignedQuery<T> a;
     tann::AlignedQuery<T> b;
@@ -0,0 +1,91 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "doctest/doctest.h"
+#include "hnsw_test_fixture.h"
+
+TEST_CASE("auto grow") {
+    int d = 16;
+    int n = 1000;
+    tann::IndexOption option;
+    tann::HnswIndexOption hnsw_option;
+    option.data_type = tann::DataType::DT_FLOAT;
+    option.dimension = d;
+    option.metric = tann::METRIC_L2;
+    option.engine_type = tann::EngineType::ENGINE_HNSW;
+    option.max_elements = 100;
+    option.enable_auto_grow = true;
+    option.grow_step = 128;
+
+    std::mt19937 rng;
+    rng.seed(47);
+    std::uniform_real_distribution<> distrib_real;
+    std::vector<float> data(n * d);
+    for (auto &v: data) {
+        v = distrib_real(rng);
+    }
+
+    tann::IndexCore index;
+    auto rs = index.initialize(option, hnsw_option);
+    REQUIRE(rs.ok());
+    tann::WriteOption wop;
+    ParallelFor(0, n, 4, [&](size_t row, size_t threadId) {
+        auto r = index.add_vector(wop, turbo::Span<uint8_t>((uint8_t *) (data.data() + d * row), d * sizeof(float)),
+                                  row);
+        CHECK_EQ(r.ok(), true);
+    });
+    CHECK_EQ(index.size(), n);
+    CHECK_GE(index.max_elements(), n);
+
+    // every vector should find itself after the graph grown
+    for (int i = 0; i < n; i += 50) {
+        tann::SearchContext query(turbo::Span<uint8_t>((uint8_t *) (data.data() + d * i), d * sizeof(float)));
+        query.k = 1;
+        tann::SearchResult result;
+        auto r = index.search_vector(&query, result);
+        CHECK_EQ(r.ok(), true);
+        REQUIRE_EQ(result.results.size(), 1);
+        CHECK_EQ(result.results[0].second, i);
+    }
+
+    rs = index.reserve(4096);
+    CHECK_EQ(rs.ok(), true);
+    CHECK_EQ(index.max_elements(), 4096);
+}
+
+TEST_CASE("no auto grow") {
+    int d = 16;
+    tann::IndexOption option;
+    tann::HnswIndexOption hnsw_option;
+    option.data_type = tann::DataType::DT_FLOAT;
+    option.dimension = d;
+    option.metric = tann::METRIC_L2;
+    option.engine_type = tann::EngineType::ENGINE_HNSW;
+    option.max_elements = 10;
+
+    std::vector<float> data(d, 0.5);
+    tann::IndexCore index;
+    auto rs = index.initialize(option, hnsw_option);
+    REQUIRE(rs.ok());
+    tann::WriteOption wop;
+    for (size_t i = 0; i < option.max_elements; ++i) {
+        auto r = index.add_vector(wop, turbo::Span<uint8_t>((uint8_t *) data.data(), d * sizeof(float)), i);
+        CHECK_EQ(r.ok(), true);
+    }
+    auto r = index.add_vector(wop, turbo::Span<uint8_t>((uint8_t *) data.data(), d * sizeof(float)), 100);
+    CHECK_EQ(r.ok(), false);
+    CHECK_EQ(turbo::IsResourceExhausted(r.status()), true);
+}
@@ -0,0 +1,96 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "doctest/doctest.h"
+#include "hnsw_test_fixture.h"
+
+namespace {
+
+    tann::IndexOption bq_option(tann::EngineType engine) {
+        tann::IndexOption option;
+        option.data_type = tann::DataType::DT_FLOAT;
+        option.dimension = 64;
+        option.metric = tann::METRIC_L2;
+        option.engine_type = engine;
+        option.max_elements = 1000;
+        option.binary_quantization = true;
+        option.rerank_factor = 8;
+        return option;
+    }
+
+    std::vector<float> bq_data(size_t n, size_t d) {
+        // centered, the sign codes of all positive data are all the same
+        std::mt19937 rng(47);
+        std::uniform_real_distribution<> distrib_real(-1.0, 1.0);
+        std::vector<float> data(n * d);
+        for (auto &v: data) {
+            v = distrib_real(rng);
+        }
+        return data;
+    }
+
+    // every vector is at hamming distance 0 of itself, so it is in the
+    // candidates and the exact re-rank puts it first.
+    size_t self_hits(tann::IndexCore &index, std::vector<float> &data, size_t n, size_t d) {
+        size_t hit = 0;
+        for (size_t i = 0; i < n; i += 10) {
+            tann::SearchContext query(turbo::Span<uint8_t>((uint8_t *) (data.data() + d * i), d * sizeof(float)));
+            query.k = 5;
+            tann::SearchResult result;
+            CHECK_EQ(index.search_vector(&query, result).ok(), true);
+            CHECK_EQ(result.results.size(), 5);
+            if (!result.results.empty() && result.results[0].second == i) {
+                CHECK_LT(result.results[0].first, 0.0001);
+                ++hit;
+            }
+        }
+        return hit;
+    }
+
+    TEST_CASE("binary quantization flat") {
+        auto option = bq_option(tann::EngineType::ENGINE_FLAT);
+        auto data = bq_data(option.max_elements, option.dimension);
+        tann::IndexCore index;
+        REQUIRE(index.initialize(option, {}).ok());
+        tann::WriteOption wop;
+        for (size_t i = 0; i < option.max_elements; ++i) {
+            auto r = index.add_vector(wop, turbo::Span<uint8_t>((uint8_t *) (data.data() + option.dimension * i),
+                                                                option.dimension * sizeof(float)), i);
+            CHECK_EQ(r.ok(), true);
+        }
+        CHECK_EQ(self_hits(index, data, option.max_elements, option.dimension), option.max_elements / 10);
+    }
+
+    TEST_CASE("binary quantization hnsw") {
+        auto option = bq_option(tann::EngineType::ENGINE_HNSW);
+        auto data = bq_data(option.max_elements, option.dimension);
+        tann::IndexCore index;
+        REQUIRE(index.initialize(option, tann::HnswIndexOption{}).ok());
+        tann::WriteOption wop;
+        for (size_t i = 0; i < option.max_elements; ++i) {
+            auto r = index.add_vector(wop, turbo::Span<uint8_t>((uint8_t *) (data.data() + option.dimension * i),
+                                                                option.dimension * sizeof(float)), i);
+            CHECK_EQ(r.ok(), true);
+        }
+        CHECK_GE(self_hits(index, data, option.max_elements, option.dimension), option.max_elements / 10 * 9 / 10);
+    }
+
+    TEST_CASE("binary quantization data type") {
+        auto option = bq_option(tann::EngineType::ENGINE_FLAT);
+        option.data_type = tann::DataType::DT_UINT8;
+        tann::IndexCore index;
+        CHECK_EQ(index.initialize(option, {}).ok(), false);
+    }
+}  // namespace
@@ -0,0 +1,93 @@
+// Copyright 2023 The titan-search Authors.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "doctest/doctest.h"
+#include "hnsw_test_fixture.h"
+
+static std::vector<std::vector<std::pair<tann::distance_type, tann::label_type>>>
+build_and_search(const std::vector<float> &data, int d, int n, size_t threads, size_t executor_threads = 0) {
+    tann::IndexOption option;
+    tann::HnswIndexOption hnsw_option;
+    option.data_type = tann::DataType::DT_FLOAT;
+    option.dimension = d;
+    option.metric = tann::METRIC_L2;
+    option.engine_type = tann::EngineType::ENGINE_HNSW;
+    option.max_elements = n;
+    option.executor_threads = executor_threads;
+    hnsw_option.build_threads = threads;
+    hnsw_option.build_batch_size = 256;
+
+    tann::IndexCore index;
+    auto rs = index.initialize(option, hnsw_option);
+    REQUIRE(rs.ok());
+    std::vector<tann::label_type> labels(n);
+    for (int i = 0; i < n; ++i) {
+        labels[i] = i;
+    }
+    tann::WriteOption wop;
+    auto r = index.add_vectors(wop, turbo::Span<uint8_t>((uint8_t *) data.data(), n * d * sizeof(float)),
+                               turbo::Span<tann::label_type>(labels.data(), labels.size()));
+    REQUIRE(r.ok());
+    CHECK_EQ(index.size(), n);
+    // the batch is one insert sample
+    CHECK_EQ(index.latency(tann::LatencyPhase::kInsert).count, 1);
+    CHECK_EQ(index.latency(tann::LatencyPhase::kInsertLockWait).count, 1);
+
+    std::vector<tann::SearchContext> queries;
+    for (int i = 0; i < n; i += 7) {
+        queries.emplace_back(turbo::Span<uint8_t>((uint8_t *) (data.data() + d * i), d * sizeof(float)));
+        queries.back().k = 10;
+    }
+    std::vector<tann::SearchContext *> contexts;
+    for (auto &q: queries) {
+        contexts.push_back(&q);
+    }
+    std::vector<tann::SearchResult> results(queries.size());
+    auto sr = index.search_vectors(turbo::Span<tann::SearchContext *>(contexts.data(), contexts.size()),
+                                   turbo::Span<tann::SearchResult>(results.data(), results.size()));
+    CHECK_EQ(sr.ok(), true);
+    std::vector<std::vector<std::pair<tann::distance_type, tann::label_type>>> ret;
+    for (auto &result: results) {
+        ret.push_back(result.results);
+    }
+    return ret;
+}
+
+TEST_CASE("deterministic build") {
+    int d = 16;
+    int n = 2000;
+    std::mt19937 rng;
+    rng.seed(47);
+    std::uniform_real_distribution<> distrib_real;
+    std::vector<float> data(n * d);
+    for (auto &v: data) {
+        v = distrib_real(rng);
+    }
+
+    auto single = build_and_search(data, d, n, 1);
+    auto multi = build_and_search(data, d, n, 4);
+    // an executor owned by the index instead of the shared one
+    auto owned = build_and_search(data, d, n, 0, 3);
+    REQUIRE_EQ(single.size(), multi.size());
+    REQUIRE_EQ(single.size(), owned.size());
+    for (size_t i = 0; i < single.size(); ++i) {
+        CHECK_EQ(single[i], multi[i]);
+        CHECK_EQ(single[i], owned[i]);
+        // every vector should find itself
+        REQUIRE_FALSE(single[i].empty());
+        CHECK_EQ(single[i][0].second, i * 7);
+    }
+}
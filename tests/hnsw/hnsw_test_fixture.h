@@ -16,6 +16,7 @@
 #define TANN_HNSW_TEST_FIXTURE_H
 
 #include "tann/core/index_core.h"
+#include "tann/common/executor.h"
 #include "doctest/doctest.h"
 #include <thread>
 #include <chrono>
@@ -113,6 +114,16 @@ public:
         CHECK_EQ(rs.ok(), true);
     }
 
+    // add the n vectors of data to index, labeled 0 .. n - 1
+    void fill(tann::IndexCore &index) {
+        tann::WriteOption op;
+        for (label_type i = 0; i < n; ++i) {
+            auto r = index.add_vector(op, turbo::Span<uint8_t>(reinterpret_cast<uint8_t *>(data.data() + d * i),
+                                                               d * sizeof(float)), i);
+            CHECK_EQ(r.ok(), true);
+        }
+    }
+
     std::vector<float> data;
     std::vector<float> query;
 
@@ -129,58 +140,10 @@ public:
 };
 
 
+// on the shared executor, like the index builds
 template<class Function>
 inline void ParallelFor(size_t start, size_t end, size_t numThreads, Function fn) {
-    if (numThreads <= 0) {
-        numThreads = std::thread::hardware_concurrency();
-    }
-
-    if (numThreads == 1) {
-        for (size_t id = start; id < end; id++) {
-            fn(id, 0);
-        }
-    } else {
-        std::vector<std::thread> threads;
-        std::atomic<size_t> current(start);
-
-        // keep track of exceptions in threads
-        // https://stackoverflow.com/a/32428427/1713196
-        std::exception_ptr lastException = nullptr;
-        std::mutex lastExceptMutex;
-
-        for (size_t threadId = 0; threadId < numThreads; ++threadId) {
-            threads.push_back(std::thread([&, threadId] {
-                while (true) {
-                    size_t id = current.fetch_add(1);
-
-                    if (id >= end) {
-                        break;
-                    }
-
-                    try {
-                        fn(id, threadId);
-                    } catch (...) {
-                        std::unique_lock<std::mutex> lastExcepLock(lastExceptMutex);
-                        lastException = std::current_exception();
-                        /*
-                         * This will work even when current is the largest value that
-                         * size_t can fit, because fetch_add returns the previous value
-                         * before the increment (what will result in overflow
-                         * and produce 0 instead of current + 1).
-                         */
-                        current = end;
-                        break;
-                    }
-                }
-            }));
-        }
-        for (auto &thread: threads) {
-            thread.join();
-        }
-        if (lastException) {
-            std::rethrow_exception(lastException);
-        }
-    }
+    tann::Executor::default_executor()->parallel_for(start, end, fn, numThreads);
 }
 
 
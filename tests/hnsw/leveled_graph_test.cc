@@ -15,6 +15,7 @@
 
 #include "doctest/doctest.h"
 #include "tann/hnsw/leveled_graph.h"
+#include <algorithm>
 
 TEST_CASE("leveled graph") {
     tann::LeveledGraph graph;
@@ -30,4 +31,57 @@ TEST_CASE("leveled graph") {
     CHECK_EQ(graph.mutable_node(2,0).size(), 0);
     CHECK_EQ(graph.mutable_node(2,0).capacity(), 32);
     CHECK_EQ(graph.mutable_node(2,1).capacity(), 16);
-}
\ No newline at end of file
+}
+
+TEST_CASE("leveled graph reserve") {
+    tann::LeveledGraph graph;
+    graph.initialize(100, 16);
+    CHECK_EQ(graph.setup_location(10, 1).ok(), true);
+    graph.mutable_node(10, 0).set_size(1);
+    graph.mutable_node(10, 0).set_link(0, 3);
+    auto before = graph.mutable_node(10, 0).links().data();
+    graph.reserve(100000);
+    CHECK_EQ(graph.max_elements(), 100000);
+    // links set up before growing stay in place
+    CHECK_EQ(graph.mutable_node(10, 0).links().data(), before);
+    CHECK_EQ(graph.mutable_node(10, 0)[0], 3);
+    CHECK_EQ(graph.setup_location(99999, 0).ok(), true);
+    CHECK_EQ(graph.level(99999), 0);
+}
+
+TEST_CASE("leveled graph compress") {
+    tann::LeveledGraph graph;
+    graph.initialize(1000, 16);
+    std::vector<std::vector<tann::location_t>> expect(1000);
+    for (tann::location_t i = 0; i < 1000; ++i) {
+        int level = i % 10 == 0 ? 1 : 0;
+        CHECK_EQ(graph.setup_location(i, level).ok(), true);
+        auto node = graph.mutable_node(i, 0);
+        uint32_t n = i % 33;
+        node.set_size(n);
+        for (uint32_t j = 0; j < n; ++j) {
+            tann::location_t link = (i * 7919 + j * 104729) % 1000;
+            node.set_link(j, link);
+            expect[i].push_back(link);
+        }
+        std::sort(expect[i].begin(), expect[i].end());
+        if (level == 1) {
+            graph.mutable_node(i, 1).set_size(1);
+            graph.mutable_node(i, 1).set_link(0, i + 1);
+        }
+    }
+    auto before = graph.memory_size();
+    graph.compress();
+    CHECK(graph.is_compressed());
+    CHECK_LT(graph.memory_size(), before);
+    std::vector<tann::location_t> out(graph.capacity_for_level(0));
+    for (tann::location_t i = 0; i < 1000; ++i) {
+        auto n = graph.level0_links(i, out.data());
+        REQUIRE_EQ(n, expect[i].size());
+        std::vector<tann::location_t> got(out.begin(), out.begin() + n);
+        CHECK_EQ(got, expect[i]);
+    }
+    // upper levels are kept as they are
+    CHECK_EQ(graph.const_node(10, 1).size(), 1);
+    CHECK_EQ(graph.const_node(10, 1)[0], 11);
+}
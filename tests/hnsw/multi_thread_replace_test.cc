@@ -17,6 +17,7 @@
 
 #include "hnsw_test_fixture.h"
 #include "doctest/doctest.h"
+#include <atomic>
 #include <thread>
 #include <chrono>
 
@@ -51,3 +52,60 @@ TEST_CASE_FIXTURE(HnswIndexTestFixture, "add and remove") {
 
     std::cout << "Finish" << std::endl;
 }
+
+TEST_CASE_FIXTURE(HnswIndexTestFixture, "replace while searching") {
+    ParallelFor(0, max_elements, num_threads, [&](size_t row, size_t threadId) {
+        auto r = index->add_vector(wop, turbo::Span<uint8_t>((uint8_t *) (batch1.get() + d * row), d * sizeof(float)),
+                                   row);
+        CHECK_EQ(r.ok(), true);
+    });
+    for (int i = 0; i < num_elements; i++) {
+        auto r = index->remove_vector(rand_labels[i]);
+        CHECK_EQ(r.ok(), true);
+    }
+
+    // replacements take the shared update lock, searches run beside them
+    std::atomic<bool> done{false};
+    std::atomic<size_t> failed{0};
+    std::vector<std::thread> searchers;
+    for (int t = 0; t < 2; ++t) {
+        searchers.emplace_back([&, t]() {
+            size_t row = t;
+            while (!done.load()) {
+                tann::SearchContext query(
+                        turbo::Span<uint8_t>((uint8_t *) (batch1.get() + d * (row % max_elements)), d * sizeof(float)));
+                query.k = 10;
+                tann::SearchResult result;
+                if (!index->search_vector(&query, result).ok()) {
+                    ++failed;
+                }
+                row += 7;
+            }
+        });
+    }
+    ParallelFor(0, num_elements, num_threads, [&](size_t row, size_t threadId) {
+        int label = rand_labels[row] + max_elements;
+        auto r = index->add_vector(wop1, turbo::Span<uint8_t>((uint8_t *) (batch2.get() + d * row), d * sizeof(float)),
+                                   label);
+        CHECK_EQ(r.ok(), true);
+    });
+    done = true;
+    for (auto &t: searchers) {
+        t.join();
+    }
+    CHECK_EQ(failed.load(), 0);
+    CHECK_EQ(index->size(), static_cast<size_t>(max_elements));
+
+    // the replaced vectors are found under their new labels
+    size_t hit = 0;
+    for (int row = 0; row < num_elements; row += 10) {
+        tann::SearchContext query(turbo::Span<uint8_t>((uint8_t *) (batch2.get() + d * row), d * sizeof(float)));
+        query.k = 1;
+        tann::SearchResult result;
+        REQUIRE(index->search_vector(&query, result).ok());
+        if (!result.results.empty() && result.results[0].second == rand_labels[row] + max_elements) {
+            ++hit;
+        }
+    }
+    CHECK_GE(hit, num_elements / 10 * 9 / 10);
+}
@@ -27,15 +27,8 @@ namespace {
     TEST_CASE_FIXTURE(HnswIndexFilterFixture, "closer") {
 
         TLOG_INFO("insert data");
-        tann::WriteOption op;
-        for (size_t i = 0; i < n; ++i) {
-            auto r1 = findex.add_vector(op, turbo::Span<uint8_t>(reinterpret_cast<uint8_t *>(data.data() + d * i),
-                                                                 d * sizeof(float)), i);
-            CHECK_EQ(r1.ok(), true);
-            r1 = hindex.add_vector(op, turbo::Span<uint8_t>(reinterpret_cast<uint8_t *>(data.data() + d * i),
-                                                            d * sizeof(float)), i);
-            CHECK_EQ(r1.ok(), true);
-        }
+        fill(findex);
+        fill(hindex);
 
         TLOG_INFO("search data");
         // test search_vector of hnsw and flat
@@ -61,5 +54,146 @@ namespace {
         }
     }
 
+    TEST_CASE_FIXTURE(HnswIndexFilterFixture, "closer early stop") {
+        fill(findex);
+        fill(hindex);
+
+        // early stop may lose a few results, but most should be kept
+        size_t hit = 0;
+        for (size_t j = 0; j < nq; ++j) {
+            auto *p = reinterpret_cast<uint8_t *>(query.data() + j * d);
+            tann::SearchContext query_h(turbo::Span<uint8_t>(p, d * sizeof(float)));
+            query_h.k = k;
+            query_h.early_stop_hops = 8;
+            tann::SearchContext query_f(turbo::Span<uint8_t>(p, d * sizeof(float)));
+            query_f.k = k;
+            tann::SearchResult result_h;
+            tann::SearchResult result_f;
+            auto r1 = hindex.search_vector(&query_h, result_h);
+            auto r2 = findex.search_vector(&query_f, result_f);
+            CHECK_EQ(r1.ok(), true);
+            CHECK_EQ(r2.ok(), true);
+            CHECK_EQ(result_h.results.size(), k);
+            for (auto &g: result_f.results) {
+                for (auto &h: result_h.results) {
+                    if (g.second == h.second) {
+                        ++hit;
+                        break;
+                    }
+                }
+            }
+        }
+        CHECK_GE(hit, nq * k * 9 / 10);
+    }
+
+    TEST_CASE_FIXTURE(HnswIndexFilterFixture, "closer budget") {
+        fill(findex);
+        fill(hindex);
+
+        for (size_t j = 0; j < nq; ++j) {
+            auto *p = reinterpret_cast<uint8_t *>(query.data() + j * d);
+            // unbounded
+            tann::SearchContext query_h(turbo::Span<uint8_t>(p, d * sizeof(float)));
+            query_h.k = k;
+            tann::SearchResult result_h;
+            CHECK_EQ(hindex.search_vector(&query_h, result_h).ok(), true);
+            CHECK_EQ(result_h.truncated, false);
+            CHECK_EQ(result_h.results.size(), k);
+
+            // a hop budget keeps the best results so far
+            query_h.max_hops = 1;
+            tann::SearchResult hop_h;
+            CHECK_EQ(hindex.search_vector(&query_h, hop_h).ok(), true);
+            CHECK_EQ(hop_h.truncated, true);
+            CHECK_GT(hop_h.results.size(), 0);
+            CHECK_LE(hop_h.results.size(), k);
+
+            // a spent deadline still returns
+            query_h.max_hops = 0;
+            query_h.timeout_ns = 1;
+            tann::SearchResult late_h;
+            CHECK_EQ(hindex.search_vector(&query_h, late_h).ok(), true);
+            CHECK_EQ(late_h.truncated, true);
+            CHECK_GT(late_h.results.size(), 0);
+
+            tann::SearchContext query_f(turbo::Span<uint8_t>(p, d * sizeof(float)));
+            query_f.k = k;
+            query_f.max_distance_computations = n / 2;
+            tann::SearchResult result_f;
+            CHECK_EQ(findex.search_vector(&query_f, result_f).ok(), true);
+            CHECK_EQ(result_f.truncated, true);
+            CHECK_EQ(result_f.results.size(), k);
+        }
+    }
+
+    TEST_CASE_FIXTURE(HnswIndexFilterFixture, "tune search list") {
+        fill(hindex);
+        tann::TuneOption top;
+        top.k = k;
+        top.target_recall = 0.9;
+        top.max_search_list = 200;
+        // sample from the index
+        auto rs = hindex.tune_search_list(top);
+        REQUIRE(rs.ok());
+        CHECK(rs.value().reached);
+        CHECK_GE(rs.value().recall, 0.9);
+        CHECK_GE(rs.value().search_list, k);
+        CHECK_LE(rs.value().search_list, 200);
+        CHECK_EQ(hindex.search_list(), rs.value().search_list);
+        // the tuning searches are not counted
+        CHECK_EQ(hindex.statistics().searches, 0);
+        CHECK_EQ(hindex.latency(tann::LatencyPhase::kSearch).count, 0);
+
+        // given queries
+        rs = hindex.tune_search_list(top, turbo::Span<uint8_t>(reinterpret_cast<uint8_t *>(query.data()),
+                                                                nq * d * sizeof(float)));
+        REQUIRE(rs.ok());
+        CHECK_GE(rs.value().recall, 0.9);
+
+        // a recall out of reach is reported and not installed
+        auto tuned = hindex.search_list();
+        top.target_recall = 1.1;
+        rs = hindex.tune_search_list(top);
+        REQUIRE(rs.ok());
+        CHECK_FALSE(rs.value().reached);
+        CHECK_EQ(rs.value().search_list, top.max_search_list);
+        CHECK_EQ(hindex.search_list(), tuned);
+    }
+
+    TEST_CASE_FIXTURE(HnswIndexFilterFixture, "closer frozen") {
+        fill(findex);
+        fill(hindex);
+        CHECK_EQ(hindex.freeze().ok(), true);
+        CHECK_EQ(hindex.support_dynamic(), false);
+        // sorted links change the expansion order, the recall against
+        // the flat index should hold.
+        size_t hit = 0;
+        for (size_t j = 0; j < nq; ++j) {
+            auto *p = reinterpret_cast<uint8_t *>(query.data() + j * d);
+            tann::SearchContext query_h(turbo::Span<uint8_t>(p, d * sizeof(float)));
+            query_h.k = k;
+            tann::SearchContext query_f(turbo::Span<uint8_t>(p, d * sizeof(float)));
+            query_f.k = k;
+            tann::SearchResult result_h;
+            tann::SearchResult result_f;
+            CHECK_EQ(hindex.search_vector(&query_h, result_h).ok(), true);
+            CHECK_EQ(findex.search_vector(&query_f, result_f).ok(), true);
+            CHECK_EQ(result_h.results.size(), k);
+            for (auto &g: result_f.results) {
+                for (auto &h: result_h.results) {
+                    if (g.second == h.second) {
+                        ++hit;
+                        break;
+                    }
+                }
+            }
+        }
+        CHECK_GE(hit, nq * k * 9 / 10);
+        tann::WriteOption op;
+        auto r = hindex.add_vector(op, turbo::Span<uint8_t>(reinterpret_cast<uint8_t *>(data.data()),
+                                                           d * sizeof(float)), n + 1);
+        CHECK_EQ(r.ok(), false);
+    }
+
 }  // namespace
 
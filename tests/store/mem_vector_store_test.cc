@@ -18,6 +18,9 @@
 #include "doctest/doctest.h"
 #include "tann/store/mem_vector_store.h"
 #include "turbo/format/print.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
 
 namespace tann {
     class VectorSetTestFixture {
@@ -97,6 +100,35 @@ namespace tann {
         CHECK_EQ(turbo::IsResourceExhausted(r.status()), true);
     }
 
+    TEST_CASE_FIXTURE(VectorSetTestFixture, "drop appended") {
+        for(size_t i = 0; i < 300; i++) {
+            auto r = vector_set.prefer_add_vector(i);
+            CHECK_EQ(r.ok(), true);
+        }
+        // unlinked, the tail is cut across a batch
+        vector_set.drop_appended(240, false);
+        CHECK_EQ(vector_set.current_index(), 240);
+        CHECK_EQ(vector_set.size(), 240);
+        CHECK_FALSE(vector_set.exists_label(250));
+        CHECK(vector_set.exists_label(239));
+        auto r = vector_set.prefer_add_vector(250);
+        REQUIRE(r.ok());
+        CHECK_EQ(r.value(), 240);
+
+        // linked, the slots stay deleted and are not vacant
+        vector_set.drop_appended(200, true);
+        CHECK_EQ(vector_set.current_index(), 241);
+        CHECK_EQ(vector_set.size(), 200);
+        CHECK_EQ(vector_set.deleted_size(), 41);
+        CHECK(vector_set.is_deleted(220));
+        CHECK_FALSE(vector_set.exists_label(250));
+        CHECK_FALSE(vector_set.exists_label(220));
+        CHECK_EQ(turbo::IsResourceExhausted(vector_set.get_vacant(1000).status()), true);
+        r = vector_set.prefer_add_vector(220);
+        REQUIRE(r.ok());
+        CHECK_EQ(r.value(), 241);
+    }
+
     TEST_CASE_FIXTURE(VectorSetTestFixture, "mark_delete") {
         vector_set.disable_vacant();
         CHECK_EQ(vector_set.size(),0);
@@ -130,6 +162,8 @@ namespace tann {
         vector_set.enable_vacant();
         r = vector_set.get_vacant(20000);
         CHECK_EQ(r.ok(), true);
+        CHECK_EQ(vector_set.is_deleted(r.value()), false);
+        CHECK_EQ(vector_set.get_label(r.value()).value(), 20000);
 
         // exist label
         r = vector_set.get_vacant(200);
@@ -146,6 +180,89 @@ namespace tann {
 
     }
 
+    TEST_CASE_FIXTURE(VectorSetTestFixture, "concurrent labels") {
+        std::atomic<size_t> added{0};
+        std::vector<std::thread> threads;
+        for(size_t t = 0; t < 8; t++) {
+            threads.emplace_back([&, t]() {
+                // every label is tried by two threads, one of them wins
+                for(size_t i = t / 2; i < op.max_elements; i += 4) {
+                    if(vector_set.prefer_add_vector(i).ok()) {
+                        ++added;
+                    }
+                }
+            });
+        }
+        for(auto &t : threads) {
+            t.join();
+        }
+        CHECK_EQ(added.load(), op.max_elements);
+        CHECK_EQ(vector_set.size(), op.max_elements);
+        for(size_t i = 0; i < op.max_elements; i++) {
+            CHECK(vector_set.exists_label(i));
+        }
+        for(size_t i = 0; i < vector_set.current_index(); i++) {
+            auto l = vector_set.get_label(i);
+            REQUIRE(l.ok());
+            CHECK_LT(l.value(), op.max_elements);
+        }
+    }
+
+    TEST_CASE_FIXTURE(VectorSetTestFixture, "replace vector") {
+        std::vector<float> v(128, 1.0f);
+        std::vector<float> w(128, 2.0f);
+        auto vs_span = turbo::Span<uint8_t>((uint8_t *) v.data(), v.size() * sizeof(float));
+        auto ws_span = turbo::Span<uint8_t>((uint8_t *) w.data(), w.size() * sizeof(float));
+        for(size_t i = 0; i < 10; i++) {
+            auto r = vector_set.prefer_add_vector(i);
+            REQUIRE(r.ok());
+            vector_set.set_vector(r.value(), vs_span);
+        }
+        REQUIRE(vector_set.remove_vector(3).ok());
+        auto r = vector_set.get_vacant(100);
+        REQUIRE(r.ok());
+        {
+            // a reader inside the epoch keeps a valid old or new vector
+            EpochGuard guard(vector_set.epoch());
+            vector_set.replace_vector(r.value(), ws_span);
+            CHECK_EQ(memcmp(vector_set.get_vector(r.value()).data(), w.data(), ws_span.size()), 0);
+            vector_set.replace_vector(r.value(), vs_span);
+            CHECK_EQ(vector_set.epoch()->pending(), 1);
+            vector_set.replace_vector(r.value(), ws_span);
+        }
+        vector_set.epoch()->reclaim();
+        vector_set.epoch()->reclaim();
+        CHECK_EQ(vector_set.epoch()->pending(), 0);
+        CHECK_EQ(memcmp(vector_set.get_vector(r.value()).data(), w.data(), ws_span.size()), 0);
+
+        // saved with the replaced vector
+        REQUIRE(vector_set.save(vector_file_path).ok());
+        MemVectorStore lset;
+        REQUIRE(lset.initialize(&vs, op).ok());
+        REQUIRE(lset.load(vector_file_path).ok());
+        CHECK_EQ(memcmp(lset.get_vector(r.value()).data(), w.data(), ws_span.size()), 0);
+
+        // the distance of the replaced slot is the one of the fresh vector
+        auto d = vector_set.get_distance(2, r.value());
+        // the fold frees what was retired, not the next retire
+        vector_set.replace_vector(r.value(), ws_span);
+        vector_set.fold_replaced();
+        CHECK_EQ(vector_set.epoch()->pending(), 0);
+        CHECK_EQ(vector_set.get_distance(2, r.value()), d);
+        CHECK_EQ(memcmp(vector_set.get_vector(r.value()).data(), w.data(), ws_span.size()), 0);
+        CHECK_EQ(memcmp(vector_set.get_vector(2).data(), v.data(), vs_span.size()), 0);
+
+        // a failed update gives the slot back
+        vector_set.replace_vector(r.value(), vs_span);
+        vector_set.return_vacant(r.value(), 100);
+        CHECK(vector_set.is_deleted(r.value()));
+        CHECK_FALSE(vector_set.exists_label(100));
+        CHECK_EQ(vector_set.deleted_size(), 1);
+        auto again = vector_set.get_vacant(101);
+        REQUIRE(again.ok());
+        CHECK_EQ(again.value(), r.value());
+    }
+
     TEST_CASE_FIXTURE(VectorSetTestFixture, "save and load") {
         CHECK_EQ(vector_set.size(),0);
         for(size_t i = 0; i < op.max_elements; i++) {
@@ -174,7 +291,10 @@ namespace tann {
         for(size_t i = 0; i < del_list.size(); i++) {
             auto r = vector_set.is_deleted(i);
             CHECK_EQ(r, true);
+            CHECK_EQ(lset.is_deleted(i), true);
         }
+        CHECK_EQ(lset.is_deleted(del_list.size()), false);
+        CHECK_EQ(lset.get_label(del_list.size()).value(), del_list.size());
     }
 
 }  // namespace tann